@@ -0,0 +1,51 @@
+#include <blobpack.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#define VALUES 1000000
+#define ROUNDS 20
+
+static double _now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void _run(const char *name, const struct blob_field *array){
+	const struct blob_field *child;
+	double naive = 0, sum = 0;
+
+	double start = _now();
+	for(int r = 0; r < ROUNDS; r++){
+		naive = 0;
+		blob_field_for_each_child(array, child) naive += blob_field_get_real(child);
+	}
+	double t_naive = (_now() - start) / ROUNDS;
+
+	start = _now();
+	for(int r = 0; r < ROUNDS; r++) sum = blob_field_sum(array, NULL);
+	double t_sum = (_now() - start) / ROUNDS;
+
+	printf("aggregate %s: get_real loop %.2f ms, blob_field_sum %.2f ms (%.1fx)%s\n", name,
+		t_naive * 1e3, t_sum * 1e3, t_naive / t_sum, (fabs(naive - sum) <= 1e-9 * fabs(naive)) ? "" : " MISMATCH");
+}
+
+int main(void){
+	struct blob blob;
+	blob_init(&blob, 0, 0);
+
+	blob_offset_t o = blob_open_array(&blob);
+	for(int c = 0; c < VALUES; c++) blob_put_int(&blob, c);
+	blob_close_array(&blob, o);
+	_run("int32", blob_field_first_child(blob_head(&blob)));
+
+	blob_reset(&blob);
+	o = blob_open_array(&blob);
+	for(int c = 0; c < VALUES; c++) blob_put_real(&blob, c * 0.1);
+	blob_close_array(&blob, o);
+	_run("float64", blob_field_first_child(blob_head(&blob)));
+
+	blob_free(&blob);
+	return 0;
+}
@@ -0,0 +1,233 @@
+#include <blobpack.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Measures the hot paths of the library on small, medium and huge documents and prints the
+// results as JSON so that they can be compared between releases. Usage: core [seconds per run]
+
+// every call of malloc, calloc and realloc is counted as an allocation
+static size_t allocs;
+#ifdef __GLIBC__
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t n, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size){
+	allocs++;
+	return __libc_malloc(size);
+}
+
+void *calloc(size_t n, size_t size){
+	allocs++;
+	return __libc_calloc(n, size);
+}
+
+void *realloc(void *ptr, size_t size){
+	allocs++;
+	return __libc_realloc(ptr, size);
+}
+#endif
+
+struct doc {
+	const char *name;
+	int records;
+	struct blob blob;
+	struct blob copy;
+	const struct blob_field *root;
+	char *json;
+	size_t json_len;
+};
+
+// keeps the compiler from dropping the work of the benchmarks
+static volatile size_t sink;
+static double min_time = 0.1;
+
+static double _now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void _fill(struct blob *blob, int records){
+	char name[32];
+	blob_reset(blob);
+	blob_offset_t a = blob_open_array(blob);
+	for(int c = 0; c < records; c++){
+		blob_offset_t t = blob_open_table(blob);
+		blob_put_string(blob, "id");
+		blob_put_int(blob, c * 7919);
+		blob_put_string(blob, "name");
+		snprintf(name, sizeof(name), "record number %d", c);
+		blob_put_string(blob, name);
+		blob_put_string(blob, "score");
+		blob_put_real(blob, c / 3.0);
+		blob_put_string(blob, "active");
+		blob_put_bool(blob, c & 1);
+		blob_put_string(blob, "tags");
+		blob_offset_t tags = blob_open_array(blob);
+		blob_put_string(blob, "alpha");
+		blob_put_string(blob, "beta");
+		blob_put_int(blob, -c);
+		blob_close_array(blob, tags);
+		blob_close_table(blob, t);
+	}
+	blob_close_array(blob, a);
+}
+
+static size_t _walk(const struct blob_field *field){
+	const struct blob_field *child;
+	size_t count = 1;
+	int type = blob_field_type(field);
+	if(type == BLOB_FIELD_ARRAY || type == BLOB_FIELD_TABLE)
+		blob_field_for_each_child(field, child) count += _walk(child);
+	return count;
+}
+
+static size_t _bench_put(struct doc *doc){
+	_fill(&doc->copy, doc->records);
+	return blob_size(&doc->copy);
+}
+
+static size_t _bench_iterate(struct doc *doc){
+	sink = _walk(doc->root);
+	return blob_field_raw_pad_len(doc->root);
+}
+
+static size_t _bench_get(struct doc *doc){
+	const struct blob_field *record, *key, *value;
+	size_t sum = 0;
+	blob_field_for_each_child(doc->root, record){
+		blob_field_for_each_kv(record, key, value){
+			switch(blob_field_type(value)){
+				case BLOB_FIELD_STRING: sum += strlen(blob_field_get_string(value)); break;
+				case BLOB_FIELD_FLOAT32:
+				case BLOB_FIELD_FLOAT64: sum += (size_t)blob_field_get_real(value); break;
+				case BLOB_FIELD_ARRAY: break;
+				default: sum += blob_field_get_int(value); break;
+			}
+		}
+	}
+	sink = sum;
+	return blob_field_raw_pad_len(doc->root);
+}
+
+static size_t _bench_validate(struct doc *doc){
+	const struct blob_field *record;
+	size_t valid = 0;
+	blob_field_for_each_child(doc->root, record) valid += blob_field_validate(record, "sisssfsvsa");
+	sink = valid;
+	return blob_field_raw_pad_len(doc->root);
+}
+
+static size_t _bench_json_encode(struct doc *doc){
+	char *json = blob_field_to_json(doc->root);
+	size_t len = strlen(json);
+	free(json);
+	return len;
+}
+
+static size_t _bench_json_decode(struct doc *doc){
+	blob_reset(&doc->copy);
+	blob_put_json(&doc->copy, doc->json);
+	return doc->json_len;
+}
+
+static size_t _bench_put_attr(struct doc *doc){
+	blob_reset(&doc->copy);
+	blob_put_attr(&doc->copy, doc->root);
+	return blob_field_raw_pad_len(doc->root);
+}
+
+static const struct {
+	const char *name;
+	size_t (*run)(struct doc *doc);
+} benchmarks[] = {
+	{ "blob_put", _bench_put },
+	{ "next_child", _bench_iterate },
+	{ "get", _bench_get },
+	{ "validate", _bench_validate },
+	{ "json_encode", _bench_json_encode },
+	{ "json_decode", _bench_json_decode },
+	{ "put_attr", _bench_put_attr },
+};
+
+// runs batches of doubling size until one takes min_time and reports the last batch
+static void _measure(struct blob *results, struct doc *doc, int b){
+	size_t ops = 1, bytes = 0, count = 0;
+	double elapsed = 0;
+	benchmarks[b].run(doc);
+	while(elapsed < min_time){
+		ops *= 2;
+		bytes = 0;
+		count = allocs;
+		double start = _now();
+		for(size_t c = 0; c < ops; c++) bytes += benchmarks[b].run(doc);
+		elapsed = _now() - start;
+		count = allocs - count;
+	}
+
+	blob_offset_t t = blob_open_table(results);
+	blob_put_string(results, "name");
+	blob_put_string(results, benchmarks[b].name);
+	blob_put_string(results, "doc");
+	blob_put_string(results, doc->name);
+	blob_put_string(results, "ops");
+	blob_put_int(results, ops);
+	blob_put_string(results, "ns_per_op");
+	blob_put_real(results, elapsed * 1e9 / ops);
+	blob_put_string(results, "bytes_per_op");
+	blob_put_int(results, bytes / ops);
+	blob_put_string(results, "allocs_per_op");
+	blob_put_real(results, (double)count / ops);
+	blob_close_table(results, t);
+}
+
+int main(int argc, char **argv){
+	struct doc docs[] = {
+		{ .name = "small", .records = 1 },
+		{ .name = "medium", .records = 100 },
+		{ .name = "huge", .records = 50000 },
+	};
+	struct blob results;
+	if(argc > 1) min_time = atof(argv[1]);
+	blob_init(&results, 0, 0);
+
+	blob_offset_t t = blob_open_table(&results);
+	blob_put_string(&results, "library");
+	blob_put_string(&results, "blobpack");
+#ifdef PACKAGE_VERSION
+	blob_put_string(&results, "version");
+	blob_put_string(&results, PACKAGE_VERSION);
+#endif
+	blob_put_string(&results, "allocs_counted");
+#ifdef __GLIBC__
+	blob_put_int(&results, 1);
+#else
+	blob_put_int(&results, 0);
+#endif
+	blob_put_string(&results, "results");
+	blob_offset_t a = blob_open_array(&results);
+	for(size_t d = 0; d < sizeof(docs) / sizeof(docs[0]); d++){
+		struct doc *doc = &docs[d];
+		blob_init(&doc->blob, 0, 0);
+		blob_init(&doc->copy, 0, 0);
+		_fill(&doc->blob, doc->records);
+		doc->root = blob_field_first_child(blob_head(&doc->blob));
+		doc->json = blob_field_to_json(doc->root);
+		doc->json_len = strlen(doc->json);
+		for(size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); b++) _measure(&results, doc, b);
+		free(doc->json);
+		blob_free(&doc->copy);
+		blob_free(&doc->blob);
+	}
+	blob_close_array(&results, a);
+	blob_close_table(&results, t);
+
+	char *json = blob_field_to_json(blob_field_first_child(blob_head(&results)));
+	printf("%s\n", json);
+	free(json);
+	blob_free(&results);
+	return 0;
+}
@@ -0,0 +1,280 @@
+#include <blobpack.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ref_value.h"
+#include "ref_msgpack.h"
+#include "ref_cbor.h"
+
+// Encodes and decodes the same generated documents as blobpack blobs, JSON, msgpack and CBOR
+// and prints the encoded size and the ns per encode and decode as JSON. The documents are
+// turned into a plain tree of values once and every format is encoded from that tree, so the
+// library formats pay for building the blob with blob_put_* just like the small reference
+// msgpack and CBOR codecs pay for writing their bytes. Decoding goes from the wire bytes to a
+// blob (a copy that is validated for the blob format itself) or, for the reference codecs,
+// back to a tree. Usage: formats [seconds per run]
+
+struct doc {
+	const char *name;
+	int docs;
+	struct blob_gen_shape shape;
+	// the generated documents that every format is encoded from
+	struct ref_value source;
+	struct ref_arena source_arena;
+	// size of the documents as a blob, which the other sizes are compared to
+	size_t blob_size;
+	struct blob blob;
+	struct blob copy;
+	struct blob_buffer_sink wire;
+	char *json;
+	size_t json_len;
+	struct ref_buf ref_wire;
+	struct ref_value decoded;
+	struct ref_arena decoded_arena;
+};
+
+struct codec {
+	const char *format;
+	const char *codec;
+	bool (*encode)(struct doc *doc);
+	bool (*decode)(struct doc *doc);
+	size_t (*size)(struct doc *doc);
+	bool (*round_trip)(struct doc *doc);
+};
+
+static double min_time = 0.1;
+
+static double _now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const struct blob_field *_root(struct blob *blob){
+	return blob_field_first_child(blob_head(blob));
+}
+
+// every library format starts with building the blob from the source
+static bool _build(struct doc *doc){
+	blob_reset(&doc->blob);
+	return ref_value_put(&doc->source, &doc->blob);
+}
+
+static bool _blob_encode(struct doc *doc){
+	return _build(doc);
+}
+
+// a receiver copies the blob out of its buffer and checks that it is an array of documents
+static bool _blob_decode(struct doc *doc){
+	blob_reset(&doc->copy);
+	return blob_put_attr(&doc->copy, _root(&doc->blob)) != NULL && blob_field_validate(blob_head(&doc->copy), "[v]");
+}
+
+static size_t _blob_size(struct doc *doc){
+	return blob_field_raw_pad_len(_root(&doc->blob));
+}
+
+static bool _blob_round_trip(struct doc *doc){
+	return blob_field_equal(_root(&doc->copy), _root(&doc->blob));
+}
+
+static bool _json_encode(struct doc *doc){
+	if(!_build(doc)) return false;
+	free(doc->json);
+	doc->json = blob_field_to_json(_root(&doc->blob));
+	doc->json_len = doc->json ? strlen(doc->json) : 0;
+	return doc->json != NULL;
+}
+
+static bool _json_decode(struct doc *doc){
+	blob_reset(&doc->copy);
+	return blob_put_json(&doc->copy, doc->json);
+}
+
+static size_t _json_size(struct doc *doc){
+	return doc->json_len;
+}
+
+static size_t _wire_size(struct doc *doc){
+	return doc->wire.len;
+}
+
+static bool _msgpack_encode(struct doc *doc){
+	blob_buffer_sink_reset(&doc->wire);
+	return _build(doc) && blob_field_to_msgpack(_root(&doc->blob), &doc->wire.sink);
+}
+
+static bool _msgpack_decode(struct doc *doc){
+	blob_reset(&doc->copy);
+	return blob_put_msgpack(&doc->copy, doc->wire.buf, doc->wire.len);
+}
+
+static bool _cbor_encode(struct doc *doc){
+	blob_buffer_sink_reset(&doc->wire);
+	return _build(doc) && blob_field_write_cbor(_root(&doc->blob), &doc->wire.sink);
+}
+
+static bool _cbor_decode(struct doc *doc){
+	blob_reset(&doc->copy);
+	return blob_put_cbor(&doc->copy, doc->wire.buf, doc->wire.len);
+}
+
+static size_t _ref_size(struct doc *doc){
+	return doc->ref_wire.len;
+}
+
+static bool _ref_round_trip(struct doc *doc){
+	return ref_value_equal(&doc->decoded, &doc->source);
+}
+
+static bool _ref_msgpack_encode(struct doc *doc){
+	doc->ref_wire.len = 0;
+	return ref_msgpack_encode(&doc->source, &doc->ref_wire);
+}
+
+static bool _ref_msgpack_decode(struct doc *doc){
+	ref_arena_reset(&doc->decoded_arena);
+	return ref_msgpack_decode(&doc->decoded, doc->ref_wire.data, doc->ref_wire.len, &doc->decoded_arena);
+}
+
+static bool _ref_cbor_encode(struct doc *doc){
+	doc->ref_wire.len = 0;
+	return ref_cbor_encode(&doc->source, &doc->ref_wire);
+}
+
+static bool _ref_cbor_decode(struct doc *doc){
+	ref_arena_reset(&doc->decoded_arena);
+	return ref_cbor_decode(&doc->decoded, doc->ref_wire.data, doc->ref_wire.len, &doc->decoded_arena);
+}
+
+static const struct codec codecs[] = {
+	{ "blob", "blobpack", _blob_encode, _blob_decode, _blob_size, _blob_round_trip },
+	{ "json", "blobpack", _json_encode, _json_decode, _json_size, _blob_round_trip },
+	{ "msgpack", "blobpack", _msgpack_encode, _msgpack_decode, _wire_size, _blob_round_trip },
+	{ "cbor", "blobpack", _cbor_encode, _cbor_decode, _wire_size, _blob_round_trip },
+	{ "msgpack", "reference", _ref_msgpack_encode, _ref_msgpack_decode, _ref_size, _ref_round_trip },
+	{ "cbor", "reference", _ref_cbor_encode, _ref_cbor_decode, _ref_size, _ref_round_trip },
+};
+
+// doubles the number of calls until a run takes min_time and returns the ns per call
+static double _time(struct doc *doc, bool (*run)(struct doc *doc), bool *ok){
+	size_t ops = 1;
+	double elapsed = 0;
+	*ok = run(doc) && *ok;
+	while(elapsed < min_time){
+		ops *= 2;
+		double start = _now();
+		for(size_t c = 0; c < ops; c++) *ok = run(doc) && *ok;
+		elapsed = _now() - start;
+	}
+	return elapsed * 1e9 / ops;
+}
+
+static void _measure(struct blob *results, struct doc *doc, const struct codec *codec){
+	bool ok = true;
+	double encode = _time(doc, codec->encode, &ok);
+	double decode = _time(doc, codec->decode, &ok);
+
+	blob_offset_t t = blob_open_table(results);
+	blob_put_string(results, "doc");
+	blob_put_string(results, doc->name);
+	blob_put_string(results, "docs");
+	blob_put_int(results, doc->docs);
+	blob_put_string(results, "format");
+	blob_put_string(results, codec->format);
+	blob_put_string(results, "codec");
+	blob_put_string(results, codec->codec);
+	blob_put_string(results, "bytes");
+	blob_put_int(results, codec->size(doc));
+	blob_put_string(results, "size_ratio");
+	blob_put_real(results, (double)codec->size(doc) / doc->blob_size);
+	blob_put_string(results, "encode_ns");
+	blob_put_real(results, encode);
+	blob_put_string(results, "decode_ns");
+	blob_put_real(results, decode);
+	blob_put_string(results, "ok");
+	blob_put_bool(results, ok);
+	// JSON prints reals with fewer digits than a double has, so it does not always round trip
+	blob_put_string(results, "round_trip");
+	blob_put_bool(results, codec->round_trip(doc));
+	blob_close_table(results, t);
+}
+
+int main(int argc, char **argv){
+	struct doc docs[4] = {
+		{ .name = "records", .docs = 300 },
+		{ .name = "numeric", .docs = 300 },
+		{ .name = "text", .docs = 100 },
+		{ .name = "deep", .docs = 100 },
+	};
+	struct blob results;
+	if(argc > 1) min_time = atof(argv[1]);
+
+	for(size_t d = 0; d < sizeof(docs) / sizeof(docs[0]); d++) blob_gen_shape_default(&docs[d].shape);
+	// mostly arrays of numbers
+	docs[1].shape.depth = 1;
+	docs[1].shape.fanout = (struct blob_gen_dist){ .min = 8, .max = 64 };
+	docs[1].shape.table_share = 0.2;
+	docs[1].shape.float_share = 0.5;
+	docs[1].shape.string_share = 0;
+	// long strings
+	docs[2].shape.string_len = (struct blob_gen_dist){ .min = 16, .max = 4096, .log = true };
+	docs[2].shape.float_share = 0.05;
+	docs[2].shape.string_share = 0.8;
+	// narrow and deeply nested
+	docs[3].shape.depth = 10;
+	docs[3].shape.fanout = (struct blob_gen_dist){ .min = 1, .max = 3 };
+	docs[3].shape.container_share = 0.6;
+
+	blob_init(&results, 0, 0);
+	blob_offset_t t = blob_open_table(&results);
+	blob_put_string(&results, "library");
+	blob_put_string(&results, "blobpack");
+#ifdef PACKAGE_VERSION
+	blob_put_string(&results, "version");
+	blob_put_string(&results, PACKAGE_VERSION);
+#endif
+	blob_put_string(&results, "results");
+	blob_offset_t a = blob_open_array(&results);
+	for(size_t d = 0; d < sizeof(docs) / sizeof(docs[0]); d++){
+		struct doc *doc = &docs[d];
+		struct blob_gen gen;
+		blob_init(&doc->blob, 0, 0);
+		blob_init(&doc->copy, 0, 0);
+		blob_buffer_sink_init(&doc->wire);
+		ref_buf_init(&doc->ref_wire);
+		ref_arena_init(&doc->source_arena);
+		ref_arena_init(&doc->decoded_arena);
+		blob_gen_init(&gen, &doc->shape, d + 1);
+		blob_offset_t o = blob_open_array(&doc->blob);
+		for(int c = 0; c < doc->docs; c++){
+			if(!blob_gen_put(&gen, &doc->blob)){
+				fprintf(stderr, "the %s documents do not fit into a blob\n", doc->name);
+				return 1;
+			}
+		}
+		blob_close_array(&doc->blob, o);
+		if(!ref_value_from_field(&doc->source, _root(&doc->blob), &doc->source_arena) || !_build(doc)){
+			fprintf(stderr, "the %s documents can not be converted\n", doc->name);
+			return 1;
+		}
+		doc->blob_size = _blob_size(doc);
+		for(size_t c = 0; c < sizeof(codecs) / sizeof(codecs[0]); c++) _measure(&results, doc, &codecs[c]);
+		free(doc->json);
+		ref_arena_free(&doc->decoded_arena);
+		ref_arena_free(&doc->source_arena);
+		ref_buf_free(&doc->ref_wire);
+		blob_buffer_sink_free(&doc->wire);
+		blob_free(&doc->copy);
+		blob_free(&doc->blob);
+	}
+	blob_close_array(&results, a);
+	blob_close_table(&results, t);
+
+	char *json = blob_field_to_json(blob_field_first_child(blob_head(&results)));
+	printf("%s\n", json);
+	free(json);
+	blob_free(&results);
+	return 0;
+}
@@ -0,0 +1,48 @@
+#include <blobpack.h>
+#include <stdio.h>
+#include <time.h>
+
+#define ROUNDS 50
+
+static double _now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void){
+	struct blob blob, canonical;
+	char name[32];
+	uint64_t hash = 0;
+	blob_init(&blob, 0, 0);
+	blob_init(&canonical, 0, 0);
+
+	blob_offset_t o = blob_open_array(&blob);
+	for(int c = 0; c < 100000; c++){
+		blob_offset_t t = blob_open_table(&blob);
+		blob_put_string(&blob, "state");
+		blob_put_string(&blob, (c & 1) ? "online" : "offline");
+		blob_put_string(&blob, "id");
+		blob_put_int(&blob, c);
+		blob_put_string(&blob, "name");
+		snprintf(name, sizeof(name), "device %d", c);
+		blob_put_string(&blob, name);
+		blob_close_table(&blob, t);
+	}
+	blob_close_array(&blob, o);
+
+	double start = _now();
+	for(int r = 0; r < ROUNDS; r++) hash += blob_field_hash64(blob_head(&blob));
+	double t_hash = (_now() - start) / ROUNDS;
+
+	start = _now();
+	for(int r = 0; r < ROUNDS; r++) blob_canonicalize(&canonical, &blob);
+	double t_canonical = (_now() - start) / ROUNDS;
+
+	printf("hash64: %u bytes in %.3f ms (%.2f GB/s), canonicalize %.2f ms (%016llx)\n", blob_size(&blob),
+		t_hash * 1e3, blob_size(&blob) / t_hash / 1e9, t_canonical * 1e3, (unsigned long long)hash);
+
+	blob_free(&blob);
+	blob_free(&canonical);
+	return 0;
+}
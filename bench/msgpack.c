@@ -0,0 +1,89 @@
+#include <blobpack.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define RECORDS 10000
+#define ROUNDS 20
+
+static double _now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void _fill(struct blob *blob){
+	char name[32];
+	blob_offset_t a = blob_open_array(blob);
+	for(int c = 0; c < RECORDS; c++){
+		blob_offset_t t = blob_open_table(blob);
+		blob_put_string(blob, "id");
+		blob_put_int(blob, c * 7919);
+		blob_put_string(blob, "name");
+		snprintf(name, sizeof(name), "record number %d", c);
+		blob_put_string(blob, name);
+		blob_put_string(blob, "score");
+		blob_put_real(blob, c / 3.0);
+		blob_put_string(blob, "active");
+		blob_put_bool(blob, c & 1);
+		blob_put_string(blob, "tags");
+		blob_offset_t tags = blob_open_array(blob);
+		blob_put_string(blob, "alpha");
+		blob_put_string(blob, "beta");
+		blob_put_int(blob, -c);
+		blob_close_array(blob, tags);
+		blob_close_table(blob, t);
+	}
+	blob_close_array(blob, a);
+}
+
+static void _report(const char *name, size_t bytes, double encode, double decode){
+	printf("%-8s %8zu bytes  encode %8.1f MB/s  decode %8.1f MB/s  round trip %8.2f ms\n",
+		name, bytes, bytes * ROUNDS / encode / 1e6, bytes * ROUNDS / decode / 1e6,
+		(encode + decode) * 1000 / ROUNDS);
+}
+
+int main(void){
+	struct blob blob, copy;
+	struct blob_buffer_sink sink;
+	blob_init(&blob, 0, 0);
+	blob_init(&copy, 0, 0);
+	blob_buffer_sink_init(&sink);
+	_fill(&blob);
+	const struct blob_field *root = blob_field_first_child(blob_head(&blob));
+
+	double start = _now();
+	for(int c = 0; c < ROUNDS; c++){
+		blob_buffer_sink_reset(&sink);
+		if(!blob_field_to_msgpack(root, &sink.sink)) return 1;
+	}
+	double encode = _now() - start;
+	start = _now();
+	for(int c = 0; c < ROUNDS; c++){
+		blob_reset(&copy);
+		if(!blob_put_msgpack(&copy, sink.buf, sink.len)) return 1;
+	}
+	double decode = _now() - start;
+	_report("msgpack", sink.len, encode, decode);
+
+	char *json = NULL;
+	start = _now();
+	for(int c = 0; c < ROUNDS; c++){
+		free(json);
+		json = blob_field_to_json(root);
+	}
+	encode = _now() - start;
+	start = _now();
+	for(int c = 0; c < ROUNDS; c++){
+		blob_reset(&copy);
+		if(!blob_put_json(&copy, json)) return 1;
+	}
+	decode = _now() - start;
+	_report("json", strlen(json), encode, decode);
+
+	free(json);
+	blob_buffer_sink_free(&sink);
+	blob_free(&blob);
+	blob_free(&copy);
+	return 0;
+}
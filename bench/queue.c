@@ -0,0 +1,62 @@
+#include <blobpack.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+
+#define MESSAGES 2000000
+
+static double _now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *_writer(void *arg){
+	struct blob_queue *queue = arg;
+	struct blob blob;
+	for(int c = 0; c < MESSAGES; c++){
+		while(!blob_queue_reserve(queue, &blob, 128)) sched_yield();
+		blob_offset_t o = blob_open_table(&blob);
+		blob_put_string(&blob, "seq");
+		blob_put_int(&blob, c);
+		blob_put_string(&blob, "state");
+		blob_put_string(&blob, "online");
+		blob_close_table(&blob, o);
+		blob_queue_commit(queue, &blob);
+	}
+	return NULL;
+}
+
+static void _run(const char *name, unsigned int flags, int writers){
+	struct blob_queue queue;
+	pthread_t threads[4];
+	long long sum = 0;
+
+	if(!blob_queue_init(&queue, 1 << 20, flags)) return;
+	double start = _now();
+	for(int c = 0; c < writers; c++) pthread_create(&threads[c], NULL, _writer, &queue);
+	for(int c = 0; c < MESSAGES * writers; ){
+		const struct blob_field *msg = blob_queue_peek(&queue);
+		if(!msg){
+			sched_yield();
+			continue;
+		}
+		const struct blob_field *table = blob_field_first_child(msg);
+		sum += blob_field_get_int(blob_field_next_child(table, blob_field_first_child(table)));
+		blob_queue_release(&queue);
+		c++;
+	}
+	for(int c = 0; c < writers; c++) pthread_join(threads[c], NULL);
+	double t = _now() - start;
+	printf("queue %s: %.1f M messages/s (%.0f ns/message)\n", name, MESSAGES * writers / t / 1e6, t * 1e9 / (MESSAGES * writers));
+	blob_queue_free(&queue);
+	(void)sum;
+}
+
+int main(void){
+	_run("spsc", 0, 1);
+	_run("mpsc 1 writer", BLOB_QUEUE_MPSC, 1);
+	_run("mpsc 4 writers", BLOB_QUEUE_MPSC, 4);
+	return 0;
+}
@@ -0,0 +1,182 @@
+#include <math.h>
+#include <string.h>
+#include "ref_cbor.h"
+
+enum {
+	MAJOR_UINT,
+	MAJOR_NEGINT,
+	MAJOR_BYTES,
+	MAJOR_TEXT,
+	MAJOR_ARRAY,
+	MAJOR_MAP,
+	MAJOR_TAG,
+	MAJOR_SIMPLE
+};
+
+static void _put_raw(struct ref_buf *out, uint8_t initial, uint64_t val, unsigned int bytes){
+	uint8_t buf[9];
+	buf[0] = initial;
+	for(unsigned int c = 0; c < bytes; c++)
+		buf[bytes - c] = (uint8_t)(val >> (8 * c));
+	ref_buf_write(out, buf, bytes + 1);
+}
+
+static void _put_head(struct ref_buf *out, uint8_t major, uint64_t arg){
+	if(arg < 24) _put_raw(out, (major << 5) | arg, 0, 0);
+	else if(arg <= UINT8_MAX) _put_raw(out, (major << 5) | 24, arg, 1);
+	else if(arg <= UINT16_MAX) _put_raw(out, (major << 5) | 25, arg, 2);
+	else if(arg <= UINT32_MAX) _put_raw(out, (major << 5) | 26, arg, 4);
+	else _put_raw(out, (major << 5) | 27, arg, 8);
+}
+
+static void _encode(const struct ref_value *value, struct ref_buf *out){
+	size_t count;
+	float f;
+	switch(value->type){
+		case REF_INT:
+			if(value->u.i >= 0) _put_head(out, MAJOR_UINT, value->u.i);
+			else _put_head(out, MAJOR_NEGINT, -1 - value->u.i);
+			break;
+		case REF_REAL:
+			f = (float)value->u.d;
+			if((double)f == value->u.d){
+				uint32_t bits;
+				memcpy(&bits, &f, sizeof(bits));
+				_put_raw(out, (MAJOR_SIMPLE << 5) | 26, bits, 4);
+			} else {
+				uint64_t bits;
+				memcpy(&bits, &value->u.d, sizeof(bits));
+				_put_raw(out, (MAJOR_SIMPLE << 5) | 27, bits, 8);
+			}
+			break;
+		case REF_STRING:
+			_put_head(out, MAJOR_TEXT, value->u.str.len);
+			ref_buf_write(out, value->u.str.ptr, value->u.str.len);
+			break;
+		case REF_ARRAY:
+		case REF_MAP:
+			_put_head(out, (value->type == REF_MAP) ? MAJOR_MAP : MAJOR_ARRAY, value->u.list.count);
+			count = (value->type == REF_MAP) ? value->u.list.count * 2 : value->u.list.count;
+			for(size_t c = 0; c < count; c++) _encode(&value->u.list.items[c], out);
+			break;
+	}
+}
+
+bool ref_cbor_encode(const struct ref_value *value, struct ref_buf *out){
+	_encode(value, out);
+	return !out->failed;
+}
+
+/********************************
+** DECODING
+********************************/
+
+struct reader {
+	const uint8_t *pos;
+	const uint8_t *end;
+	struct ref_arena *arena;
+};
+
+// reads the initial byte and the argument that follows it
+static bool _get_head(struct reader *r, uint8_t *major, uint8_t *info, uint64_t *arg){
+	unsigned int bytes;
+	if(r->pos == r->end) return false;
+	*major = *r->pos >> 5;
+	*info = *r->pos & 0x1f;
+	r->pos++;
+	if(*info < 24){
+		*arg = *info;
+		return true;
+	}
+	if(*info > 27) return false;
+	bytes = 1u << (*info - 24);
+	if((size_t)(r->end - r->pos) < bytes) return false;
+	*arg = 0;
+	for(unsigned int c = 0; c < bytes; c++) *arg = (*arg << 8) | *r->pos++;
+	return true;
+}
+
+static double _half(uint16_t half){
+	int exp = (half >> 10) & 0x1f;
+	int mant = half & 0x3ff;
+	double val;
+	if(exp == 0) val = ldexp(mant, -24);
+	else if(exp != 31) val = ldexp(mant + 1024, exp - 25);
+	else val = mant ? NAN : INFINITY;
+	return (half & 0x8000) ? -val : val;
+}
+
+static bool _set_int(struct ref_value *value, long long val){
+	value->type = REF_INT;
+	value->u.i = val;
+	return true;
+}
+
+static bool _decode(struct reader *r, struct ref_value *value, int depth){
+	uint8_t major, info;
+	uint64_t arg, items;
+
+	if(depth >= REF_MAX_DEPTH || !_get_head(r, &major, &info, &arg)) return false;
+	switch(major){
+		case MAJOR_UINT:
+			return arg <= INT64_MAX && _set_int(value, (long long)arg);
+		case MAJOR_NEGINT:
+			return arg <= INT64_MAX && _set_int(value, -1 - (long long)arg);
+		case MAJOR_TEXT: {
+			if((uint64_t)(r->end - r->pos) < arg) return false;
+			char *str = ref_arena_alloc(r->arena, arg + 1);
+			if(!str) return false;
+			memcpy(str, r->pos, arg);
+			str[arg] = 0;
+			r->pos += arg;
+			value->type = REF_STRING;
+			value->u.str.ptr = str;
+			value->u.str.len = arg;
+			return true;
+		}
+		case MAJOR_ARRAY:
+		case MAJOR_MAP:
+			items = (major == MAJOR_MAP) ? arg * 2 : arg;
+			// every item takes at least one byte
+			if(arg > SIZE_MAX / 2 || items > (uint64_t)(r->end - r->pos)) return false;
+			value->type = (major == MAJOR_MAP) ? REF_MAP : REF_ARRAY;
+			value->u.list.count = arg;
+			value->u.list.items = ref_arena_alloc(r->arena, items * sizeof(struct ref_value));
+			if(items && !value->u.list.items) return false;
+			for(uint64_t c = 0; c < items; c++){
+				if(!_decode(r, &value->u.list.items[c], depth + 1)) return false;
+				if(major == MAJOR_MAP && !(c & 1) && value->u.list.items[c].type != REF_STRING) return false;
+			}
+			return true;
+		case MAJOR_TAG:
+			return _decode(r, value, depth + 1);
+		case MAJOR_SIMPLE:
+			switch(info){
+				case 20: case 22: case 23: return _set_int(value, 0);
+				case 21: return _set_int(value, 1);
+				case 25:
+					value->type = REF_REAL;
+					value->u.d = _half((uint16_t)arg);
+					return true;
+				case 26: {
+					uint32_t bits = (uint32_t)arg;
+					float f;
+					memcpy(&f, &bits, sizeof(f));
+					value->type = REF_REAL;
+					value->u.d = f;
+					return true;
+				}
+				case 27:
+					value->type = REF_REAL;
+					memcpy(&value->u.d, &arg, sizeof(arg));
+					return true;
+			}
+			return false;
+	}
+	return false;
+}
+
+bool ref_cbor_decode(struct ref_value *value, const uint8_t *data, size_t size, struct ref_arena *arena){
+	struct reader r = { .pos = data, .end = data + size, .arena = arena };
+	return _decode(&r, value, 0) && r.pos == r.end;
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "ref_value.h"
+
+// A small CBOR (RFC 8949) codec that is independent of the library and serves as a baseline for
+// it in the formats benchmark. The encoder writes definite lengths and the shortest int and
+// float (32 or 64 bit) that is exact. The decoder also takes half floats and tags (which are
+// ignored). Booleans and null decode to ints, indefinite lengths and byte strings are refused.
+
+// appends the encoding of value to out. Returns false if out ran out of memory.
+bool ref_cbor_encode(const struct ref_value *value, struct ref_buf *out);
+
+// decodes exactly one value that fills all of data into the arena
+bool ref_cbor_decode(struct ref_value *value, const uint8_t *data, size_t size, struct ref_arena *arena);
@@ -0,0 +1,177 @@
+#include <string.h>
+#include "ref_msgpack.h"
+
+static void _put(struct ref_buf *out, uint8_t marker, uint64_t val, unsigned int bytes){
+	uint8_t buf[9];
+	buf[0] = marker;
+	for(unsigned int c = 0; c < bytes; c++)
+		buf[bytes - c] = (uint8_t)(val >> (8 * c));
+	ref_buf_write(out, buf, bytes + 1);
+}
+
+static void _put_int(struct ref_buf *out, long long val){
+	if(val >= 0){
+		if(val <= 0x7f) _put(out, (uint8_t)val, 0, 0);
+		else if(val <= UINT8_MAX) _put(out, 0xcc, val, 1);
+		else if(val <= UINT16_MAX) _put(out, 0xcd, val, 2);
+		else if(val <= UINT32_MAX) _put(out, 0xce, val, 4);
+		else _put(out, 0xcf, val, 8);
+	} else {
+		if(val >= -32) _put(out, (uint8_t)val, 0, 0);
+		else if(val >= INT8_MIN) _put(out, 0xd0, (uint8_t)val, 1);
+		else if(val >= INT16_MIN) _put(out, 0xd1, (uint16_t)val, 2);
+		else if(val >= INT32_MIN) _put(out, 0xd2, (uint32_t)val, 4);
+		else _put(out, 0xd3, (uint64_t)val, 8);
+	}
+}
+
+static void _put_real(struct ref_buf *out, double val){
+	float f = (float)val;
+	if((double)f == val){
+		uint32_t bits;
+		memcpy(&bits, &f, sizeof(bits));
+		_put(out, 0xca, bits, 4);
+	} else {
+		uint64_t bits;
+		memcpy(&bits, &val, sizeof(bits));
+		_put(out, 0xcb, bits, 8);
+	}
+}
+
+static void _put_length(struct ref_buf *out, uint8_t fix, unsigned int fix_max, uint8_t m8, uint8_t m16, uint8_t m32, size_t len){
+	if(len <= fix_max) _put(out, fix | len, 0, 0);
+	else if(m8 && len <= UINT8_MAX) _put(out, m8, len, 1);
+	else if(len <= UINT16_MAX) _put(out, m16, len, 2);
+	else _put(out, m32, len, 4);
+}
+
+static void _encode(const struct ref_value *value, struct ref_buf *out){
+	size_t count;
+	switch(value->type){
+		case REF_INT:
+			_put_int(out, value->u.i);
+			break;
+		case REF_REAL:
+			_put_real(out, value->u.d);
+			break;
+		case REF_STRING:
+			_put_length(out, 0xa0, 31, 0xd9, 0xda, 0xdb, value->u.str.len);
+			ref_buf_write(out, value->u.str.ptr, value->u.str.len);
+			break;
+		case REF_ARRAY:
+		case REF_MAP:
+			if(value->type == REF_MAP) _put_length(out, 0x80, 15, 0, 0xde, 0xdf, value->u.list.count);
+			else _put_length(out, 0x90, 15, 0, 0xdc, 0xdd, value->u.list.count);
+			count = (value->type == REF_MAP) ? value->u.list.count * 2 : value->u.list.count;
+			for(size_t c = 0; c < count; c++) _encode(&value->u.list.items[c], out);
+			break;
+	}
+}
+
+bool ref_msgpack_encode(const struct ref_value *value, struct ref_buf *out){
+	_encode(value, out);
+	return !out->failed;
+}
+
+/********************************
+** DECODING
+********************************/
+
+struct reader {
+	const uint8_t *pos;
+	const uint8_t *end;
+	struct ref_arena *arena;
+};
+
+static bool _get(struct reader *r, unsigned int bytes, uint64_t *val){
+	if((size_t)(r->end - r->pos) < bytes) return false;
+	*val = 0;
+	for(unsigned int c = 0; c < bytes; c++) *val = (*val << 8) | *r->pos++;
+	return true;
+}
+
+static bool _get_string(struct reader *r, struct ref_value *value, uint64_t len){
+	if((uint64_t)(r->end - r->pos) < len) return false;
+	char *str = ref_arena_alloc(r->arena, len + 1);
+	if(!str) return false;
+	memcpy(str, r->pos, len);
+	str[len] = 0;
+	r->pos += len;
+	value->type = REF_STRING;
+	value->u.str.ptr = str;
+	value->u.str.len = len;
+	return true;
+}
+
+static bool _decode(struct reader *r, struct ref_value *value, int depth);
+
+static bool _get_list(struct reader *r, struct ref_value *value, int type, uint64_t count, int depth){
+	uint64_t items = (type == REF_MAP) ? count * 2 : count;
+	// every item takes at least one byte
+	if(depth >= REF_MAX_DEPTH || items > (uint64_t)(r->end - r->pos)) return false;
+	value->type = type;
+	value->u.list.count = count;
+	value->u.list.items = ref_arena_alloc(r->arena, items * sizeof(struct ref_value));
+	if(items && !value->u.list.items) return false;
+	for(uint64_t c = 0; c < items; c++){
+		if(!_decode(r, &value->u.list.items[c], depth + 1)) return false;
+		if(type == REF_MAP && !(c & 1) && value->u.list.items[c].type != REF_STRING) return false;
+	}
+	return true;
+}
+
+static bool _set_int(struct ref_value *value, long long val){
+	value->type = REF_INT;
+	value->u.i = val;
+	return true;
+}
+
+static bool _decode(struct reader *r, struct ref_value *value, int depth){
+	uint64_t val;
+	uint8_t m;
+
+	if(r->pos == r->end) return false;
+	m = *r->pos++;
+	if(m <= 0x7f || m >= 0xe0) return _set_int(value, (int8_t)m);
+	if((m & 0xe0) == 0xa0) return _get_string(r, value, m & 0x1f);
+	if((m & 0xf0) == 0x90) return _get_list(r, value, REF_ARRAY, m & 0x0f, depth);
+	if((m & 0xf0) == 0x80) return _get_list(r, value, REF_MAP, m & 0x0f, depth);
+
+	switch(m){
+		case 0xc0: case 0xc2: return _set_int(value, 0);
+		case 0xc3: return _set_int(value, 1);
+		case 0xca: {
+			float f;
+			uint32_t bits;
+			if(!_get(r, 4, &val)) return false;
+			bits = (uint32_t)val;
+			memcpy(&f, &bits, sizeof(f));
+			value->type = REF_REAL;
+			value->u.d = f;
+			return true;
+		}
+		case 0xcb:
+			if(!_get(r, 8, &val)) return false;
+			value->type = REF_REAL;
+			memcpy(&value->u.d, &val, sizeof(val));
+			return true;
+		case 0xcc: case 0xcd: case 0xce: case 0xcf:
+			return _get(r, 1 << (m - 0xcc), &val) && val <= INT64_MAX && _set_int(value, (long long)val);
+		case 0xd0: return _get(r, 1, &val) && _set_int(value, (int8_t)val);
+		case 0xd1: return _get(r, 2, &val) && _set_int(value, (int16_t)val);
+		case 0xd2: return _get(r, 4, &val) && _set_int(value, (int32_t)val);
+		case 0xd3: return _get(r, 8, &val) && _set_int(value, (int64_t)val);
+		case 0xd9: case 0xda: case 0xdb:
+			return _get(r, 1 << (m - 0xd9), &val) && _get_string(r, value, val);
+		case 0xdc: case 0xdd:
+			return _get(r, 2 << (m - 0xdc), &val) && _get_list(r, value, REF_ARRAY, val, depth);
+		case 0xde: case 0xdf:
+			return _get(r, 2 << (m - 0xde), &val) && _get_list(r, value, REF_MAP, val, depth);
+	}
+	return false;
+}
+
+bool ref_msgpack_decode(struct ref_value *value, const uint8_t *data, size_t size, struct ref_arena *arena){
+	struct reader r = { .pos = data, .end = data + size, .arena = arena };
+	return _decode(&r, value, 0) && r.pos == r.end;
+}
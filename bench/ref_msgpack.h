@@ -0,0 +1,14 @@
+#pragma once
+
+#include "ref_value.h"
+
+// A small msgpack codec that is independent of the library and serves as a baseline for it in
+// the formats benchmark. Ints use the shortest encoding, reals are written as float 32 when
+// that is exact and as float 64 otherwise. nil and booleans decode to ints, bin and ext are
+// refused.
+
+// appends the encoding of value to out. Returns false if out ran out of memory.
+bool ref_msgpack_encode(const struct ref_value *value, struct ref_buf *out);
+
+// decodes exactly one value that fills all of data into the arena
+bool ref_msgpack_decode(struct ref_value *value, const uint8_t *data, size_t size, struct ref_arena *arena);
@@ -0,0 +1,166 @@
+#include <stdlib.h>
+#include <string.h>
+#include "ref_value.h"
+
+#define REF_ARENA_BLOCK_SIZE (256 * 1024)
+
+struct ref_arena_block {
+	struct ref_arena_block *next;
+	size_t size;
+	size_t used;
+	char data[];
+};
+
+void ref_arena_init(struct ref_arena *self){
+	self->head = self->cur = NULL;
+}
+
+void *ref_arena_alloc(struct ref_arena *self, size_t size){
+	struct ref_arena_block *block;
+	size = (size + 7) & ~(size_t)7;
+	if(self->cur && self->cur->size - self->cur->used >= size) goto found;
+	// blocks left over from before the last reset are used again if they are big enough
+	while(self->cur && self->cur->next){
+		self->cur = self->cur->next;
+		if(self->cur->size >= size) goto found;
+	}
+	size_t block_size = size > REF_ARENA_BLOCK_SIZE ? size : REF_ARENA_BLOCK_SIZE;
+	if(!(block = malloc(sizeof(*block) + block_size))) return NULL;
+	block->next = NULL;
+	block->size = block_size;
+	block->used = 0;
+	if(self->cur) self->cur->next = block;
+	else self->head = block;
+	self->cur = block;
+found:
+	block = self->cur;
+	block->used += size;
+	return block->data + block->used - size;
+}
+
+void ref_arena_reset(struct ref_arena *self){
+	for(struct ref_arena_block *block = self->head; block; block = block->next) block->used = 0;
+	self->cur = self->head;
+}
+
+void ref_arena_free(struct ref_arena *self){
+	while(self->head){
+		struct ref_arena_block *next = self->head->next;
+		free(self->head);
+		self->head = next;
+	}
+	self->cur = NULL;
+}
+
+void ref_buf_init(struct ref_buf *self){
+	memset(self, 0, sizeof(*self));
+}
+
+void ref_buf_write(struct ref_buf *self, const void *data, size_t size){
+	if(self->size - self->len < size){
+		size_t new_size = self->size ? self->size : 4096;
+		while(new_size - self->len < size) new_size *= 2;
+		uint8_t *buf = realloc(self->data, new_size);
+		if(!buf){
+			self->failed = true;
+			return;
+		}
+		self->data = buf;
+		self->size = new_size;
+	}
+	memcpy(self->data + self->len, data, size);
+	self->len += size;
+}
+
+void ref_buf_free(struct ref_buf *self){
+	free(self->data);
+	ref_buf_init(self);
+}
+
+bool ref_value_from_field(struct ref_value *self, const struct blob_field *field, struct ref_arena *arena){
+	const struct blob_field *child;
+	size_t count = 0;
+
+	switch(blob_field_type(field)){
+		case BLOB_FIELD_INT8:
+		case BLOB_FIELD_INT16:
+		case BLOB_FIELD_INT32:
+		case BLOB_FIELD_INT64:
+			self->type = REF_INT;
+			self->u.i = blob_field_get_int(field);
+			return true;
+		case BLOB_FIELD_FLOAT32:
+		case BLOB_FIELD_FLOAT64:
+			self->type = REF_REAL;
+			self->u.d = blob_field_get_real(field);
+			return true;
+		case BLOB_FIELD_STRING: {
+			const char *str = blob_field_get_string(field);
+			size_t len = strlen(str);
+			char *copy = ref_arena_alloc(arena, len + 1);
+			if(!copy) return false;
+			memcpy(copy, str, len + 1);
+			self->type = REF_STRING;
+			self->u.str.ptr = copy;
+			self->u.str.len = len;
+			return true;
+		}
+		case BLOB_FIELD_ARRAY:
+		case BLOB_FIELD_TABLE:
+			blob_field_for_each_child(field, child) count++;
+			self->type = (blob_field_type(field) == BLOB_FIELD_TABLE) ? REF_MAP : REF_ARRAY;
+			if(self->type == REF_MAP && (count & 1)) return false;
+			self->u.list.count = (self->type == REF_MAP) ? count / 2 : count;
+			self->u.list.items = ref_arena_alloc(arena, count * sizeof(struct ref_value));
+			if(count && !self->u.list.items) return false;
+			count = 0;
+			blob_field_for_each_child(field, child){
+				if(!ref_value_from_field(&self->u.list.items[count++], child, arena)) return false;
+			}
+			return true;
+	}
+	return false;
+}
+
+bool ref_value_put(const struct ref_value *self, struct blob *blob){
+	blob_offset_t o;
+	size_t count;
+
+	switch(self->type){
+		case REF_INT: return blob_put_int(blob, self->u.i) != NULL;
+		case REF_REAL: return blob_put_real(blob, self->u.d) != NULL;
+		case REF_STRING: return blob_put_string_len(blob, self->u.str.ptr, self->u.str.len) != NULL;
+		case REF_ARRAY:
+		case REF_MAP:
+			o = (self->type == REF_MAP) ? blob_open_table(blob) : blob_open_array(blob);
+			if(!o) return false;
+			count = (self->type == REF_MAP) ? self->u.list.count * 2 : self->u.list.count;
+			for(size_t c = 0; c < count; c++){
+				if(!ref_value_put(&self->u.list.items[c], blob)) return false;
+			}
+			if(self->type == REF_MAP) blob_close_table(blob, o);
+			else blob_close_array(blob, o);
+			return true;
+	}
+	return false;
+}
+
+bool ref_value_equal(const struct ref_value *a, const struct ref_value *b){
+	size_t count;
+
+	if(a->type != b->type) return false;
+	switch(a->type){
+		case REF_INT: return a->u.i == b->u.i;
+		case REF_REAL: return a->u.d == b->u.d;
+		case REF_STRING: return a->u.str.len == b->u.str.len && memcmp(a->u.str.ptr, b->u.str.ptr, a->u.str.len) == 0;
+		case REF_ARRAY:
+		case REF_MAP:
+			if(a->u.list.count != b->u.list.count) return false;
+			count = (a->type == REF_MAP) ? a->u.list.count * 2 : a->u.list.count;
+			for(size_t c = 0; c < count; c++){
+				if(!ref_value_equal(&a->u.list.items[c], &b->u.list.items[c])) return false;
+			}
+			return true;
+	}
+	return false;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <blobpack.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// A plain tree of values that does not depend on any wire format. The formats benchmark converts
+// the generated documents into it once and encodes every format from it, and the reference
+// codecs read and write it without going through the library.
+
+enum {
+	REF_INT,
+	REF_REAL,
+	REF_STRING,
+	REF_ARRAY,
+	REF_MAP
+};
+
+struct ref_value {
+	int type;
+	union {
+		long long i;
+		double d;
+		struct {
+			const char *ptr;
+			size_t len;
+		} str;
+		// a map holds count keys and values as key, value, key, value...
+		struct {
+			struct ref_value *items;
+			size_t count;
+		} list;
+	} u;
+};
+
+// Values, strings and item arrays are allocated from an arena that is reset as a whole, the way
+// a decoder that is called in a loop would reuse its memory.
+struct ref_arena_block;
+
+struct ref_arena {
+	struct ref_arena_block *head;
+	struct ref_arena_block *cur;
+};
+
+void ref_arena_init(struct ref_arena *self);
+void *ref_arena_alloc(struct ref_arena *self, size_t size);
+void ref_arena_reset(struct ref_arena *self);
+void ref_arena_free(struct ref_arena *self);
+
+// output buffer of the reference encoders
+struct ref_buf {
+	uint8_t *data;
+	size_t len;
+	size_t size;
+	bool failed;
+};
+
+void ref_buf_init(struct ref_buf *self);
+void ref_buf_write(struct ref_buf *self, const void *data, size_t size);
+void ref_buf_free(struct ref_buf *self);
+
+// containers of the reference decoders may nest at most this deep
+#define REF_MAX_DEPTH 64
+
+// copies the field and everything below it into the arena
+bool ref_value_from_field(struct ref_value *self, const struct blob_field *field, struct ref_arena *arena);
+
+// appends the value to blob with blob_put_*
+bool ref_value_put(const struct ref_value *self, struct blob *blob);
+
+bool ref_value_equal(const struct ref_value *a, const struct ref_value *b);
@@ -0,0 +1,326 @@
+#include <blobpack.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+// Request/reply round trips through a local echo service over loopback TCP and a Unix socket,
+// for a range of connection counts and message sizes. Every connection keeps one request in
+// flight. Prints messages per second and latency percentiles as JSON. Usage: rpc [seconds per run]
+
+// the number quoted for the whole library: TCP, 8 connections, 1 KiB messages
+#define REPRESENTATIVE_CONNS 8
+#define REPRESENTATIVE_SIZE 1024
+#define MAX_CONNS 64
+
+struct run;
+
+struct server {
+	struct blob_io io;
+	pthread_t thread;
+	volatile int stop;
+	int port;
+	char path[108];
+};
+
+struct client {
+	struct run *run;
+	struct blob_io_conn *conn;
+	uint64_t sent_ns;
+	int64_t id;
+	bool busy;
+};
+
+struct run {
+	struct blob_io io;
+	struct client clients[MAX_CONNS];
+	const char *payload;
+	bool running;
+	int busy;
+	int closed;
+	// connections that could not be set up
+	int refused;
+	uint64_t messages;
+	uint64_t failed;
+	struct blob_stats_hist latency;
+};
+
+static double min_time = 0.5;
+
+static uint64_t _now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+/********************************
+** SERVER
+********************************/
+
+static void _server_request(struct blob_io_conn *conn, struct blob *blob){
+	struct server *server = blob_io_conn_user(conn);
+	struct blob_policy policy[] = {
+		{ .name = "id", .type = BLOB_FIELD_ANY },
+		{ .name = "method", .type = BLOB_FIELD_STRING },
+		{ .name = "payload", .type = BLOB_FIELD_STRING }
+	};
+	struct blob reply;
+	const struct blob_field *request = blob_field_first_child(blob_head(blob));
+	bool valid = blob_field_parse_values(request, policy, 3) && policy[0].value && policy[1].value && policy[2].value;
+	if(!blob_io_alloc(&server->io, &reply)) return;
+	blob_offset_t o = blob_open_table(&reply);
+	blob_put_string(&reply, "id");
+	blob_put_int(&reply, valid ? blob_field_get_int(policy[0].value) : -1);
+	blob_put_string(&reply, "status");
+	blob_put_string(&reply, valid ? "ok" : "invalid request");
+	if(valid){
+		blob_put_string(&reply, "result");
+		blob_put_attr(&reply, policy[2].value);
+	}
+	blob_close_table(&reply, o);
+	if(!blob_io_send(conn, &reply)) blob_io_recycle(&server->io, &reply);
+}
+
+static void _server_closed(struct blob_io_conn *conn, int error){
+}
+
+static const struct blob_io_ops server_ops = { .on_blob = _server_request, .on_close = _server_closed };
+
+static void _server_accept(struct blob_io *io, int fd, void *user){
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	if(!blob_io_add(io, fd, &server_ops, user)) close(fd);
+}
+
+static void *_server_thread(void *arg){
+	struct server *server = arg;
+	while(!server->stop) blob_io_run(&server->io, 50);
+	return NULL;
+}
+
+static bool _server_start(struct server *server){
+	struct sockaddr_in in = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+	struct sockaddr_un un = { .sun_family = AF_UNIX };
+	socklen_t len = sizeof(in);
+	memset(server, 0, sizeof(*server));
+	if(!blob_io_init(&server->io, 0, 0)) return false;
+
+	int tcp = socket(AF_INET, SOCK_STREAM, 0);
+	if(tcp < 0 || bind(tcp, (struct sockaddr*)&in, sizeof(in)) < 0 || listen(tcp, MAX_CONNS) < 0) return false;
+	if(getsockname(tcp, (struct sockaddr*)&in, &len) < 0) return false;
+	server->port = ntohs(in.sin_port);
+	if(!blob_io_listen(&server->io, tcp, _server_accept, server)) return false;
+
+	snprintf(server->path, sizeof(server->path), "/tmp/blobpack-rpc-%d", (int)getpid());
+	strcpy(un.sun_path, server->path);
+	unlink(server->path);
+	int local = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(local < 0 || bind(local, (struct sockaddr*)&un, sizeof(un)) < 0 || listen(local, MAX_CONNS) < 0) return false;
+	if(!blob_io_listen(&server->io, local, _server_accept, server)) return false;
+
+	return pthread_create(&server->thread, NULL, _server_thread, server) == 0;
+}
+
+static void _server_stop(struct server *server){
+	server->stop = 1;
+	pthread_join(server->thread, NULL);
+	blob_io_free(&server->io);
+	unlink(server->path);
+}
+
+/********************************
+** CLIENT
+********************************/
+
+static bool _client_send(struct client *client){
+	struct run *run = client->run;
+	struct blob request;
+	if(!blob_io_alloc(&run->io, &request)) return false;
+	blob_offset_t o = blob_open_table(&request);
+	blob_put_string(&request, "id");
+	blob_put_int(&request, ++client->id);
+	blob_put_string(&request, "method");
+	blob_put_string(&request, "echo");
+	blob_put_string(&request, "payload");
+	blob_put_string(&request, run->payload);
+	blob_close_table(&request, o);
+	client->sent_ns = _now();
+	if(!blob_io_send(client->conn, &request)){
+		blob_io_recycle(&run->io, &request);
+		return false;
+	}
+	client->busy = true;
+	run->busy++;
+	return true;
+}
+
+static void _client_reply(struct blob_io_conn *conn, struct blob *blob){
+	struct client *client = blob_io_conn_user(conn);
+	struct run *run = client->run;
+	uint64_t ns = _now() - client->sent_ns;
+	const struct blob_field *reply = blob_field_first_child(blob_head(blob));
+	const struct blob_field *key, *value;
+	bool ok = false;
+	blob_field_for_each_kv(reply, key, value){
+		if(strcmp(blob_field_get_string(key), "id") == 0) ok = blob_field_get_int(value) == client->id;
+	}
+	client->busy = false;
+	run->busy--;
+	// replies that come in after the timer stopped are only drained
+	if(!run->running) return;
+	if(!ok) run->failed++;
+	run->messages++;
+	blob_stats_hist_add(&run->latency, ns);
+	if(run->running) _client_send(client);
+}
+
+static void _client_closed(struct blob_io_conn *conn, int error){
+	struct client *client = blob_io_conn_user(conn);
+	if(client->busy) client->run->busy--;
+	client->busy = false;
+	client->conn = NULL;
+	client->run->closed++;
+}
+
+static const struct blob_io_ops client_ops = { .on_blob = _client_reply, .on_close = _client_closed };
+
+static int _connect(const struct server *server, bool tcp){
+	int fd;
+	if(tcp){
+		struct sockaddr_in in = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK), .sin_port = htons(server->port) };
+		int one = 1;
+		fd = socket(AF_INET, SOCK_STREAM, 0);
+		if(fd >= 0) setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+		if(fd >= 0 && connect(fd, (struct sockaddr*)&in, sizeof(in)) == 0) return fd;
+	} else {
+		struct sockaddr_un un = { .sun_family = AF_UNIX };
+		strcpy(un.sun_path, server->path);
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(fd >= 0 && connect(fd, (struct sockaddr*)&un, sizeof(un)) == 0) return fd;
+	}
+	if(fd >= 0) close(fd);
+	return -1;
+}
+
+static void _measure(struct blob *results, const struct server *server, bool tcp, int conns, size_t size, double *representative){
+	static struct run run;
+	char *payload = malloc(size + 1);
+	if(!payload) return;
+	memset(payload, 'x', size);
+	payload[size] = 0;
+
+	memset(&run, 0, sizeof(run));
+	run.payload = payload;
+	if(!blob_io_init(&run.io, 0, 0)){
+		free(payload);
+		return;
+	}
+	for(int c = 0; c < conns; c++){
+		int fd = _connect(server, tcp);
+		struct client *client = &run.clients[c];
+		client->run = &run;
+		if(fd < 0 || !(client->conn = blob_io_add(&run.io, fd, &client_ops, client))){
+			if(fd >= 0) close(fd);
+			run.refused++;
+			run.closed++;
+		}
+	}
+
+	// a short warm up that is not counted
+	run.running = true;
+	for(int c = 0; c < conns; c++) if(run.clients[c].conn) _client_send(&run.clients[c]);
+	uint64_t warmup = _now() + 50000000;
+	while(_now() < warmup && run.busy) blob_io_run(&run.io, 100);
+	run.messages = 0;
+	run.failed = 0;
+	memset(&run.latency, 0, sizeof(run.latency));
+
+	uint64_t start = _now();
+	uint64_t end = start + (uint64_t)(min_time * 1e9);
+	while(_now() < end && run.busy) blob_io_run(&run.io, 100);
+	double elapsed = (_now() - start) / 1e9;
+	run.running = false;
+	while(run.busy) if(blob_io_run(&run.io, 1000) <= 0) break;
+	for(int c = 0; c < conns; c++) if(run.clients[c].conn) blob_io_close(run.clients[c].conn);
+	while(run.closed < conns) if(blob_io_run(&run.io, 1000) < 0) break;
+	blob_io_free(&run.io);
+	free(payload);
+
+	double rate = run.messages / elapsed;
+	if(tcp && conns == REPRESENTATIVE_CONNS && size == REPRESENTATIVE_SIZE) *representative = rate;
+
+	blob_offset_t t = blob_open_table(results);
+	blob_put_string(results, "transport");
+	blob_put_string(results, tcp ? "tcp" : "unix");
+	blob_put_string(results, "connections");
+	blob_put_int(results, conns);
+	blob_put_string(results, "payload_bytes");
+	blob_put_int(results, size);
+	blob_put_string(results, "messages");
+	blob_put_int(results, run.messages);
+	blob_put_string(results, "failed");
+	blob_put_int(results, run.failed);
+	blob_put_string(results, "refused_connections");
+	blob_put_int(results, run.refused);
+	blob_put_string(results, "msgs_per_s");
+	blob_put_real(results, rate);
+	blob_put_string(results, "p50_us");
+	blob_put_real(results, blob_stats_hist_percentile(&run.latency, 50) / 1e3);
+	blob_put_string(results, "p99_us");
+	blob_put_real(results, blob_stats_hist_percentile(&run.latency, 99) / 1e3);
+	blob_put_string(results, "p99.9_us");
+	blob_put_real(results, blob_stats_hist_percentile(&run.latency, 99.9) / 1e3);
+	blob_put_string(results, "max_us");
+	blob_put_real(results, run.latency.max_ns / 1e3);
+	blob_close_table(results, t);
+}
+
+int main(int argc, char **argv){
+	static const int conns[] = { 1, 8, 64 };
+	static const size_t sizes[] = { 16, 1024, 65536 };
+	struct server server;
+	struct blob results;
+	double representative = 0;
+
+	if(argc > 1) min_time = atof(argv[1]);
+	signal(SIGPIPE, SIG_IGN);
+	if(!_server_start(&server)){
+		fprintf(stderr, "could not start the echo server\n");
+		return 1;
+	}
+
+	blob_init(&results, 0, 0);
+	blob_offset_t t = blob_open_table(&results);
+	blob_put_string(&results, "library");
+	blob_put_string(&results, "blobpack");
+#ifdef PACKAGE_VERSION
+	blob_put_string(&results, "version");
+	blob_put_string(&results, PACKAGE_VERSION);
+#endif
+	blob_put_string(&results, "results");
+	blob_offset_t a = blob_open_array(&results);
+	for(int tcp = 1; tcp >= 0; tcp--){
+		for(size_t c = 0; c < sizeof(conns) / sizeof(conns[0]); c++){
+			for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) _measure(&results, &server, tcp, conns[c], sizes[s], &representative);
+		}
+	}
+	blob_close_array(&results, a);
+	blob_put_string(&results, "representative_msgs_per_s");
+	blob_put_real(&results, representative);
+	blob_close_table(&results, t);
+	_server_stop(&server);
+
+	char *json = blob_field_to_json(blob_field_first_child(blob_head(&results)));
+	printf("%s\n", json);
+	free(json);
+	blob_free(&results);
+	return 0;
+}
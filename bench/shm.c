@@ -0,0 +1,49 @@
+#include <blobpack.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MESSAGES 500000
+#define PAYLOAD 1024
+
+static double _now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void){
+	struct blob_shm_channel ch;
+	static char payload[PAYLOAD];
+	size_t bytes = 0;
+
+	memset(payload, 'x', sizeof(payload) - 1);
+	if(!blob_shm_channel_create(&ch, NULL, 4 << 20, 0)) return 1;
+
+	pid_t pid = fork();
+	if(pid == 0){
+		struct blob blob;
+		for(int c = 0; c < MESSAGES; c++){
+			if(!blob_shm_channel_reserve(&ch, &blob, PAYLOAD + 64, -1)) _exit(1);
+			blob_put_int(&blob, c);
+			blob_put_string(&blob, payload);
+			blob_shm_channel_commit(&ch, &blob);
+		}
+		_exit(0);
+	}
+
+	double start = _now();
+	for(int c = 0; c < MESSAGES; c++){
+		const struct blob_field *msg = blob_shm_channel_peek(&ch, -1);
+		bytes += blob_field_raw_pad_len(msg);
+		blob_shm_channel_release(&ch);
+	}
+	double t = _now() - start;
+	waitpid(pid, NULL, 0);
+
+	printf("shm channel: %.2f M messages/s, %.2f GB/s (%d byte messages)\n", MESSAGES / t / 1e6, bytes / t / 1e9, PAYLOAD);
+	blob_shm_channel_close(&ch);
+	return 0;
+}
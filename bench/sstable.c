@@ -0,0 +1,73 @@
+#include <blobpack.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ENTRIES 1000000
+#define LOOKUPS 1000000
+
+static double _now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(void){
+	char path[] = "/tmp/blobpack-bench-sstable-XXXXXX";
+	int fd = mkstemp(path);
+	if(fd < 0) return 1;
+	close(fd);
+
+	struct blob blob;
+	struct blob_sstable_writer writer;
+	struct blob_sstable table;
+	char key[32];
+	blob_init(&blob, 0, 0);
+
+	double start = _now();
+	if(!blob_sstable_writer_open(&writer, path)) return 1;
+	for(int c = 0; c < ENTRIES; c++){
+		blob_reset(&blob);
+		blob_offset_t o = blob_open_table(&blob);
+		blob_put_string(&blob, "id");
+		blob_put_int(&blob, c);
+		blob_put_string(&blob, "state");
+		blob_put_string(&blob, (c & 1) ? "online" : "offline");
+		blob_put_string(&blob, "temperature");
+		blob_put_real(&blob, 20 + (c % 100) / 10.0);
+		blob_close_table(&blob, o);
+		snprintf(key, sizeof(key), "device-%010d", c);
+		if(!blob_sstable_writer_add(&writer, key, &blob)) return 1;
+	}
+	if(!blob_sstable_writer_finish(&writer)) return 1;
+	double build = _now() - start;
+
+	if(!blob_sstable_open(&table, path)) return 1;
+
+	srand(1);
+	long found = 0;
+	start = _now();
+	for(int c = 0; c < LOOKUPS; c++){
+		snprintf(key, sizeof(key), "device-%010d", rand() % ENTRIES);
+		if(blob_sstable_get(&table, key)) found++;
+	}
+	double lookup = _now() - start;
+
+	struct blob_sstable_iter iter;
+	const char *k;
+	const struct blob_field *value;
+	long scanned = 0;
+	start = _now();
+	blob_sstable_seek(&table, &iter, NULL);
+	while(blob_sstable_next(&iter, &k, &value)) scanned++;
+	double scan = _now() - start;
+
+	printf("sstable  %d entries  %zu bytes  build %.2f s  lookup %.2f us  scan %.1f M entries/s\n",
+		ENTRIES, table.size, build, lookup * 1e6 / LOOKUPS, scanned / scan / 1e6);
+
+	blob_sstable_close(&table);
+	unlink(path);
+	blob_free(&blob);
+	return found == LOOKUPS && scanned == ENTRIES ? 0 : 1;
+}
@@ -17,6 +17,9 @@
 */
 
 #include "blob.h"
+#include "blob_stats_private.h"
+#include "blob_capture_private.h"
+#include "blob_trace.h"
 #include "ieee754.h"
 
 #define pack754_32(f) (pack754((f), 32, 8))
@@ -44,15 +47,28 @@ static void blob_field_init(struct blob_field *attr, uint32_t id, uint32_t len){
 
 //! Attepts to reallocate the buffer to fit the new payload data
 bool blob_resize(struct blob *buf, uint32_t minlen){
-	assert(minlen > 0 && minlen < BLOB_MAX_SIZE); 
+	assert(minlen > 0); 
+	if(minlen >= BLOB_MAX_SIZE) return false; 
 
 	char *new = 0;
 	uint32_t newsize = ((minlen / 256) + 1) * 256;
 	uint32_t cur_size = blob_size(buf); 
+	BLOB_STATS_ADD(buf, resizes, 1); 
+	BLOB_PROBE3(blob_resize, buf, minlen, buf->memlen); 
 	// reallocate the memory of the buffer if we no longer have any memory left
-	if(newsize > buf->memlen){
+	if(buf->fixed){
+		if(minlen > buf->memlen) return false; 
+	} else if(newsize > buf->memlen){
+		// grow geometrically so that building large blobs does not copy the buffer for every field
+		if(newsize < buf->memlen * 2) newsize = buf->memlen * 2; 
+		if(newsize > BLOB_MAX_SIZE) newsize = BLOB_MAX_SIZE; 
+		uintptr_t old = (uintptr_t)buf->buf; 
 		new = realloc(buf->buf, newsize);
 		if (new) {
+			BLOB_STATS_ADD(buf, reallocs, 1); 
+			if((uintptr_t)new != old) BLOB_STATS_ADD(buf, realloc_moves, 1); 
+			BLOB_STATS_ADD(buf, bytes_memset, newsize - cur_size); 
+			BLOB_STATS_MAX(buf, peak_memlen, newsize); 
 			buf->buf = new;
 			memset((char*)buf->buf + cur_size, 0, newsize - cur_size);
 			buf->memlen = newsize;  
@@ -68,8 +84,11 @@ bool blob_resize(struct blob *buf, uint32_t minlen){
 void blob_reset(struct blob *buf){
 	assert(buf); 
 	assert(buf->buf); 
-	if(buf->memlen)
+	// fixed buffers can be large slots that are reused for every message so only the header is cleared
+	if(buf->memlen && !buf->fixed){
+		BLOB_STATS_ADD(buf, bytes_memset, buf->memlen); 
 		memset(buf->buf, 0, buf->memlen); 
+	}
 
 	blob_field_init(blob_head(buf), BLOB_FIELD_ARRAY, sizeof(struct blob_field)); 
 }
@@ -81,18 +100,32 @@ void blob_init(struct blob *buf, const char *data, size_t size){
 	buf->memlen = (size > 0)?size:256; 
 	buf->buf = malloc(buf->memlen); 
 	assert(buf->buf); 
+	BLOB_STATS_GLOBAL_MAX(peak_memlen, buf->memlen); 
 	
 	if(data) {
 		memcpy(buf->buf, data, size); 
+		if(BLOB_CAPTURE_ON() && size >= sizeof(struct blob_field) && blob_field_raw_pad_len(blob_head(buf)) <= size)
+			blob_capture_blob(blob_head(buf)); 
 		//blob_field_init(blob_head(buf), BLOB_FIELD_ARRAY, sizeof(struct blob_field)); 
 		//blob_field_fill_pad(blob_head(buf)); 
 	} else {
 		blob_reset(buf); 
 	}
+	BLOB_PROBE2(blob_init, buf, buf->memlen); 
+}
+
+void blob_init_fixed(struct blob *buf, void *mem, size_t size){
+	assert(size >= sizeof(struct blob_field)); 
+	buf->memlen = size & ~(size_t)(BLOB_FIELD_ALIGN - 1); 
+	buf->buf = mem; 
+	buf->fixed = true; 
+	buf->stats = NULL; 
+	blob_reset(buf); 
 }
 
 void blob_free(struct blob *buf){
-	free(buf->buf);
+	BLOB_PROBE2(blob_free, buf, buf->memlen); 
+	if(!buf->fixed) free(buf->buf);
 	buf->buf = NULL;
 	buf->memlen = 0;
 }
@@ -154,6 +187,20 @@ struct blob_field *blob_put_string(struct blob *buf, const char *str){
 	return blob_put(buf, BLOB_FIELD_STRING, str, strlen(str) + 1);
 }
 
+struct blob_field *blob_reserve(struct blob *buf, int type, size_t len){
+	if(len > BLOB_FIELD_LEN_MASK - sizeof(struct blob_field)) return NULL; 
+	return blob_put(buf, type, NULL, len); 
+}
+
+struct blob_field *blob_put_string_len(struct blob *buf, const char *str, size_t len){
+	if(len >= BLOB_FIELD_LEN_MASK - sizeof(struct blob_field)) return NULL; 
+	struct blob_field *attr = blob_put(buf, BLOB_FIELD_STRING, NULL, len + 1); 
+	if(!attr) return NULL; 
+	if(str) memcpy(attr->data, str, len); 
+	attr->data[len] = 0; 
+	return attr; 
+}
+
 static struct blob_field *blob_put_u8(struct blob *buf, uint8_t val){
 	return blob_put(buf, BLOB_FIELD_INT8, &val, sizeof(val));
 }
@@ -187,6 +234,7 @@ struct blob_field *blob_put_int(struct blob *self, long long val){
 
 blob_offset_t blob_open_array(struct blob *buf){
 	struct blob_field *attr = blob_new_attr(buf, BLOB_FIELD_ARRAY, 0);
+	if(!attr) return 0; 
 	return blob_field_to_offset(buf, attr);
 }
 
@@ -199,6 +247,7 @@ void blob_close_array(struct blob *buf, blob_offset_t offset){
 
 blob_offset_t blob_open_table(struct blob *buf){
 	struct blob_field *attr = blob_new_attr(buf, BLOB_FIELD_TABLE, 0);
+	if(!attr) return 0; 
 	return blob_field_to_offset(buf, attr);
 }
 
@@ -209,6 +258,16 @@ void blob_close_table(struct blob *buf, blob_offset_t offset){
 	blob_field_set_raw_len(attr, len);
 }
 
+blob_offset_t blob_open_columns(struct blob *buf){
+	struct blob_field *attr = blob_new_attr(buf, BLOB_FIELD_COLUMNS, 0);
+	if(!attr) return 0; 
+	return blob_field_to_offset(buf, attr);
+}
+
+void blob_close_columns(struct blob *buf, blob_offset_t offset){
+	blob_close_table(buf, offset); 
+}
+
 static struct blob_field *blob_put_float(struct blob *buf, double value){
 	uint32_t val = htobe32(pack754_32((float)value));  
 	return blob_put(buf, BLOB_FIELD_FLOAT32, &val, sizeof(val)); 
@@ -227,9 +286,13 @@ struct blob_field *blob_put_real(struct blob *buf, double value){
 struct blob_field *blob_put_attr(struct blob *buf, const struct blob_field *attr){
 	if(!attr) return NULL; 
 	
+	uint64_t start = blob_stats_latency_start(); 
 	size_t s =  blob_field_data_len(attr); 
 	struct blob_field *f = blob_new_attr(buf, blob_field_type(attr), s); 
+	if(!f) return NULL; 
 	memcpy(f, attr, blob_field_raw_pad_len(attr)); 
+	BLOB_STATS_ADD(buf, bytes_copied, blob_field_raw_pad_len(attr)); 
+	blob_stats_latency_end(BLOB_STATS_OP_PUT, start); 
 	return f; 
 }
 
@@ -245,7 +308,8 @@ static void __attribute__((unused)) _blob_field_dump(const struct blob_field *no
 		[BLOB_FIELD_FLOAT32] = "BLOB_FIELD_FLOAT32", 
 		[BLOB_FIELD_FLOAT64] = "BLOB_FIELD_FLOAT64",
 		[BLOB_FIELD_ARRAY] = "BLOB_FIELD_ARRAY", 
-		[BLOB_FIELD_TABLE] = "BLOB_FIELD_TABLE"
+		[BLOB_FIELD_TABLE] = "BLOB_FIELD_TABLE",
+		[BLOB_FIELD_COLUMNS] = "BLOB_FIELD_COLUMNS"
 	}; 
 
 	for(const struct blob_field *attr = blob_field_first_child(node); attr; attr = blob_field_next_child(node, attr)){
@@ -262,7 +326,7 @@ static void __attribute__((unused)) _blob_field_dump(const struct blob_field *no
 		}
 		printf(") type=%s offset=%d full padded len: %d, header+data: %d, data len: %d ]\n", names[(id < BLOB_FIELD_LAST)?id:0], (int)offset, (int)len, (int)blob_field_raw_len(attr), blob_field_data_len(attr)); 
 
-		if(id == BLOB_FIELD_ARRAY || id == BLOB_FIELD_TABLE) {
+		if(id == BLOB_FIELD_ARRAY || id == BLOB_FIELD_TABLE || id == BLOB_FIELD_COLUMNS) {
 			_blob_field_dump(attr, indent+1); 
 			continue; 
 		}
@@ -47,13 +47,18 @@ enum {
 	BLOB_FIELD_FLOAT64, // a packed 64 bit float
 	BLOB_FIELD_ARRAY, // only unnamed elements
 	BLOB_FIELD_TABLE, // only named elements
+	BLOB_FIELD_COLUMNS, // an array of tables with the same keys stored column by column (see blob_columns.h)
 	BLOB_FIELD_ANY, // to be used only as a wildcard
 	BLOB_FIELD_LAST
 };
 
+struct blob_stats; 
+
 struct blob {
 	size_t memlen; // total length of the allocated memory area 
 	void *buf; // raw buffer data
+	bool fixed; // buf belongs to the caller and is never reallocated or freed
+	struct blob_stats *stats; // extra counters for this blob (see blob_stats_attach()) or NULL
 };
 
 struct blob_policy {
@@ -64,6 +69,8 @@ struct blob_policy {
 
 //! Initializes a blob structure. Optionally takes memory area to be copied into the buffer which must represent a valid blob buf. 
 void blob_init(struct blob *buf, const char *data, size_t size);
+//! Initializes a blob that writes into size bytes of caller owned memory. The buffer never grows so writes that do not fit fail. 
+void blob_init_fixed(struct blob *buf, void *mem, size_t size);
 //! Frees the memory allocated with the buffer
 void blob_free(struct blob *buf);
 //! Resets header but does not deallocate any memory.  
@@ -101,6 +108,10 @@ void 			blob_close_array(struct blob *buf, blob_offset_t);
 blob_offset_t 	blob_open_table(struct blob *buf);
 //! closes an table element
 void 			blob_close_table(struct blob *buf, blob_offset_t);
+//! opens a columns element. Use blob_put_columns() unless you lay out the columns yourself. 
+blob_offset_t 	blob_open_columns(struct blob *buf);
+//! closes a columns element
+void 			blob_close_columns(struct blob *buf, blob_offset_t);
 
 /********************************
 ** WRITING FUNCTIONS
@@ -125,6 +136,10 @@ struct blob_field *blob_put_bool(struct blob *buf, bool val);
 //! write a string into the buffer
 struct blob_field *blob_put_string(struct blob *buf, const char *str); 
 
+//! write a string of len bytes that does not have to be null terminated. If str is NULL the
+//! string is left for the caller to fill in through the returned field.
+struct blob_field *blob_put_string_len(struct blob *buf, const char *str, size_t len); 
+
 //! write binary data into the buffer
 // NOTE: binary no longer supported because it is not representable in json and also because for binary data we actually need a whole new field type since we need to use size and our blob size is always padded. 
 // for binary use an array with integers instead
@@ -136,6 +151,9 @@ struct blob_field *blob_put_int(struct blob *buf, long long val);
 //! write a real into the buffer
 struct blob_field *blob_put_real(struct blob *buf, double value); 
 
+//! reserve a field of the given type with len bytes of data for the caller to fill in
+struct blob_field *blob_reserve(struct blob *buf, int type, size_t len); 
+
 //! write a raw attribute into the buffer
 struct blob_field *blob_put_attr(struct blob *buf, const struct blob_field *attr); 
 
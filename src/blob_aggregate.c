@@ -0,0 +1,264 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include "blob.h"
+#include "blob_aggregate.h"
+#include "blob_columns.h"
+#include "ieee754.h"
+
+// values are decoded into a block of doubles which is then reduced in one go so that neither
+// loop has to look at field types
+#define BLOB_AGGREGATE_BLOCK 256
+
+struct blob_aggregate {
+	size_t count;
+	double sum;
+	double min;
+	double max;
+	uint32_t *bins;
+	size_t nbins;
+	double lo;
+	double hi;
+	double scale;
+	size_t binned;
+	size_t len;
+	double block[BLOB_AGGREGATE_BLOCK];
+};
+
+// fields store floats as ieee 754 so on ieee hosts the bits can be used as they are
+#if defined(__GCC_IEC_559) && __GCC_IEC_559 > 0
+static inline double _agg_f32(uint32_t bits){
+	float val;
+	memcpy(&val, &bits, sizeof(val));
+	return val;
+}
+
+static inline double _agg_f64(uint64_t bits){
+	double val;
+	memcpy(&val, &bits, sizeof(val));
+	return val;
+}
+#else
+static inline double _agg_f32(uint32_t bits){ return unpack754_32(bits); }
+static inline double _agg_f64(uint64_t bits){ return unpack754_64(bits); }
+#endif
+
+static size_t _agg_width(uint8_t type){
+	switch(type){
+		case BLOB_FIELD_INT8: return 1;
+		case BLOB_FIELD_INT16: return 2;
+		case BLOB_FIELD_INT32:
+		case BLOB_FIELD_FLOAT32: return 4;
+		case BLOB_FIELD_INT64:
+		case BLOB_FIELD_FLOAT64: return 8;
+	}
+	return 0;
+}
+
+static void _agg_decode(double *out, uint8_t type, const char *p, size_t stride, size_t n){
+	uint16_t v16;
+	uint32_t v32;
+	uint64_t v64;
+
+	switch(type){
+		case BLOB_FIELD_INT8:
+			for(size_t c = 0; c < n; c++) out[c] = (int8_t)p[c * stride];
+			break;
+		case BLOB_FIELD_INT16:
+			for(size_t c = 0; c < n; c++){
+				memcpy(&v16, p + c * stride, sizeof(v16));
+				out[c] = (int16_t)be16toh(v16);
+			}
+			break;
+		case BLOB_FIELD_INT32:
+			for(size_t c = 0; c < n; c++){
+				memcpy(&v32, p + c * stride, sizeof(v32));
+				out[c] = (int32_t)be32toh(v32);
+			}
+			break;
+		case BLOB_FIELD_INT64:
+			for(size_t c = 0; c < n; c++){
+				memcpy(&v64, p + c * stride, sizeof(v64));
+				out[c] = (int64_t)be64toh(v64);
+			}
+			break;
+		case BLOB_FIELD_FLOAT32:
+			for(size_t c = 0; c < n; c++){
+				memcpy(&v32, p + c * stride, sizeof(v32));
+				out[c] = _agg_f32(be32toh(v32));
+			}
+			break;
+		case BLOB_FIELD_FLOAT64:
+			for(size_t c = 0; c < n; c++){
+				memcpy(&v64, p + c * stride, sizeof(v64));
+				out[c] = _agg_f64(be64toh(v64));
+			}
+			break;
+	}
+}
+
+static void _agg_flush(struct blob_aggregate *self){
+	const double *v = self->block;
+	size_t n = self->len, c;
+	// independent partial sums keep the additions from waiting on each other
+	double s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+	double min = self->min, max = self->max;
+
+	for(c = 0; c + 4 <= n; c += 4){
+		s0 += v[c];
+		s1 += v[c + 1];
+		s2 += v[c + 2];
+		s3 += v[c + 3];
+	}
+	for(; c < n; c++) s0 += v[c];
+	for(c = 0; c < n; c++){
+		min = (v[c] < min) ? v[c] : min;
+		max = (v[c] > max) ? v[c] : max;
+	}
+	if(self->bins){
+		for(c = 0; c < n; c++){
+			if(!(v[c] >= self->lo && v[c] <= self->hi)) continue;
+			size_t bin = (v[c] - self->lo) * self->scale;
+			if(bin >= self->nbins) bin = self->nbins - 1;
+			self->bins[bin]++;
+			self->binned++;
+		}
+	}
+
+	self->sum += (s0 + s1) + (s2 + s3);
+	self->min = min;
+	self->max = max;
+	self->count += n;
+	self->len = 0;
+}
+
+// adds n values of type that lie stride bytes apart
+static void _agg_run(struct blob_aggregate *self, uint8_t type, const char *p, size_t stride, size_t n){
+	while(n > 0){
+		size_t len = BLOB_AGGREGATE_BLOCK - self->len;
+		if(len > n) len = n;
+		_agg_decode(self->block + self->len, type, p, stride, len);
+		self->len += len;
+		p += len * stride;
+		n -= len;
+		if(self->len == BLOB_AGGREGATE_BLOCK) _agg_flush(self);
+	}
+}
+
+static void _agg_value(struct blob_aggregate *self, const struct blob_field *field){
+	uint8_t type = blob_field_type(field);
+	size_t width = _agg_width(type);
+	if(width && blob_field_data_len(field) >= width) _agg_run(self, type, blob_field_data(field), 0, 1);
+}
+
+static void _agg_children(struct blob_aggregate *self, const struct blob_field *array){
+	const char *end = (const char*)array + blob_field_raw_pad_len(array);
+	const struct blob_field *child = blob_field_first_child(array);
+
+	while(child){
+		uint8_t type = blob_field_type(child);
+		size_t width = _agg_width(type);
+		if(!width || blob_field_data_len(child) != width){
+			_agg_value(self, child);
+			child = blob_field_next_child(array, child);
+			continue;
+		}
+		// children with the same header have the same type and size so they follow each
+		// other at a fixed stride and can be decoded without looking at every header
+		const char *p = (const char*)child;
+		uint32_t header = child->id_len;
+		size_t stride = blob_field_raw_pad_len(child);
+		size_t n = 1;
+		while(p + (n + 1) * stride <= end && ((const struct blob_field*)(const void*)(p + n * stride))->id_len == header) n++;
+		_agg_run(self, type, p + sizeof(struct blob_field), stride, n);
+		child = (p + n * stride < end) ? (const struct blob_field*)(const void*)(p + n * stride) : NULL;
+	}
+}
+
+static void _agg_tables(struct blob_aggregate *self, const struct blob_field *array, const char *key){
+	const struct blob_field *table, *k, *v;
+	size_t key_len = strlen(key) + 1;
+
+	blob_field_for_each_child(array, table){
+		if(blob_field_type(table) != BLOB_FIELD_TABLE) continue;
+		blob_field_for_each_kv(table, k, v){
+			if(blob_field_data_len(k) != key_len || blob_field_type(k) != BLOB_FIELD_STRING) continue;
+			if(memcmp(blob_field_data(k), key, key_len) != 0) continue;
+			_agg_value(self, v);
+			break;
+		}
+	}
+}
+
+static bool _agg(const struct blob_field *self, const char *key, struct blob_aggregate *agg){
+	struct blob_column column;
+
+	agg->min = INFINITY;
+	agg->max = -INFINITY;
+	switch(blob_field_type(self)){
+		case BLOB_FIELD_ARRAY:
+			if(key) _agg_tables(agg, self, key);
+			else _agg_children(agg, self);
+			break;
+		case BLOB_FIELD_COLUMNS:
+			if(key && blob_columns_find(self, key, &column) && _agg_width(column.type))
+				_agg_run(agg, column.type, column.data, _agg_width(column.type), column.rows);
+			break;
+	}
+	_agg_flush(agg);
+	return agg->count > 0;
+}
+
+double blob_field_sum(const struct blob_field *self, const char *key){
+	struct blob_aggregate agg = { 0 };
+	_agg(self, key, &agg);
+	return agg.sum;
+}
+
+bool blob_field_min(const struct blob_field *self, const char *key, double *min){
+	struct blob_aggregate agg = { 0 };
+	if(!_agg(self, key, &agg)) return false;
+	*min = agg.min;
+	return true;
+}
+
+bool blob_field_max(const struct blob_field *self, const char *key, double *max){
+	struct blob_aggregate agg = { 0 };
+	if(!_agg(self, key, &agg)) return false;
+	*max = agg.max;
+	return true;
+}
+
+bool blob_field_mean(const struct blob_field *self, const char *key, double *mean){
+	struct blob_aggregate agg = { 0 };
+	if(!_agg(self, key, &agg)) return false;
+	*mean = agg.sum / agg.count;
+	return true;
+}
+
+size_t blob_field_histogram(const struct blob_field *self, const char *key, double min, double max, uint32_t *bins, size_t nbins){
+	struct blob_aggregate agg = { 0 };
+	if(!nbins || !(max > min)) return 0;
+	agg.bins = bins;
+	agg.nbins = nbins;
+	agg.lo = min;
+	agg.hi = max;
+	agg.scale = nbins / (max - min);
+	_agg(self, key, &agg);
+	return agg.binned;
+}
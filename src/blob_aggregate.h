@@ -0,0 +1,41 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "blob.h"
+
+//! Aggregates over the numbers in an array. With key set to NULL the children of the array are
+//! used, otherwise the value stored under key in every table of the array (or the key column
+//! of a columns field). Values that are not numbers are skipped and sums are computed in
+//! double precision.
+
+//! returns the sum of the values (0 if there are none)
+double blob_field_sum(const struct blob_field *self, const char *key);
+
+//! Return false if there are no values.
+bool blob_field_min(const struct blob_field *self, const char *key, double *min);
+bool blob_field_max(const struct blob_field *self, const char *key, double *max);
+bool blob_field_mean(const struct blob_field *self, const char *key, double *mean);
+
+//! Adds the values between min and max to nbins equally wide bins (max itself counts in the
+//! last bin). Bins are not cleared first so that several fields can go into one histogram.
+//! Returns the number of values that were added.
+size_t blob_field_histogram(const struct blob_field *self, const char *key, double min, double max, uint32_t *bins, size_t nbins);
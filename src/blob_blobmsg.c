@@ -0,0 +1,336 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <endian.h>
+#include "blob.h"
+#include "blob_blobmsg.h"
+#include "blob_columns.h"
+#include "ieee754.h"
+
+// layout of libubox blob_attr and blobmsg_hdr. All header fields and numbers are big endian.
+#define BLOBMSG_ATTR_EXTENDED 0x80000000
+#define BLOBMSG_ID_SHIFT 24
+#define BLOBMSG_ID_MASK 0x7f000000
+#define BLOBMSG_LEN_MASK 0x00ffffff
+#define BLOBMSG_ALIGN 4
+
+enum {
+	BLOBMSG_TYPE_UNSPEC,
+	BLOBMSG_TYPE_ARRAY,
+	BLOBMSG_TYPE_TABLE,
+	BLOBMSG_TYPE_STRING,
+	BLOBMSG_TYPE_INT64,
+	BLOBMSG_TYPE_INT32,
+	BLOBMSG_TYPE_INT16,
+	BLOBMSG_TYPE_INT8,
+	BLOBMSG_TYPE_DOUBLE
+};
+
+static inline size_t _blobmsg_pad(size_t len){
+	return (len + BLOBMSG_ALIGN - 1) & ~(size_t)(BLOBMSG_ALIGN - 1);
+}
+
+static inline uint64_t _blobmsg_get_be(const uint8_t *data, unsigned int bytes){
+	uint64_t val = 0;
+	for(unsigned int c = 0; c < bytes; c++)
+		val = (val << 8) | data[c];
+	return val;
+}
+
+static inline void _blobmsg_set_be(uint8_t *data, uint64_t val, unsigned int bytes){
+	for(unsigned int c = 0; c < bytes; c++)
+		data[bytes - 1 - c] = (uint8_t)(val >> (8 * c));
+}
+
+/********************************
+** BLOBMSG TO BLOB
+********************************/
+
+struct blobmsg_attr {
+	uint32_t id_len;
+	const char *name;
+	size_t namelen;
+	const uint8_t *data;
+	size_t len;
+};
+
+// parses the attribute at pos and returns its padded length or 0 if it is malformed
+static size_t _blobmsg_parse_attr(const uint8_t *pos, size_t avail, struct blobmsg_attr *attr){
+	if(avail < 4) return 0;
+	attr->id_len = _blobmsg_get_be(pos, 4);
+	size_t len = attr->id_len & BLOBMSG_LEN_MASK;
+	if(len < 4 || len > avail) return 0;
+
+	size_t hdrlen = 0;
+	attr->name = "";
+	attr->namelen = 0;
+	if(attr->id_len & BLOBMSG_ATTR_EXTENDED){
+		if(len < 4 + 2) return 0;
+		attr->namelen = _blobmsg_get_be(pos + 4, 2);
+		hdrlen = _blobmsg_pad(2 + attr->namelen + 1);
+		if(len < 4 + hdrlen || pos[4 + 2 + attr->namelen] != 0) return 0;
+		attr->name = (const char*)pos + 4 + 2;
+	}
+	attr->data = pos + 4 + hdrlen;
+	attr->len = len - 4 - hdrlen;
+
+	// the padding of the last attribute may lie past the end of its container
+	size_t padded = _blobmsg_pad(len);
+	return padded < avail ? padded : avail;
+}
+
+static bool _blobmsg_put_value(struct blob *b, const struct blobmsg_attr *attr, int depth);
+
+static bool _blobmsg_put_children(struct blob *b, const uint8_t *pos, size_t size, bool table, int depth){
+	struct blobmsg_attr child;
+	while(size > 0){
+		size_t used = _blobmsg_parse_attr(pos, size, &child);
+		// every member of a blobmsg container carries a name header (empty inside arrays)
+		if(!used || !(child.id_len & BLOBMSG_ATTR_EXTENDED)) return false;
+		if(table && !blob_put_string_len(b, child.name, child.namelen)) return false;
+		if(!_blobmsg_put_value(b, &child, depth + 1)) return false;
+		pos += used;
+		size -= used;
+	}
+	return true;
+}
+
+static bool _blobmsg_put_value(struct blob *b, const struct blobmsg_attr *attr, int depth){
+	blob_offset_t o;
+
+	if(depth > BLOB_BLOBMSG_MAX_DEPTH) return false;
+	switch((attr->id_len & BLOBMSG_ID_MASK) >> BLOBMSG_ID_SHIFT){
+		case BLOBMSG_TYPE_UNSPEC:
+			return blob_put_int(b, 0) != NULL;
+		case BLOBMSG_TYPE_ARRAY:
+			o = blob_open_array(b);
+			if(!_blobmsg_put_children(b, attr->data, attr->len, false, depth)) return false;
+			blob_close_array(b, o);
+			return true;
+		case BLOBMSG_TYPE_TABLE:
+			o = blob_open_table(b);
+			if(!_blobmsg_put_children(b, attr->data, attr->len, true, depth)) return false;
+			blob_close_table(b, o);
+			return true;
+		case BLOBMSG_TYPE_STRING: {
+			const uint8_t *end = memchr(attr->data, 0, attr->len);
+			if(!end) return false;
+			return blob_put_string_len(b, (const char*)attr->data, end - attr->data) != NULL;
+		}
+		case BLOBMSG_TYPE_INT64:
+			if(attr->len != 8) return false;
+			return blob_put_int(b, (int64_t)_blobmsg_get_be(attr->data, 8)) != NULL;
+		case BLOBMSG_TYPE_INT32:
+			if(attr->len != 4) return false;
+			return blob_put_int(b, (int32_t)_blobmsg_get_be(attr->data, 4)) != NULL;
+		case BLOBMSG_TYPE_INT16:
+			if(attr->len != 2) return false;
+			return blob_put_int(b, (int16_t)_blobmsg_get_be(attr->data, 2)) != NULL;
+		case BLOBMSG_TYPE_INT8:
+			if(attr->len != 1) return false;
+			return blob_put_int(b, (int8_t)attr->data[0]) != NULL;
+		case BLOBMSG_TYPE_DOUBLE:
+			if(attr->len != 8) return false;
+			return blob_put_real(b, unpack754_64(_blobmsg_get_be(attr->data, 8))) != NULL;
+	}
+	return false;
+}
+
+bool blob_from_blobmsg(struct blob *self, const void *data, size_t size){
+	struct blobmsg_attr head;
+	if(!_blobmsg_parse_attr(data, size, &head)) return false;
+	blob_offset_t o = blob_open_table(self);
+	if(!_blobmsg_put_children(self, head.data, head.len, true, 0)) return false;
+	blob_close_table(self, o);
+	return true;
+}
+
+/********************************
+** BLOB TO BLOBMSG
+********************************/
+
+// the message is written straight into the caller's buffer and container lengths are filled in when the container is closed
+struct blobmsg_writer {
+	uint8_t *buf;
+	size_t size;
+	size_t len;
+};
+
+static bool _blobmsg_reserve(struct blobmsg_writer *self, size_t len, uint8_t **out){
+	if(len > self->size - self->len) return false;
+	*out = self->buf + self->len;
+	self->len += len;
+	return true;
+}
+
+static bool _blobmsg_open(struct blobmsg_writer *self, const char *name, size_t *offset){
+	size_t namelen = strlen(name);
+	size_t hdrlen = _blobmsg_pad(2 + namelen + 1);
+	uint8_t *p;
+	if(namelen > UINT16_MAX) return false;
+	*offset = self->len;
+	if(!_blobmsg_reserve(self, 4 + hdrlen, &p)) return false;
+	memset(p, 0, 4 + hdrlen);
+	_blobmsg_set_be(p + 4, namelen, 2);
+	memcpy(p + 4 + 2, name, namelen);
+	return true;
+}
+
+static bool _blobmsg_close(struct blobmsg_writer *self, size_t offset, unsigned int type, uint32_t flags){
+	size_t len = self->len - offset;
+	uint8_t *pad;
+	if(len > BLOBMSG_LEN_MASK) return false;
+	_blobmsg_set_be(self->buf + offset, flags | ((uint32_t)type << BLOBMSG_ID_SHIFT) | len, 4);
+	if(!_blobmsg_reserve(self, _blobmsg_pad(len) - len, &pad)) return false;
+	memset(pad, 0, _blobmsg_pad(len) - len);
+	return true;
+}
+
+static bool _blobmsg_write_number(struct blobmsg_writer *self, const char *name, unsigned int type, uint64_t val, unsigned int bytes){
+	size_t offset;
+	uint8_t *p;
+	if(!_blobmsg_open(self, name, &offset) || !_blobmsg_reserve(self, bytes, &p)) return false;
+	_blobmsg_set_be(p, val, bytes);
+	return _blobmsg_close(self, offset, type, BLOBMSG_ATTR_EXTENDED);
+}
+
+static bool _blobmsg_write_field(struct blobmsg_writer *self, const char *name, const struct blob_field *field);
+
+static bool _blobmsg_write_int(struct blobmsg_writer *self, const char *name, long long val){
+	if(val >= INT32_MIN && val <= INT32_MAX)
+		return _blobmsg_write_number(self, name, BLOBMSG_TYPE_INT32, (uint32_t)val, 4);
+	return _blobmsg_write_number(self, name, BLOBMSG_TYPE_INT64, val, 8);
+}
+
+static bool _blobmsg_write_string(struct blobmsg_writer *self, const char *name, const char *str){
+	size_t offset;
+	size_t len = strlen(str) + 1;
+	uint8_t *p;
+	if(!_blobmsg_open(self, name, &offset) || !_blobmsg_reserve(self, len, &p)) return false;
+	memcpy(p, str, len);
+	return _blobmsg_close(self, offset, BLOBMSG_TYPE_STRING, BLOBMSG_ATTR_EXTENDED);
+}
+
+// columns are written out as the array of tables that they were built from
+static bool _blobmsg_write_columns(struct blobmsg_writer *self, const char *name, const struct blob_field *field){
+	const struct blob_field *key;
+	struct blob_column column;
+	uint32_t rows = blob_columns_rows(field);
+	size_t offset, table;
+	const char *col;
+	bool ok;
+
+	if(!_blobmsg_open(self, name, &offset)) return false;
+	for(uint32_t row = 0; row < rows; row++){
+		if(!_blobmsg_open(self, "", &table)) return false;
+		blob_columns_for_each_kv(field, key, column){
+			col = blob_field_get_string(key);
+			switch(column.type){
+				case BLOB_FIELD_FLOAT32:
+				case BLOB_FIELD_FLOAT64:
+					ok = _blobmsg_write_number(self, col, BLOBMSG_TYPE_DOUBLE, pack754_64(blob_column_get_real(&column, row)), 8);
+					break;
+				case BLOB_FIELD_STRING:
+					ok = _blobmsg_write_string(self, col, blob_column_get_string(&column, row));
+					break;
+				default:
+					ok = _blobmsg_write_int(self, col, blob_column_get_int(&column, row));
+					break;
+			}
+			if(!ok) return false;
+		}
+		if(!_blobmsg_close(self, table, BLOBMSG_TYPE_TABLE, BLOBMSG_ATTR_EXTENDED)) return false;
+	}
+	return _blobmsg_close(self, offset, BLOBMSG_TYPE_ARRAY, BLOBMSG_ATTR_EXTENDED);
+}
+
+static bool _blobmsg_write_children(struct blobmsg_writer *self, const struct blob_field *field, bool table){
+	const struct blob_field *child;
+	if(!table){
+		blob_field_for_each_child(field, child){
+			if(!_blobmsg_write_field(self, "", child)) return false;
+		}
+		return true;
+	}
+	for(child = blob_field_first_child(field); child; ){
+		const struct blob_field *value = blob_field_next_child(field, child);
+		if(!_blobmsg_write_field(self, blob_field_get_string(child), value)) return false;
+		if(!value) break;
+		child = blob_field_next_child(field, value);
+	}
+	return true;
+}
+
+static bool _blobmsg_has_string_keys(const struct blob_field *field){
+	const struct blob_field *child;
+	bool key = true;
+	blob_field_for_each_child(field, child){
+		if(key && blob_field_type(child) != BLOB_FIELD_STRING) return false;
+		key = !key;
+	}
+	return true;
+}
+
+static bool _blobmsg_write_field(struct blobmsg_writer *self, const char *name, const struct blob_field *field){
+	size_t offset;
+	uint8_t *p;
+
+	// a table key without a value
+	if(!field){
+		if(!_blobmsg_open(self, name, &offset)) return false;
+		return _blobmsg_close(self, offset, BLOBMSG_TYPE_UNSPEC, BLOBMSG_ATTR_EXTENDED);
+	}
+
+	switch(blob_field_type(field)){
+		case BLOB_FIELD_INT8:
+		case BLOB_FIELD_INT16:
+		case BLOB_FIELD_INT32:
+		case BLOB_FIELD_INT64:
+			return _blobmsg_write_int(self, name, blob_field_get_int(field));
+		case BLOB_FIELD_FLOAT32:
+			return _blobmsg_write_number(self, name, BLOBMSG_TYPE_DOUBLE, pack754_64(blob_field_get_real(field)), 8);
+		case BLOB_FIELD_FLOAT64:
+			// already stored as a big endian ieee 754 double
+			if(!_blobmsg_open(self, name, &offset) || !_blobmsg_reserve(self, 8, &p)) return false;
+			memcpy(p, blob_field_data(field), 8);
+			return _blobmsg_close(self, offset, BLOBMSG_TYPE_DOUBLE, BLOBMSG_ATTR_EXTENDED);
+		case BLOB_FIELD_STRING:
+			return _blobmsg_write_string(self, name, blob_field_get_string(field));
+		case BLOB_FIELD_ARRAY:
+		case BLOB_FIELD_TABLE: {
+			bool table = blob_field_type(field) == BLOB_FIELD_TABLE && _blobmsg_has_string_keys(field);
+			if(!_blobmsg_open(self, name, &offset) || !_blobmsg_write_children(self, field, table)) return false;
+			return _blobmsg_close(self, offset, table ? BLOBMSG_TYPE_TABLE : BLOBMSG_TYPE_ARRAY, BLOBMSG_ATTR_EXTENDED);
+		}
+		case BLOB_FIELD_COLUMNS:
+			return _blobmsg_write_columns(self, name, field);
+	}
+	if(!_blobmsg_open(self, name, &offset)) return false;
+	return _blobmsg_close(self, offset, BLOBMSG_TYPE_UNSPEC, BLOBMSG_ATTR_EXTENDED);
+}
+
+size_t blob_to_blobmsg(const struct blob_field *self, void *buf, size_t size){
+	struct blobmsg_writer w = { .buf = buf, .size = size, .len = 0 };
+	uint8_t *head;
+
+	if(blob_field_type(self) != BLOB_FIELD_TABLE || !_blobmsg_has_string_keys(self)) return 0;
+	// the message head is a plain blob_attr with id 0 like the one blob_buf_init creates
+	if(!_blobmsg_reserve(&w, 4, &head)) return 0;
+	if(!_blobmsg_write_children(&w, self, true)) return 0;
+	if(!_blobmsg_close(&w, 0, BLOBMSG_TYPE_UNSPEC, 0)) return 0;
+	return w.len;
+}
@@ -0,0 +1,37 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "blob.h"
+
+//! maximum nesting of blobmsg tables and arrays accepted by blob_from_blobmsg
+#define BLOB_BLOBMSG_MAX_DEPTH 1024
+
+//! Converts a libubox blobmsg message into a table in the blob. data points at the message
+//! head (the struct blob_attr that ubus hands to method handlers) and size limits how much of
+//! it may be read. Integers keep their value, doubles become reals and unspec becomes 0 like
+//! json null. Returns false if the message is malformed or uses an unknown type.
+bool blob_from_blobmsg(struct blob *self, const void *data, size_t size);
+
+//! Writes a table field as a libubox blobmsg message into buf. Integers become INT32 when they
+//! fit and INT64 otherwise (as blobmsg_add_json does), reals become DOUBLE and tables whose keys
+//! are not all strings become ARRAY. Returns the length of the message or 0 if the field is not
+//! a table or the message does not fit into size bytes.
+size_t blob_to_blobmsg(const struct blob_field *self, void *buf, size_t size);
@@ -0,0 +1,217 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "blob.h"
+#include "blob_canonical.h"
+
+/********************************
+** CANONICAL FORM
+********************************/
+
+// tables with up to this many keys are sorted without allocating
+#define BLOB_CANONICAL_STACK_KEYS 32
+
+struct blob_canonical_kv {
+	const struct blob_field *key;
+	const struct blob_field *value;
+};
+
+static int _canonical_compare(const void *a, const void *b){
+	const struct blob_canonical_kv *x = a, *y = b;
+	int ret = strcmp(blob_field_data(x->key), blob_field_data(y->key));
+	if(ret) return ret;
+	// fields lie in buffer order so this keeps duplicate keys in place
+	return (x->key > y->key) - (x->key < y->key);
+}
+
+static bool _canonical_children(struct blob *buf, const struct blob_field *field){
+	const struct blob_field *child;
+	blob_field_for_each_child(field, child){
+		if(!blob_put_canonical(buf, child)) return false;
+	}
+	return true;
+}
+
+// copies the key value pairs of field in key order and returns false if buf could not grow
+static bool _canonical_pairs(struct blob *buf, const struct blob_field *field, bool canonical_values){
+	struct blob_canonical_kv stack[BLOB_CANONICAL_STACK_KEYS], *pairs = stack;
+	const struct blob_field *key, *value, *last = NULL;
+	size_t count = 0, c;
+	bool ret = true;
+
+	blob_field_for_each_kv(field, key, value){
+		// keys that are not strings can not be ordered so the table is kept as it is
+		if(blob_field_type(key) != BLOB_FIELD_STRING) return _canonical_children(buf, field);
+		count++;
+	}
+	if(count > BLOB_CANONICAL_STACK_KEYS && !(pairs = malloc(count * sizeof(*pairs)))) return false;
+
+	c = 0;
+	blob_field_for_each_kv(field, key, value){
+		pairs[c].key = key;
+		pairs[c].value = value;
+		last = value;
+		c++;
+	}
+	qsort(pairs, count, sizeof(*pairs), _canonical_compare);
+
+	for(c = 0; c < count && ret; c++){
+		ret = blob_put_attr(buf, pairs[c].key) != NULL;
+		if(ret) ret = (canonical_values ? blob_put_canonical(buf, pairs[c].value) : blob_put_attr(buf, pairs[c].value)) != NULL;
+	}
+	// a key without a value stays at the end
+	key = last ? blob_field_next_child(field, last) : blob_field_first_child(field);
+	if(ret && key) ret = blob_put_canonical(buf, key) != NULL;
+
+	if(pairs != stack) free(pairs);
+	return ret;
+}
+
+struct blob_field *blob_put_canonical(struct blob *buf, const struct blob_field *field){
+	blob_offset_t offset;
+	bool ret;
+
+	switch(blob_field_type(field)){
+		case BLOB_FIELD_INT8:
+		case BLOB_FIELD_INT16:
+		case BLOB_FIELD_INT32:
+		case BLOB_FIELD_INT64:
+			return blob_put_int(buf, blob_field_get_int(field));
+		case BLOB_FIELD_FLOAT32:
+		case BLOB_FIELD_FLOAT64:
+			return blob_put_real(buf, blob_field_get_real(field));
+		case BLOB_FIELD_ARRAY:
+			offset = blob_open_array(buf);
+			if(!offset) return NULL;
+			ret = _canonical_children(buf, field);
+			blob_close_array(buf, offset);
+			break;
+		case BLOB_FIELD_TABLE:
+			offset = blob_open_table(buf);
+			if(!offset) return NULL;
+			ret = _canonical_pairs(buf, field, true);
+			blob_close_table(buf, offset);
+			break;
+		case BLOB_FIELD_COLUMNS:
+			// the column types already depend only on the values
+			offset = blob_open_columns(buf);
+			if(!offset) return NULL;
+			ret = _canonical_pairs(buf, field, false);
+			blob_close_columns(buf, offset);
+			break;
+		default:
+			return blob_put_attr(buf, field);
+	}
+	if(!ret) return NULL;
+	return (struct blob_field*)(void*)((char*)buf->buf + (size_t)offset);
+}
+
+bool blob_canonicalize(struct blob *self, const struct blob *src){
+	blob_reset(self);
+	return _canonical_children(self, blob_head_const(src));
+}
+
+/********************************
+** HASHING
+********************************/
+
+#define XXH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3 0x165667B19E3779F9ULL
+#define XXH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static inline uint64_t _xxh_rotl(uint64_t x, int r){
+	return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t _xxh_read64(const unsigned char *p){
+	uint64_t val;
+	memcpy(&val, p, sizeof(val));
+	return le64toh(val);
+}
+
+static inline uint32_t _xxh_read32(const unsigned char *p){
+	uint32_t val;
+	memcpy(&val, p, sizeof(val));
+	return le32toh(val);
+}
+
+static inline uint64_t _xxh_round(uint64_t acc, uint64_t input){
+	acc += input * XXH_PRIME64_2;
+	acc = _xxh_rotl(acc, 31);
+	return acc * XXH_PRIME64_1;
+}
+
+static inline uint64_t _xxh_merge(uint64_t acc, uint64_t val){
+	acc ^= _xxh_round(0, val);
+	return acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+static uint64_t _xxh64(const void *data, size_t len, uint64_t seed){
+	const unsigned char *p = data, *end = p + len;
+	uint64_t h;
+
+	if(len >= 32){
+		// four independent lanes over 32 byte stripes
+		uint64_t v1 = seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+		uint64_t v2 = seed + XXH_PRIME64_2;
+		uint64_t v3 = seed;
+		uint64_t v4 = seed - XXH_PRIME64_1;
+		do {
+			v1 = _xxh_round(v1, _xxh_read64(p));
+			v2 = _xxh_round(v2, _xxh_read64(p + 8));
+			v3 = _xxh_round(v3, _xxh_read64(p + 16));
+			v4 = _xxh_round(v4, _xxh_read64(p + 24));
+			p += 32;
+		} while(end - p >= 32);
+		h = _xxh_rotl(v1, 1) + _xxh_rotl(v2, 7) + _xxh_rotl(v3, 12) + _xxh_rotl(v4, 18);
+		h = _xxh_merge(h, v1);
+		h = _xxh_merge(h, v2);
+		h = _xxh_merge(h, v3);
+		h = _xxh_merge(h, v4);
+	} else {
+		h = seed + XXH_PRIME64_5;
+	}
+	h += len;
+
+	for(; end - p >= 8; p += 8){
+		h ^= _xxh_round(0, _xxh_read64(p));
+		h = _xxh_rotl(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+	}
+	if(end - p >= 4){
+		h ^= (uint64_t)_xxh_read32(p) * XXH_PRIME64_1;
+		h = _xxh_rotl(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+		p += 4;
+	}
+	for(; p < end; p++){
+		h ^= *p * XXH_PRIME64_5;
+		h = _xxh_rotl(h, 11) * XXH_PRIME64_1;
+	}
+
+	h ^= h >> 33;
+	h *= XXH_PRIME64_2;
+	h ^= h >> 29;
+	h *= XXH_PRIME64_3;
+	h ^= h >> 32;
+	return h;
+}
+
+uint64_t blob_field_hash64(const struct blob_field *self){
+	if(!self) return _xxh64("", 0, 0);
+	return _xxh64(self, blob_field_raw_pad_len(self), 0);
+}
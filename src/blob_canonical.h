@@ -0,0 +1,37 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "blob.h"
+
+//! Writes the canonical form of field into buf. Two fields that hold the same data have the
+//! same canonical form: table keys are sorted (bytewise like strcmp, keeping the order of
+//! duplicate keys), ints use the smallest width that holds them and reals that a float holds
+//! exactly are stored as FLOAT32. Returns the new field or NULL if buf could not grow.
+struct blob_field *blob_put_canonical(struct blob *buf, const struct blob_field *field);
+
+//! Replaces the contents of self with the canonical form of the fields in src (which must be
+//! another blob).
+bool blob_canonicalize(struct blob *self, const struct blob *src);
+
+//! Returns a 64 bit hash (xxh64) of the field bytes. Fields that are blob_field_equal() hash to
+//! the same value. Canonicalize fields first to get equal hashes for equal data.
+uint64_t blob_field_hash64(const struct blob_field *self);
@@ -0,0 +1,236 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// secure_getenv
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "blob.h"
+#include "blob_capture.h"
+#include "blob_capture_private.h"
+#include "blob_json.h"
+#include "blob_log.h"
+#include "blob_trace.h"
+
+#ifdef HAVE_UNISTD_H
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+// parse_values gets at most this many keys when the policy is made from the capture
+#define BLOB_REPLAY_MAX_POLICY 32
+
+int blob_capture_active;
+
+static struct {
+	struct blob_log log;
+	struct blob record;
+	uint64_t start;
+} _capture;
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+static pthread_mutex_t _capture_lock = PTHREAD_MUTEX_INITIALIZER;
+#define _capture_lock() pthread_mutex_lock(&_capture_lock)
+#define _capture_unlock() pthread_mutex_unlock(&_capture_lock)
+#else
+#define _capture_lock() do { } while(0)
+#define _capture_unlock() do { } while(0)
+#endif
+
+/********************************
+** CAPTURE
+********************************/
+
+bool blob_capture_start(const char *path){
+	bool ok = false;
+	_capture_lock();
+	if(!blob_capture_active && blob_log_open(&_capture.log, path, BLOB_LOG_TRUNCATE)){
+		blob_init(&_capture.record, NULL, 0);
+		_capture.start = blob_trace_now();
+		__atomic_store_n(&blob_capture_active, 1, __ATOMIC_RELAXED);
+		ok = true;
+	}
+	_capture_unlock();
+	return ok;
+}
+
+void blob_capture_stop(void){
+	_capture_lock();
+	if(blob_capture_active){
+		__atomic_store_n(&blob_capture_active, 0, __ATOMIC_RELAXED);
+		blob_log_close(&_capture.log);
+		blob_free(&_capture.record);
+	}
+	_capture_unlock();
+}
+
+static __attribute__((constructor)) void _capture_from_env(void){
+	// a setuid program must not write to a file named by whoever started it
+#ifdef HAVE_SECURE_GETENV
+	const char *path = secure_getenv("BLOBPACK_CAPTURE");
+#else
+	const char *path = (getuid() == geteuid() && getgid() == getegid()) ? getenv("BLOBPACK_CAPTURE") : NULL;
+#endif
+	if(path && *path) blob_capture_start(path);
+}
+
+// builds the record with the payload put by the caller and appends it. A capture that can not be
+// written any more (full disk) is stopped rather than failing the application.
+#define _capture_record(kind, put_payload) do { \
+	_capture_lock(); \
+	if(blob_capture_active){ \
+		struct blob *rec = &_capture.record; \
+		blob_reset(rec); \
+		blob_put_int(rec, kind); \
+		blob_put_int(rec, blob_trace_now() - _capture.start); \
+		if(!(put_payload) || !blob_log_append(&_capture.log, blob_head(rec), NULL)){ \
+			__atomic_store_n(&blob_capture_active, 0, __ATOMIC_RELAXED); \
+			blob_log_close(&_capture.log); \
+			blob_free(&_capture.record); \
+		} \
+	} \
+	_capture_unlock(); \
+} while(0)
+
+void blob_capture_json(const char *json, size_t len){
+	_capture_record(BLOB_CAPTURE_JSON, blob_put_string_len(rec, json, len));
+}
+
+void blob_capture_blob(const struct blob_field *field){
+	_capture_record(BLOB_CAPTURE_BLOB, blob_put_attr(rec, field));
+}
+
+/********************************
+** REPLAY
+********************************/
+
+static void _replay_wait(uint64_t until){
+	struct timespec ts = { .tv_sec = until / 1000000000u, .tv_nsec = until % 1000000000u };
+	while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR);
+}
+
+// the record is [kind, ns, payload]
+static bool _replay_record(const struct blob_field *record, long long *kind, uint64_t *ns, const struct blob_field **payload){
+	const struct blob_field *k = blob_field_first_child(record);
+	const struct blob_field *t = blob_field_next_child(record, k);
+	*payload = blob_field_next_child(record, t);
+	if(!*payload) return false;
+	*kind = blob_field_get_int(k);
+	*ns = blob_field_get_int(t);
+	return true;
+}
+
+// decodes the payload into doc and returns the document
+static const struct blob_field *_replay_decode(struct blob *doc, long long kind, const struct blob_field *payload){
+	if(kind == BLOB_CAPTURE_JSON){
+		blob_reset(doc);
+		if(!blob_put_json(doc, blob_field_get_string(payload))) return NULL;
+	} else if(kind == BLOB_CAPTURE_BLOB){
+		// decoding a blob means copying it into a blob of its own like a receiver does
+		blob_free(doc);
+		blob_init(doc, (const char*)payload, blob_field_raw_pad_len(payload));
+	} else {
+		return NULL;
+	}
+	return blob_field_first_child(blob_head(doc));
+}
+
+static int _replay_policy(struct blob_log *log, struct blob *doc, struct blob_policy *policy){
+	const struct blob_field *record, *payload, *root, *key, *value;
+	uint64_t offset = 0, ns;
+	long long kind;
+	int count = 0;
+	while((record = blob_log_next(log, &offset)) != NULL){
+		if(!_replay_record(record, &kind, &ns, &payload) || !(root = _replay_decode(doc, kind, payload))) continue;
+		if(blob_field_type(root) != BLOB_FIELD_TABLE) continue;
+		blob_field_for_each_kv(root, key, value){
+			if(count == BLOB_REPLAY_MAX_POLICY) break;
+			// the names must outlive doc, which is decoded into again for every record
+			policy[count].name = strdup(blob_field_get_string(key));
+			policy[count].type = BLOB_FIELD_ANY;
+			if(policy[count].name) count++;
+		}
+		break;
+	}
+	return count;
+}
+
+bool blob_capture_replay(const char *path, const struct blob_replay_options *options, struct blob_replay_result *result){
+	struct blob_log log;
+	struct blob doc;
+	struct blob_policy auto_policy[BLOB_REPLAY_MAX_POLICY];
+	struct blob_policy *policy = options->policy;
+	int policy_size = options->policy_size;
+	const struct blob_field *record, *payload, *root;
+	uint64_t offset = 0, ns;
+	long long kind;
+
+	memset(result, 0, sizeof(*result));
+	if(!blob_log_open(&log, path, BLOB_LOG_RDONLY)) return false;
+	blob_init(&doc, NULL, 0);
+	if(!policy){
+		policy = auto_policy;
+		policy_size = _replay_policy(&log, &doc, auto_policy);
+	}
+
+	uint64_t start = blob_trace_now();
+	while((record = blob_log_next(&log, &offset)) != NULL){
+		if(!_replay_record(record, &kind, &ns, &payload)) continue;
+		if(options->flags & BLOB_REPLAY_TIMED) _replay_wait(start + ns);
+
+		uint64_t begin = blob_trace_now();
+		result->records++;
+		result->bytes += (kind == BLOB_CAPTURE_JSON) ? strlen(blob_field_get_string(payload)) : blob_field_raw_pad_len(payload);
+		if(!(root = _replay_decode(&doc, kind, payload))){
+			result->failed++;
+			continue;
+		}
+		const char *signature = options->signature;
+		if(!signature) signature = (blob_field_type(root) == BLOB_FIELD_TABLE) ? "t" : "a";
+		if(!blob_field_validate(blob_head(&doc), signature)){
+			result->invalid++;
+		} else {
+			for(int c = 0; c < policy_size; c++) policy[c].value = NULL;
+			blob_field_parse_values(root, policy, policy_size);
+			free(blob_field_to_json(root));
+		}
+		blob_stats_hist_add(&result->latency, blob_trace_now() - begin);
+	}
+	result->elapsed_ns = blob_trace_now() - start;
+
+	if(policy == auto_policy) for(int c = 0; c < policy_size; c++) free((void*)(uintptr_t)auto_policy[c].name);
+	blob_free(&doc);
+	blob_log_close(&log);
+	return true;
+}
+#else
+bool blob_capture_start(const char *path){
+	return false;
+}
+
+void blob_capture_stop(void){
+}
+
+bool blob_capture_replay(const char *path, const struct blob_replay_options *options, struct blob_replay_result *result){
+	memset(result, 0, sizeof(*result));
+	return false;
+}
+#endif
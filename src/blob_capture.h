@@ -0,0 +1,75 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "blob.h"
+#include "blob_stats.h"
+
+//! A capture file is a blob log (see blob_log.h) with one record per captured input: an array of
+//! the kind, the time in ns since the capture started and the input itself, which is the JSON
+//! text as a string for BLOB_CAPTURE_JSON and the blob as a field for BLOB_CAPTURE_BLOB.
+#define BLOB_CAPTURE_JSON 1
+#define BLOB_CAPTURE_BLOB 2
+
+//! Starts capturing every input of the process into the file at path, which is truncated:
+//! the text passed to blob_put_json(), blob_put_json_projected() and blob_put_json_from_file(),
+//! the data that blobs are created from with blob_init() and the frames read by blob_io.
+//! Setting BLOBPACK_CAPTURE to a path in the environment starts a capture when the library is
+//! loaded (not in setuid or setgid programs). Returns false if the file can not be opened, path
+//! is a symlink or a capture is already running.
+bool blob_capture_start(const char *path);
+
+//! Stops the capture and closes the file.
+void blob_capture_stop(void);
+
+//! replay the inputs as fast as possible (the default) or at the pace they were captured
+#define BLOB_REPLAY_TIMED (1 << 0)
+
+struct blob_replay_options {
+	unsigned int flags;
+	//! signature for blob_field_validate(). If it is NULL only the type of the document
+	//! ("t" or "a") is validated.
+	const char *signature;
+	//! policy for blob_field_parse_values(). If it is NULL a policy that matches any value is
+	//! made from the keys of the first table in the capture.
+	struct blob_policy *policy;
+	int policy_size;
+};
+
+struct blob_replay_result {
+	uint64_t records;
+	//! bytes of JSON text and blob data that were replayed
+	uint64_t bytes;
+	//! records that could not be decoded
+	uint64_t failed;
+	//! records that did not pass validation
+	uint64_t invalid;
+	//! wall clock time of the whole replay
+	uint64_t elapsed_ns;
+	//! time each record took through decode, validate, parse_values and JSON encode
+	struct blob_stats_hist latency;
+};
+
+//! Runs every record of the capture at path through the pipeline of a typical service: it is
+//! decoded (blob_put_json() or blob_init() from the blob data), validated, its values are
+//! picked with blob_field_parse_values() and it is encoded to JSON. Returns false if the capture
+//! can not be opened.
+bool blob_capture_replay(const char *path, const struct blob_replay_options *options, struct blob_replay_result *result);
@@ -0,0 +1,34 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stddef.h>
+#include "blob.h"
+
+#ifdef HAVE_UNISTD_H
+extern int blob_capture_active __attribute__((visibility("hidden")));
+void blob_capture_json(const char *json, size_t len) __attribute__((visibility("hidden")));
+void blob_capture_blob(const struct blob_field *field) __attribute__((visibility("hidden")));
+
+#define BLOB_CAPTURE_ON() __builtin_expect(__atomic_load_n(&blob_capture_active, __ATOMIC_RELAXED), 0)
+#else
+#define BLOB_CAPTURE_ON() 0
+static inline void blob_capture_json(const char *json, size_t len){}
+static inline void blob_capture_blob(const struct blob_field *field){}
+#endif
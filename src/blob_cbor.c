@@ -0,0 +1,399 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <math.h>
+#include "blob.h"
+#include "blob_cbor.h"
+#include "blob_columns.h"
+#include "ieee754.h"
+
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_BYTES 2
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_TAG 6
+#define CBOR_SIMPLE 7
+
+#define CBOR_INDEFINITE 31
+#define CBOR_BREAK 0xff
+
+/********************************
+** DECODING
+********************************/
+
+struct cbor_reader {
+	const uint8_t *pos;
+	const uint8_t *end;
+};
+
+struct cbor_head {
+	uint8_t major;
+	uint8_t info;
+	uint64_t arg;
+};
+
+static inline bool _cbor_read(struct cbor_reader *self, size_t size, const uint8_t **out){
+	if((size_t)(self->end - self->pos) < size) return false;
+	*out = self->pos;
+	self->pos += size;
+	return true;
+}
+
+static bool _cbor_read_head(struct cbor_reader *self, struct cbor_head *head){
+	const uint8_t *p;
+	if(!_cbor_read(self, 1, &p)) return false;
+	head->major = *p >> 5;
+	head->info = *p & 0x1f;
+	head->arg = head->info;
+	if(head->info < 24 || head->info == CBOR_INDEFINITE) return true;
+	if(head->info > 27) return false;
+
+	unsigned int bytes = 1 << (head->info - 24);
+	if(!_cbor_read(self, bytes, &p)) return false;
+	head->arg = 0;
+	for(unsigned int c = 0; c < bytes; c++)
+		head->arg = (head->arg << 8) | p[c];
+	return true;
+}
+
+static inline bool _cbor_at_break(struct cbor_reader *self){
+	if(self->pos < self->end && *self->pos == CBOR_BREAK){
+		self->pos++;
+		return true;
+	}
+	return false;
+}
+
+static double _cbor_half_to_double(uint16_t half){
+	int exp = (half >> 10) & 0x1f;
+	int mant = half & 0x3ff;
+	double val;
+	if(exp == 0) val = ldexp(mant, -24);
+	else if(exp != 31) val = ldexp(mant + 1024, exp - 25);
+	else val = mant == 0 ? INFINITY : NAN;
+	return (half & 0x8000) ? -val : val;
+}
+
+// chunks of an indefinite length string must be definite strings of the same major type
+static bool _cbor_next_chunk(struct cbor_reader *r, uint8_t major, const uint8_t **data, uint64_t *len){
+	struct cbor_head head;
+	if(!_cbor_read_head(r, &head) || head.major != major || head.info == CBOR_INDEFINITE) return false;
+	*len = head.arg;
+	return _cbor_read(r, head.arg, data);
+}
+
+static bool _cbor_put_text(struct blob *b, struct cbor_reader *r, const struct cbor_head *head){
+	const uint8_t *data;
+	uint64_t len;
+
+	if(head->info != CBOR_INDEFINITE){
+		if(!_cbor_read(r, head->arg, &data)) return false;
+		// blob strings are null terminated so they can not hold a null byte
+		if(memchr(data, 0, head->arg)) return false;
+		return blob_put_string_len(b, (const char*)data, head->arg) != NULL;
+	}
+
+	// measure the chunks first and then copy them into one string field
+	struct cbor_reader scan = *r;
+	uint64_t total = 0;
+	while(!_cbor_at_break(&scan)){
+		if(!_cbor_next_chunk(&scan, CBOR_TEXT, &data, &len)) return false;
+		if(memchr(data, 0, len)) return false;
+		total += len;
+	}
+	struct blob_field *field = blob_put_string_len(b, NULL, total);
+	if(!field) return false;
+	char *out = field->data;
+	while(!_cbor_at_break(r)){
+		if(!_cbor_next_chunk(r, CBOR_TEXT, &data, &len)) return false;
+		memcpy(out, data, len);
+		out += len;
+	}
+	return true;
+}
+
+static bool _cbor_put_bytes(struct blob *b, struct cbor_reader *r, const struct cbor_head *head){
+	const uint8_t *data;
+	uint64_t len;
+
+	blob_offset_t o = blob_open_array(b);
+	if(head->info != CBOR_INDEFINITE){
+		if(!_cbor_read(r, head->arg, &data)) return false;
+		for(uint64_t c = 0; c < head->arg; c++){
+			if(!blob_put_int(b, data[c])) return false;
+		}
+	} else {
+		while(!_cbor_at_break(r)){
+			if(!_cbor_next_chunk(r, CBOR_BYTES, &data, &len)) return false;
+			for(uint64_t c = 0; c < len; c++){
+				if(!blob_put_int(b, data[c])) return false;
+			}
+		}
+	}
+	blob_close_array(b, o);
+	return true;
+}
+
+static bool _cbor_put_item(struct blob *b, struct cbor_reader *r, int depth);
+
+static bool _cbor_put_array(struct blob *b, struct cbor_reader *r, const struct cbor_head *head, int depth){
+	blob_offset_t o = blob_open_array(b);
+	if(head->info == CBOR_INDEFINITE){
+		while(!_cbor_at_break(r)){
+			if(!_cbor_put_item(b, r, depth + 1)) return false;
+		}
+	} else {
+		// every item takes at least one byte
+		if(head->arg > (uint64_t)(r->end - r->pos)) return false;
+		for(uint64_t c = 0; c < head->arg; c++){
+			if(!_cbor_put_item(b, r, depth + 1)) return false;
+		}
+	}
+	blob_close_array(b, o);
+	return true;
+}
+
+static bool _cbor_put_member(struct blob *b, struct cbor_reader *r, int depth){
+	// blob tables only have string keys
+	if(r->pos == r->end || (*r->pos >> 5) != CBOR_TEXT) return false;
+	return _cbor_put_item(b, r, depth + 1) && _cbor_put_item(b, r, depth + 1);
+}
+
+static bool _cbor_put_map(struct blob *b, struct cbor_reader *r, const struct cbor_head *head, int depth){
+	blob_offset_t o = blob_open_table(b);
+	if(head->info == CBOR_INDEFINITE){
+		while(!_cbor_at_break(r)){
+			if(!_cbor_put_member(b, r, depth)) return false;
+		}
+	} else {
+		if(head->arg > (uint64_t)(r->end - r->pos) / 2) return false;
+		for(uint64_t c = 0; c < head->arg; c++){
+			if(!_cbor_put_member(b, r, depth)) return false;
+		}
+	}
+	blob_close_table(b, o);
+	return true;
+}
+
+static bool _cbor_put_simple(struct blob *b, const struct cbor_head *head){
+	switch(head->info){
+		case 20: return blob_put_bool(b, false) != NULL;
+		case 21: return blob_put_bool(b, true) != NULL;
+		case 22:
+		case 23: return blob_put_int(b, 0) != NULL;
+		case 25: return blob_put_real(b, _cbor_half_to_double(head->arg)) != NULL;
+		case 26: return blob_put_real(b, unpack754_32(head->arg)) != NULL;
+		case 27: return blob_put_real(b, unpack754_64(head->arg)) != NULL;
+	}
+	// unassigned simple values and a break outside of an indefinite item
+	return false;
+}
+
+static bool _cbor_put_item(struct blob *b, struct cbor_reader *r, int depth){
+	struct cbor_head head;
+
+	if(depth > BLOB_CBOR_MAX_DEPTH) return false;
+	if(!_cbor_read_head(r, &head)) return false;
+	if(head.info == CBOR_INDEFINITE && (head.major < CBOR_BYTES || head.major == CBOR_TAG))
+		return false;
+
+	switch(head.major){
+		case CBOR_UINT:
+			if(head.arg > INT64_MAX) return false;
+			return blob_put_int(b, (long long)head.arg) != NULL;
+		case CBOR_NEGINT:
+			if(head.arg > INT64_MAX) return false;
+			return blob_put_int(b, -1 - (long long)head.arg) != NULL;
+		case CBOR_BYTES: return _cbor_put_bytes(b, r, &head);
+		case CBOR_TEXT: return _cbor_put_text(b, r, &head);
+		case CBOR_ARRAY: return _cbor_put_array(b, r, &head, depth);
+		case CBOR_MAP: return _cbor_put_map(b, r, &head, depth);
+		case CBOR_TAG: return _cbor_put_item(b, r, depth + 1);
+	}
+	return _cbor_put_simple(b, &head);
+}
+
+bool blob_put_cbor(struct blob *self, const void *data, size_t size){
+	struct cbor_reader r = { .pos = data, .end = (const uint8_t*)data + size };
+	return _cbor_put_item(self, &r, 0) && r.pos == r.end;
+}
+
+/********************************
+** ENCODING
+********************************/
+
+// output is collected in a small buffer so that the sink is not called for every byte
+struct cbor_writer {
+	struct blob_sink *sink;
+	bool failed;
+	size_t len;
+	uint8_t buf[4096];
+};
+
+static void _cbor_flush(struct cbor_writer *self){
+	if(self->len && !self->failed && !self->sink->write(self->sink, self->buf, self->len))
+		self->failed = true;
+	self->len = 0;
+}
+
+static void _cbor_write(struct cbor_writer *self, const void *data, size_t size){
+	if(self->len + size > sizeof(self->buf)){
+		_cbor_flush(self);
+		if(size > sizeof(self->buf)){
+			if(!self->failed && !self->sink->write(self->sink, data, size))
+				self->failed = true;
+			return;
+		}
+	}
+	memcpy(self->buf + self->len, data, size);
+	self->len += size;
+}
+
+static inline void _cbor_write_byte(struct cbor_writer *self, uint8_t byte){
+	_cbor_write(self, &byte, 1);
+}
+
+static void _cbor_write_head(struct cbor_writer *self, uint8_t major, uint64_t arg){
+	uint8_t out[9];
+	unsigned int bytes;
+	if(arg < 24){
+		_cbor_write_byte(self, (major << 5) | arg);
+		return;
+	}
+	if(arg <= UINT8_MAX) bytes = 1;
+	else if(arg <= UINT16_MAX) bytes = 2;
+	else if(arg <= UINT32_MAX) bytes = 4;
+	else bytes = 8;
+	out[0] = (major << 5) | (24 + __builtin_ctz(bytes));
+	for(unsigned int c = 0; c < bytes; c++)
+		out[bytes - c] = (uint8_t)(arg >> (8 * c));
+	_cbor_write(self, out, bytes + 1);
+}
+
+static void _cbor_write_int(struct cbor_writer *self, long long val){
+	if(val >= 0) _cbor_write_head(self, CBOR_UINT, val);
+	else _cbor_write_head(self, CBOR_NEGINT, -1 - val);
+}
+
+static void _cbor_write_string(struct cbor_writer *self, const char *str){
+	_cbor_write_head(self, CBOR_TEXT, strlen(str));
+	_cbor_write(self, str, strlen(str));
+}
+
+static void _cbor_write_cell(struct cbor_writer *self, const struct blob_column *column, uint32_t row){
+	uint32_t v32;
+	uint64_t v64;
+
+	switch(column->type){
+		case BLOB_FIELD_FLOAT32:
+			v32 = htobe32(pack754_32(blob_column_get_real(column, row)));
+			_cbor_write_byte(self, (CBOR_SIMPLE << 5) | 26);
+			_cbor_write(self, &v32, 4);
+			break;
+		case BLOB_FIELD_FLOAT64:
+			v64 = htobe64(pack754_64(blob_column_get_real(column, row)));
+			_cbor_write_byte(self, (CBOR_SIMPLE << 5) | 27);
+			_cbor_write(self, &v64, 8);
+			break;
+		case BLOB_FIELD_STRING:
+			_cbor_write_string(self, blob_column_get_string(column, row));
+			break;
+		default:
+			_cbor_write_int(self, blob_column_get_int(column, row));
+			break;
+	}
+}
+
+// columns are written out as the array of maps that they were built from
+static void _cbor_write_columns(struct cbor_writer *self, const struct blob_field *attr){
+	const struct blob_field *key;
+	struct blob_column column;
+	uint32_t rows = blob_columns_rows(attr);
+
+	_cbor_write_byte(self, (CBOR_ARRAY << 5) | CBOR_INDEFINITE);
+	for(uint32_t row = 0; row < rows; row++){
+		_cbor_write_byte(self, (CBOR_MAP << 5) | CBOR_INDEFINITE);
+		blob_columns_for_each_kv(attr, key, column){
+			_cbor_write_string(self, blob_field_get_string(key));
+			_cbor_write_cell(self, &column, row);
+		}
+		_cbor_write_byte(self, CBOR_BREAK);
+	}
+	_cbor_write_byte(self, CBOR_BREAK);
+}
+
+static void _cbor_write_field(struct cbor_writer *self, const struct blob_field *attr){
+	const struct blob_field *child;
+	size_t count = 0;
+	bool array;
+
+	switch(blob_field_type(attr)){
+		case BLOB_FIELD_INT8:
+		case BLOB_FIELD_INT16:
+		case BLOB_FIELD_INT32:
+		case BLOB_FIELD_INT64:
+			_cbor_write_int(self, blob_field_get_int(attr));
+			break;
+		// blob floats are stored as big endian ieee 754 which is what cbor uses
+		case BLOB_FIELD_FLOAT32:
+			_cbor_write_byte(self, (CBOR_SIMPLE << 5) | 26);
+			_cbor_write(self, blob_field_data(attr), 4);
+			break;
+		case BLOB_FIELD_FLOAT64:
+			_cbor_write_byte(self, (CBOR_SIMPLE << 5) | 27);
+			_cbor_write(self, blob_field_data(attr), 8);
+			break;
+		case BLOB_FIELD_STRING:
+			_cbor_write_string(self, blob_field_get_string(attr));
+			break;
+		case BLOB_FIELD_ARRAY:
+		case BLOB_FIELD_TABLE:
+			// tables with keys that are not strings are written as arrays since they could not
+			// be read back into a table
+			array = blob_field_type(attr) == BLOB_FIELD_ARRAY;
+			blob_field_for_each_child(attr, child){
+				if(!array && (count & 1) == 0 && blob_field_type(child) != BLOB_FIELD_STRING)
+					array = true;
+				count++;
+			}
+			_cbor_write_byte(self, ((array ? CBOR_ARRAY : CBOR_MAP) << 5) | CBOR_INDEFINITE);
+			blob_field_for_each_child(attr, child)
+				_cbor_write_field(self, child);
+			// a key without a value
+			if(!array && (count & 1)) _cbor_write_byte(self, (CBOR_SIMPLE << 5) | 22);
+			_cbor_write_byte(self, CBOR_BREAK);
+			break;
+		case BLOB_FIELD_COLUMNS:
+			_cbor_write_columns(self, attr);
+			break;
+		default:
+			_cbor_write_byte(self, (CBOR_SIMPLE << 5) | 22);
+			break;
+	}
+}
+
+bool blob_field_write_cbor(const struct blob_field *self, struct blob_sink *sink){
+	struct cbor_writer w;
+	w.sink = sink;
+	w.failed = false;
+	w.len = 0;
+	_cbor_write_field(&w, self);
+	_cbor_flush(&w);
+	return !w.failed;
+}
@@ -0,0 +1,38 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "blob.h"
+#include "blob_sink.h"
+
+//! maximum nesting of arrays, maps and tags accepted by blob_put_cbor
+#define BLOB_CBOR_MAX_DEPTH 1024
+
+//! Decodes one cbor data item and writes it to the blob. Definite and indefinite length items
+//! are both accepted. Map keys must be text strings, null and undefined are written as 0,
+//! byte strings as arrays of integers and tags are skipped so only the tagged item is kept.
+//! Integers outside the range of long long and text with null bytes are rejected.
+//! Returns false if the data is not exactly one valid cbor item.
+bool blob_put_cbor(struct blob *self, const void *data, size_t size);
+
+//! Streams the field as cbor into the sink. Arrays and tables are written as indefinite length
+//! arrays and maps so no lengths have to be counted up front. Tables with keys that are not
+//! strings are written as arrays, like the json and msgpack output does.
+bool blob_field_write_cbor(const struct blob_field *self, struct blob_sink *sink);
@@ -0,0 +1,336 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "blob.h"
+#include "blob_columns.h"
+#include "ieee754.h"
+
+// what a column is made of while the rows are scanned
+enum {
+	BLOB_COLUMN_NONE,
+	BLOB_COLUMN_INT,
+	BLOB_COLUMN_REAL,
+	BLOB_COLUMN_STRING
+};
+
+struct blob_column_builder {
+	const char *key;
+	int kind;
+	bool has_int;
+	bool has_double;
+	long long min;
+	long long max;
+	uint8_t type;
+	size_t bytes;
+	size_t offset;
+	char *data;
+	char *strings;
+	size_t pos;
+};
+
+static inline uint32_t _col_get32(const char *p){
+	uint32_t val;
+	memcpy(&val, p, sizeof(val));
+	return be32toh(val);
+}
+
+static inline void _col_put32(char *p, uint32_t val){
+	val = htobe32(val);
+	memcpy(p, &val, sizeof(val));
+}
+
+static size_t _col_width(uint8_t type){
+	switch(type){
+		case BLOB_FIELD_INT8: return 1;
+		case BLOB_FIELD_INT16: return 2;
+		case BLOB_FIELD_INT32:
+		case BLOB_FIELD_FLOAT32: return 4;
+		case BLOB_FIELD_INT64:
+		case BLOB_FIELD_FLOAT64: return 8;
+	}
+	return 0;
+}
+
+/********************************
+** WRITING
+********************************/
+
+static bool _col_scan(struct blob_column_builder *col, const struct blob_field *value){
+	int type = blob_field_type(value);
+	switch(type){
+		case BLOB_FIELD_INT8:
+		case BLOB_FIELD_INT16:
+		case BLOB_FIELD_INT32:
+		case BLOB_FIELD_INT64: {
+			if(col->kind != BLOB_COLUMN_NONE && col->kind != BLOB_COLUMN_INT) return false;
+			long long val = blob_field_get_int(value);
+			if(!col->has_int || val < col->min) col->min = val;
+			if(!col->has_int || val > col->max) col->max = val;
+			col->has_int = true;
+			if(col->kind == BLOB_COLUMN_NONE) col->kind = BLOB_COLUMN_INT;
+			return true;
+		}
+		case BLOB_FIELD_FLOAT32:
+		case BLOB_FIELD_FLOAT64:
+			// a real column can not give back ints unchanged so mixed columns stay rows
+			if(col->kind != BLOB_COLUMN_NONE && col->kind != BLOB_COLUMN_REAL) return false;
+			if(type == BLOB_FIELD_FLOAT64) col->has_double = true;
+			col->kind = BLOB_COLUMN_REAL;
+			return true;
+		case BLOB_FIELD_STRING:
+			if(col->kind != BLOB_COLUMN_NONE && col->kind != BLOB_COLUMN_STRING) return false;
+			col->kind = BLOB_COLUMN_STRING;
+			col->bytes += strlen(blob_field_get_string(value)) + 1;
+			return true;
+	}
+	return false;
+}
+
+static uint8_t _col_type(const struct blob_column_builder *col){
+	switch(col->kind){
+		case BLOB_COLUMN_INT:
+			if(col->min >= INT8_MIN && col->max <= INT8_MAX) return BLOB_FIELD_INT8;
+			if(col->min >= INT16_MIN && col->max <= INT16_MAX) return BLOB_FIELD_INT16;
+			if(col->min >= INT32_MIN && col->max <= INT32_MAX) return BLOB_FIELD_INT32;
+			return BLOB_FIELD_INT64;
+		case BLOB_COLUMN_REAL:
+			return col->has_double ? BLOB_FIELD_FLOAT64 : BLOB_FIELD_FLOAT32;
+		case BLOB_COLUMN_STRING:
+			return BLOB_FIELD_STRING;
+	}
+	return BLOB_FIELD_INVALID;
+}
+
+static void _col_write(struct blob_column_builder *col, uint32_t row, const struct blob_field *value){
+	char *p = col->data + row * _col_width(col->type);
+	uint16_t v16;
+	uint32_t v32;
+	uint64_t v64;
+
+	switch(col->type){
+		case BLOB_FIELD_INT8:
+			*p = (char)blob_field_get_int(value);
+			break;
+		case BLOB_FIELD_INT16:
+			v16 = htobe16((uint16_t)blob_field_get_int(value));
+			memcpy(p, &v16, sizeof(v16));
+			break;
+		case BLOB_FIELD_INT32:
+			v32 = htobe32((uint32_t)blob_field_get_int(value));
+			memcpy(p, &v32, sizeof(v32));
+			break;
+		case BLOB_FIELD_INT64:
+			v64 = htobe64((uint64_t)blob_field_get_int(value));
+			memcpy(p, &v64, sizeof(v64));
+			break;
+		case BLOB_FIELD_FLOAT32:
+			v32 = htobe32(pack754_32(blob_field_get_real(value)));
+			memcpy(p, &v32, sizeof(v32));
+			break;
+		case BLOB_FIELD_FLOAT64:
+			v64 = htobe64(pack754_64(blob_field_get_real(value)));
+			memcpy(p, &v64, sizeof(v64));
+			break;
+		case BLOB_FIELD_STRING: {
+			// the offsets come first and the strings after all rows + 1 of them
+			const char *str = blob_field_get_string(value);
+			size_t len = strlen(str) + 1;
+			memcpy(col->strings + col->pos, str, len);
+			col->pos += len;
+			_col_put32(col->data + (row + 1) * sizeof(uint32_t), col->pos);
+			break;
+		}
+	}
+}
+
+struct blob_field *blob_put_columns(struct blob *buf, const struct blob_field *rows){
+	struct blob_column_builder *cols = NULL;
+	const struct blob_field *row, *key, *value;
+	uint32_t ncols = 0, nrows = 0, c;
+	uint32_t head_len = blob_field_raw_len(blob_head(buf));
+	blob_offset_t offset;
+
+	if(blob_field_type(rows) != BLOB_FIELD_ARRAY) return NULL;
+
+	// the first row decides the keys
+	row = blob_field_first_child(rows);
+	if(blob_field_type(row) != BLOB_FIELD_TABLE) return NULL;
+	blob_field_for_each_kv(row, key, value) ncols++;
+	if(!ncols || !(cols = calloc(ncols, sizeof(*cols)))) return NULL;
+	c = 0;
+	blob_field_for_each_kv(row, key, value){
+		if(blob_field_type(key) != BLOB_FIELD_STRING) goto fail;
+		cols[c++].key = blob_field_get_string(key);
+	}
+
+	blob_field_for_each_child(rows, row){
+		if(blob_field_type(row) != BLOB_FIELD_TABLE) goto fail;
+		c = 0;
+		blob_field_for_each_kv(row, key, value){
+			if(c == ncols || blob_field_type(key) != BLOB_FIELD_STRING || strcmp(blob_field_get_string(key), cols[c].key) != 0) goto fail;
+			if(!_col_scan(&cols[c], value)) goto fail;
+			c++;
+		}
+		if(c != ncols) goto fail;
+		nrows++;
+	}
+
+	// reserve all columns first so that the buffer does not move while they are filled in
+	offset = blob_open_columns(buf);
+	if(!offset) goto fail;
+	for(c = 0; c < ncols; c++){
+		struct blob_column_builder *col = &cols[c];
+		col->type = _col_type(col);
+		size_t size = (col->type == BLOB_FIELD_STRING) ? (nrows + 1) * sizeof(uint32_t) + col->bytes : (size_t)nrows * _col_width(col->type);
+		struct blob_field *field;
+		if(!blob_put_string(buf, col->key)) goto fail;
+		if(!(field = blob_reserve(buf, BLOB_FIELD_BINARY, BLOB_COLUMN_HEADER_SIZE + size))) goto fail;
+		col->offset = (const char*)blob_field_data(field) - (const char*)buf->buf;
+	}
+	blob_close_columns(buf, offset);
+
+	for(c = 0; c < ncols; c++){
+		struct blob_column_builder *col = &cols[c];
+		char *header = (char*)buf->buf + col->offset;
+		memset(header, 0, BLOB_COLUMN_HEADER_SIZE);
+		header[0] = col->type;
+		_col_put32(header + 4, nrows);
+		col->data = header + BLOB_COLUMN_HEADER_SIZE;
+		// the strings follow the rows + 1 offsets
+		col->strings = col->data + (nrows + 1) * sizeof(uint32_t);
+		if(col->type == BLOB_FIELD_STRING) _col_put32(col->data, 0);
+	}
+
+	nrows = 0;
+	blob_field_for_each_child(rows, row){
+		c = 0;
+		blob_field_for_each_kv(row, key, value) _col_write(&cols[c++], nrows, value);
+		nrows++;
+	}
+
+	free(cols);
+	return (struct blob_field*)(void*)((char*)buf->buf + (size_t)offset);
+fail:
+	free(cols);
+	blob_field_set_raw_len(blob_head(buf), head_len);
+	return NULL;
+}
+
+/********************************
+** READING
+********************************/
+
+uint32_t blob_columns_rows(const struct blob_field *self){
+	const struct blob_field *key;
+	struct blob_column column;
+	blob_columns_for_each_kv(self, key, column) return column.rows;
+	return 0;
+}
+
+bool blob_columns_get(const struct blob_field *self, const struct blob_field *key, struct blob_column *column){
+	const struct blob_field *field = blob_field_next_child(self, key);
+	if(!field || blob_field_type(field) != BLOB_FIELD_BINARY || blob_field_data_len(field) < BLOB_COLUMN_HEADER_SIZE) return false;
+
+	const char *data = blob_field_data(field);
+	size_t size = blob_field_data_len(field) - BLOB_COLUMN_HEADER_SIZE;
+	column->type = data[0];
+	column->rows = _col_get32(data + 4);
+	column->data = data + BLOB_COLUMN_HEADER_SIZE;
+	column->offsets = NULL;
+
+	if(column->type == BLOB_FIELD_STRING){
+		size_t offsets_len = ((size_t)column->rows + 1) * sizeof(uint32_t);
+		if(offsets_len > size) return false;
+		column->offsets = column->data;
+		column->data += offsets_len;
+		column->size = size - offsets_len;
+		return true;
+	}
+	size_t width = _col_width(column->type);
+	if(!width || column->rows > size / width) return false;
+	column->size = column->rows * width;
+	return true;
+}
+
+bool blob_columns_find(const struct blob_field *self, const char *name, struct blob_column *column){
+	const struct blob_field *key;
+	blob_columns_for_each_kv(self, key, *column){
+		if(strcmp(blob_field_get_string(key), name) == 0) return true;
+	}
+	return false;
+}
+
+long long blob_column_get_int(const struct blob_column *self, uint32_t row){
+	if(row >= self->rows) return 0;
+
+	const char *p = self->data + row * _col_width(self->type);
+	uint16_t v16;
+	uint32_t v32;
+	uint64_t v64;
+
+	switch(self->type){
+		case BLOB_FIELD_INT8:
+			return (int8_t)*p;
+		case BLOB_FIELD_INT16:
+			memcpy(&v16, p, sizeof(v16));
+			return (int16_t)be16toh(v16);
+		case BLOB_FIELD_INT32:
+			memcpy(&v32, p, sizeof(v32));
+			return (int32_t)be32toh(v32);
+		case BLOB_FIELD_INT64:
+			memcpy(&v64, p, sizeof(v64));
+			return (int64_t)be64toh(v64);
+		case BLOB_FIELD_FLOAT32:
+		case BLOB_FIELD_FLOAT64: {
+			// converting NaN or a value beyond long long is undefined, so those read as 0
+			double d = blob_column_get_real(self, row);
+			return (d >= -0x1p63 && d < 0x1p63) ? (long long)d : 0;
+		}
+	}
+	return 0;
+}
+
+double blob_column_get_real(const struct blob_column *self, uint32_t row){
+	if(row >= self->rows) return 0;
+
+	const char *p = self->data + row * _col_width(self->type);
+	uint32_t v32;
+	uint64_t v64;
+
+	switch(self->type){
+		case BLOB_FIELD_FLOAT32:
+			memcpy(&v32, p, sizeof(v32));
+			return unpack754_32(be32toh(v32));
+		case BLOB_FIELD_FLOAT64:
+			memcpy(&v64, p, sizeof(v64));
+			return unpack754_64(be64toh(v64));
+		case BLOB_FIELD_INT8:
+		case BLOB_FIELD_INT16:
+		case BLOB_FIELD_INT32:
+		case BLOB_FIELD_INT64:
+			return blob_column_get_int(self, row);
+	}
+	return 0;
+}
+
+const char *blob_column_get_string(const struct blob_column *self, uint32_t row){
+	if(self->type != BLOB_FIELD_STRING || row >= self->rows) return NULL;
+	uint32_t start = _col_get32(self->offsets + row * sizeof(uint32_t));
+	uint32_t end = _col_get32(self->offsets + (row + 1) * sizeof(uint32_t));
+	if(start >= end || end > self->size || self->data[end - 1] != 0) return NULL;
+	return self->data + start;
+}
@@ -0,0 +1,76 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "blob.h"
+
+//! A columns field (BLOB_FIELD_COLUMNS) holds an array of tables that all have the same keys.
+//! Every key is stored once and followed by the values of that key for all rows:
+//!  - the children are pairs of a key (string field) and a column (binary field)
+//!  - a column starts with its element type (u8, one of BLOB_FIELD_INT8..BLOB_FIELD_FLOAT64 or
+//!    BLOB_FIELD_STRING), 3 zero bytes and the number of rows (u32)
+//!  - number columns continue with one big endian value per row
+//!  - string columns continue with rows + 1 offsets (u32) into the string bytes that follow and
+//!    every string is null terminated
+#define BLOB_COLUMN_HEADER_SIZE 8
+
+//! A column of a columns field. Points into the field and is valid as long as the field is.
+struct blob_column {
+	uint8_t type;
+	uint32_t rows;
+	const char *data;
+	size_t size;
+	//! string columns only
+	const char *offsets;
+};
+
+//! Writes the array of tables in rows as a columns field. Every row must be a table with the
+//! same keys in the same order and every value must be a number or a string. Ints are stored
+//! with the smallest width that fits the whole column. A key that has ints in some rows and
+//! reals in others can not be stored as a column. rows must not point into buf. Returns NULL
+//! and leaves buf as it was if rows is empty or can not be stored as columns.
+struct blob_field *blob_put_columns(struct blob *buf, const struct blob_field *rows);
+
+//! returns the number of rows in a columns field
+uint32_t blob_columns_rows(const struct blob_field *self);
+
+//! Fills column with the values of key, which must be a key child of self.
+bool blob_columns_get(const struct blob_field *self, const struct blob_field *key, struct blob_column *column);
+
+//! Looks up the column by name.
+bool blob_columns_find(const struct blob_field *self, const char *name, struct blob_column *column);
+
+//! Returns the value at row converted to the requested type. Numbers out of range read as 0.
+long long blob_column_get_int(const struct blob_column *self, uint32_t row);
+double blob_column_get_real(const struct blob_column *self, uint32_t row);
+//! Returns NULL if the column is not a string column or row is out of range.
+const char *blob_column_get_string(const struct blob_column *self, uint32_t row);
+
+//! Iterates over the keys and columns of a columns field. Together with a row index this gives
+//! the same view of a row that blob_field_for_each_kv gives of a table:
+//!
+//!	for(uint32_t row = 0; row < blob_columns_rows(attr); row++)
+//!		blob_columns_for_each_kv(attr, key, column)
+//!			printf("%s=%lld\n", blob_field_get_string(key), blob_column_get_int(&column, row));
+#define blob_columns_for_each_kv(attr, key, column) \
+	for(key = blob_field_first_child(attr); \
+		key && blob_columns_get(attr, key, &(column)); \
+		key = blob_field_next_child(attr, blob_field_next_child(attr, key)))
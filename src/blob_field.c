@@ -19,6 +19,7 @@
 #include <endian.h>
 #include "blob.h"
 #include "blob_field.h"
+#include "blob_stats_private.h"
 
 static const int blob_type_minlen[BLOB_FIELD_LAST] = {
 	[BLOB_FIELD_STRING] = 1,
@@ -391,7 +392,10 @@ static bool _blob_field_validate(const struct blob_field *attr, const char *sign
 
 bool blob_field_validate(const struct blob_field *attr, const char *signature){
 	if(!attr) return false; 
-	return _blob_field_validate(attr, signature, NULL); 
+	uint64_t start = blob_stats_latency_start(); 
+	bool valid = _blob_field_validate(attr, signature, NULL); 
+	blob_stats_latency_end(BLOB_STATS_OP_VALIDATE, start); 
+	return valid; 
 }
 
 bool blob_field_parse(const struct blob_field *attr, const char *signature, const struct blob_field **out, int out_size){
@@ -406,8 +410,7 @@ bool blob_field_parse(const struct blob_field *attr, const char *signature, cons
 	return true; 
 }
 
-bool blob_field_parse_values(const struct blob_field *attr, struct blob_policy *policy, int policy_size){
-	if(!attr) return false; 
+static bool _blob_field_parse_values(const struct blob_field *attr, struct blob_policy *policy, int policy_size){
 	bool valid = true; 
 	if(blob_field_type(attr) == BLOB_FIELD_TABLE){
 		const struct blob_field *key, *value; 
@@ -438,3 +441,11 @@ bool blob_field_parse_values(const struct blob_field *attr, struct blob_policy *
 	}
 	return valid; 
 }
+
+bool blob_field_parse_values(const struct blob_field *attr, struct blob_policy *policy, int policy_size){
+	if(!attr) return false; 
+	uint64_t start = blob_stats_latency_start(); 
+	bool valid = _blob_field_parse_values(attr, policy, policy_size); 
+	blob_stats_latency_end(BLOB_STATS_OP_PARSE_VALUES, start); 
+	return valid; 
+}
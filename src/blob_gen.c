@@ -0,0 +1,134 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <string.h>
+#include "blob.h"
+#include "blob_gen.h"
+
+// deeper documents would not be generated in any sensible time anyway
+#define BLOB_GEN_MAX_DEPTH 64
+
+static const char _gen_chars[] = "abcdefghijklmnopqrstuvwxyz0123456789 _-";
+
+void blob_gen_shape_default(struct blob_gen_shape *shape){
+	*shape = (struct blob_gen_shape){
+		.depth = 3,
+		.fanout = { .min = 2, .max = 10 },
+		.container_share = 0.2,
+		.table_share = 0.8,
+		.key_len = { .min = 3, .max = 16 },
+		.int_weights = { 4, 3, 2, 1 },
+		.string_len = { .min = 1, .max = 256, .log = true },
+		.float_share = 0.15,
+		.string_share = 0.35
+	};
+}
+
+void blob_gen_init(struct blob_gen *self, const struct blob_gen_shape *shape, uint64_t seed){
+	self->shape = *shape;
+	if(self->shape.depth > BLOB_GEN_MAX_DEPTH) self->shape.depth = BLOB_GEN_MAX_DEPTH;
+	self->state = seed;
+	self->int_total = 0;
+	for(int c = 0; c < 4; c++) self->int_total += shape->int_weights[c];
+}
+
+uint64_t blob_gen_next(struct blob_gen *self){
+	uint64_t z = (self->state += 0x9e3779b97f4a7c15ull);
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+	return z ^ (z >> 31);
+}
+
+static inline double _gen_share(struct blob_gen *self){
+	return (blob_gen_next(self) >> 11) * 0x1.0p-53;
+}
+
+static inline uint64_t _gen_uniform(struct blob_gen *self, uint64_t min, uint64_t max){
+	if(max <= min) return min;
+	return min + blob_gen_next(self) % (max - min + 1);
+}
+
+static inline unsigned int _gen_bits(uint64_t val){
+	return val ? 64 - __builtin_clzll(val) : 0;
+}
+
+static uint32_t _gen_dist(struct blob_gen *self, const struct blob_gen_dist *dist){
+	if(dist->max <= dist->min) return dist->min;
+	if(!dist->log) return _gen_uniform(self, dist->min, dist->max);
+	// pick the bit length first, then a value of that length
+	unsigned int bits = _gen_uniform(self, _gen_bits(dist->min), _gen_bits(dist->max));
+	uint64_t lo = bits ? (uint64_t)1 << (bits - 1) : 0;
+	uint64_t hi = ((uint64_t)1 << bits) - 1;
+	if(lo < dist->min) lo = dist->min;
+	if(hi > dist->max) hi = dist->max;
+	return _gen_uniform(self, lo, hi);
+}
+
+static bool _gen_string(struct blob_gen *self, struct blob *blob, uint32_t len){
+	struct blob_field *attr = blob_put_string_len(blob, NULL, len);
+	if(!attr) return false;
+	for(uint32_t c = 0; c < len; c++) attr->data[c] = _gen_chars[blob_gen_next(self) % (sizeof(_gen_chars) - 1)];
+	return true;
+}
+
+// an integer that needs exactly the chosen width
+static long long _gen_int(struct blob_gen *self){
+	static const uint64_t limits[4] = { INT8_MAX, INT16_MAX, INT32_MAX, INT64_MAX };
+	int width = 0;
+	if(self->int_total){
+		uint32_t pick = blob_gen_next(self) % self->int_total;
+		while(pick >= self->shape.int_weights[width]) pick -= self->shape.int_weights[width++];
+	}
+	uint64_t lo = width ? limits[width - 1] + 1 : 0;
+	uint64_t val = _gen_uniform(self, lo, limits[width]);
+	return (blob_gen_next(self) & 1) ? -(long long)val : (long long)val;
+}
+
+static bool _gen_value(struct blob_gen *self, struct blob *blob){
+	double pick = _gen_share(self);
+	if(pick < self->shape.float_share){
+		// three decimals so that most values need a double
+		return blob_put_real(blob, (double)(long long)_gen_uniform(self, 0, 2000000000) / 1000 - 1000000) != NULL;
+	}
+	if(pick < self->shape.float_share + self->shape.string_share)
+		return _gen_string(self, blob, _gen_dist(self, &self->shape.string_len));
+	return blob_put_int(blob, _gen_int(self)) != NULL;
+}
+
+static bool _gen_container(struct blob_gen *self, struct blob *blob, uint32_t level){
+	bool table = _gen_share(self) < self->shape.table_share;
+	blob_offset_t o = table ? blob_open_table(blob) : blob_open_array(blob);
+	if(!o) return false;
+	uint32_t children = _gen_dist(self, &self->shape.fanout);
+	for(uint32_t c = 0; c < children; c++){
+		if(table && !_gen_string(self, blob, _gen_dist(self, &self->shape.key_len))) return false;
+		bool ok;
+		if(level < self->shape.depth && _gen_share(self) < self->shape.container_share)
+			ok = _gen_container(self, blob, level + 1);
+		else
+			ok = _gen_value(self, blob);
+		if(!ok) return false;
+	}
+	if(table) blob_close_table(blob, o);
+	else blob_close_array(blob, o);
+	return true;
+}
+
+bool blob_gen_put(struct blob_gen *self, struct blob *blob){
+	return _gen_container(self, blob, 0);
+}
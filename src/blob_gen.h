@@ -0,0 +1,72 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "blob.h"
+
+//! Distribution of a length or count: uniform between min and max (inclusive), or with log set
+//! uniform over the powers of two in between, which gives mostly short values with a long tail.
+struct blob_gen_dist {
+	uint32_t min;
+	uint32_t max;
+	bool log;
+};
+
+//! Shape of generated documents. Every document is a table or an array.
+struct blob_gen_shape {
+	//! levels of containers below the top one
+	uint32_t depth;
+	//! number of children of every container
+	struct blob_gen_dist fanout;
+	//! share of the children that are containers (as long as depth allows it)
+	double container_share;
+	//! share of the containers that are tables, the others are arrays
+	double table_share;
+	//! length of table keys
+	struct blob_gen_dist key_len;
+	//! relative weights of 8, 16, 32 and 64 bit integers
+	uint32_t int_weights[4];
+	//! length of strings
+	struct blob_gen_dist string_len;
+	//! share of the values that are reals
+	double float_share;
+	//! share of the values that are strings, the values that are neither are integers
+	double string_share;
+};
+
+//! Generator of documents. The same shape and seed always give the same documents.
+struct blob_gen {
+	struct blob_gen_shape shape;
+	uint64_t state;
+	uint32_t int_total;
+};
+
+//! Fills shape with a mix of small tables and arrays of mostly short strings and small integers.
+void blob_gen_shape_default(struct blob_gen_shape *shape);
+
+void blob_gen_init(struct blob_gen *self, const struct blob_gen_shape *shape, uint64_t seed);
+
+//! Appends the next document to blob. Returns false if the blob could not hold it.
+bool blob_gen_put(struct blob_gen *self, struct blob *blob);
+
+//! Returns the next number of the generator (splitmix64), for callers that need more randomness
+//! that is reproducible from the same seed.
+uint64_t blob_gen_next(struct blob_gen *self);
@@ -0,0 +1,728 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// accept4
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "blob.h"
+#include "blob_io.h"
+#include "blob_capture_private.h"
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_UNISTD_H)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#endif
+
+#define BLOB_IO_RING_SIZE 1024
+#define BLOB_IO_MAX_EVENTS 256
+// how long a listener rests after accept ran out of fds or memory
+#define BLOB_IO_ACCEPT_BACKOFF_MS 100
+
+// the low bits of the pointers that go through the kernel tell what has completed
+#define BLOB_IO_TAG_READ 0
+#define BLOB_IO_TAG_WRITE 1
+#define BLOB_IO_TAG_ACCEPT 2
+#define BLOB_IO_TAG_CANCEL 3
+#define BLOB_IO_TAG_MASK 3
+
+struct blob_io_conn {
+	struct blob_io *io;
+	const struct blob_io_ops *ops;
+	void *user;
+	int fd;
+	int error;
+	bool closing;
+	//! sockets are written with sendmsg and MSG_NOSIGNAL, everything else with writev
+	bool socket;
+	//! an io_uring read is in flight
+	bool reading;
+	//! an io_uring write is in flight or epoll waits for the fd to become writable
+	bool writing;
+	//! on the dirty list of the loop
+	bool dirty;
+	//! io_uring reads and writes in flight. A closed connection is freed once this drops to 0.
+	unsigned int pending;
+	//! the blob the next frame is read into and how much of it has been read
+	struct blob rx;
+	uint32_t rx_len;
+	//! blobs waiting to be written are tx[tx_first] to tx[tx_first + tx_count - 1]
+	struct blob *tx;
+	size_t tx_first;
+	size_t tx_count;
+	size_t tx_size;
+	//! bytes of tx[tx_first] that have been written already
+	uint32_t tx_offset;
+	struct iovec iov[BLOB_IO_MAX_IOV];
+	struct msghdr msg;
+	struct blob_io_conn *prev;
+	struct blob_io_conn *next;
+	struct blob_io_conn *next_dirty;
+};
+
+struct blob_io_listener {
+	struct blob_io_listener *next;
+	int fd;
+	blob_io_accept_cb_t cb;
+	void *user;
+	bool accepting;
+	bool closing;
+	//! not accepting until resume_ms (see _io_pause_accept)
+	bool paused;
+	long long resume_ms;
+};
+
+static void _io_close(struct blob_io_conn *self, int error);
+static void _io_received(struct blob_io_conn *self);
+static void _io_sent(struct blob_io_conn *self, size_t len);
+static void _io_mark_dirty(struct blob_io_conn *self);
+static size_t _io_fill_iov(struct blob_io_conn *self);
+static void _io_pause_accept(struct blob_io *self, struct blob_io_listener *l);
+
+/********************************
+** IO_URING
+********************************/
+
+#ifdef HAVE_LINUX_IO_URING_H
+struct blob_io_ring {
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_array;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	unsigned int sq_entries;
+	char *map;
+	size_t map_size;
+	size_t sqes_size;
+};
+
+static void _io_ring_free(struct blob_io_ring *ring){
+	if(!ring) return;
+	if(ring->sqes) munmap(ring->sqes, ring->sqes_size);
+	if(ring->map) munmap(ring->map, ring->map_size);
+	free(ring);
+}
+
+// sets up the ring without liburing. Kernels older than 5.11 lack the features needed to wait
+// with a timeout in one call and get the epoll loop instead.
+static bool _io_ring_init(struct blob_io *self){
+	static const unsigned int features = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_EXT_ARG;
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+	p.flags = IORING_SETUP_CQSIZE;
+	p.cq_entries = BLOB_IO_RING_SIZE * 4;
+	int fd = syscall(__NR_io_uring_setup, BLOB_IO_RING_SIZE, &p);
+	if(fd < 0) return false;
+
+	struct blob_io_ring *ring = calloc(1, sizeof(struct blob_io_ring));
+	if(!ring || (p.features & features) != features) goto fail;
+
+	size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	ring->map_size = (sq_size > cq_size) ? sq_size : cq_size;
+	void *map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	if(map == MAP_FAILED) goto fail;
+	ring->map = map;
+	ring->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	void *sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+	if(sqes == MAP_FAILED) goto fail;
+	ring->sqes = sqes;
+
+	ring->sq_head = (unsigned int*)(void*)(ring->map + p.sq_off.head);
+	ring->sq_tail = (unsigned int*)(void*)(ring->map + p.sq_off.tail);
+	ring->sq_mask = (unsigned int*)(void*)(ring->map + p.sq_off.ring_mask);
+	ring->sq_array = (unsigned int*)(void*)(ring->map + p.sq_off.array);
+	ring->cq_head = (unsigned int*)(void*)(ring->map + p.cq_off.head);
+	ring->cq_tail = (unsigned int*)(void*)(ring->map + p.cq_off.tail);
+	ring->cq_mask = (unsigned int*)(void*)(ring->map + p.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)(void*)(ring->map + p.cq_off.cqes);
+	ring->sq_entries = p.sq_entries;
+	self->fd = fd;
+	self->ring = ring;
+	return true;
+fail:
+	_io_ring_free(ring);
+	close(fd);
+	return false;
+}
+
+static unsigned int _io_ring_queued(struct blob_io_ring *ring){
+	return *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+// submits everything queued and waits for at least wait completions
+static int _io_ring_enter(struct blob_io *self, unsigned int wait, int timeout_ms){
+	struct __kernel_timespec ts;
+	struct io_uring_getevents_arg arg;
+	memset(&arg, 0, sizeof(arg));
+	if(timeout_ms >= 0){
+		ts.tv_sec = timeout_ms / 1000;
+		ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+		arg.ts = (uintptr_t)&ts;
+	}
+	int ret = syscall(__NR_io_uring_enter, self->fd, _io_ring_queued(self->ring), wait,
+		IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+	if(ret < 0 && errno != ETIME && errno != EINTR) return -1;
+	return 0;
+}
+
+static bool _io_ring_submit(struct blob_io *self, int op, int fd, const void *addr, uint32_t len, uint32_t flags, uint64_t user_data){
+	struct blob_io_ring *ring = self->ring;
+	// a full submission queue is handed to the kernel before anything else is queued
+	if(_io_ring_queued(ring) >= ring->sq_entries){
+		if(_io_ring_enter(self, 0, 0) < 0 || _io_ring_queued(ring) >= ring->sq_entries) return false;
+	}
+	unsigned int tail = *ring->sq_tail;
+	unsigned int idx = tail & *ring->sq_mask;
+	struct io_uring_sqe *sqe = &ring->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = op;
+	sqe->fd = fd;
+	sqe->addr = (uintptr_t)addr;
+	sqe->len = len;
+	sqe->user_data = user_data;
+	// read and write at the current position so that pipes and sockets work alike
+	if(op == IORING_OP_READ || op == IORING_OP_WRITEV) sqe->off = (uint64_t)-1;
+	if(op == IORING_OP_ACCEPT) sqe->accept_flags = flags;
+	else if(op == IORING_OP_SENDMSG) sqe->msg_flags = flags;
+	ring->sq_array[idx] = idx;
+	__atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static void _io_ring_cancel(struct blob_io *self, uintptr_t user_data){
+	_io_ring_submit(self, IORING_OP_ASYNC_CANCEL, -1, (const void*)user_data, 0, 0, BLOB_IO_TAG_CANCEL);
+}
+
+static bool _io_ring_read(struct blob_io_conn *self){
+	char *buf = (char*)self->rx.buf + self->rx_len;
+	if(!_io_ring_submit(self->io, IORING_OP_READ, self->fd, buf, self->rx.memlen - self->rx_len, 0, (uintptr_t)self | BLOB_IO_TAG_READ)) return false;
+	self->reading = true;
+	self->pending++;
+	return true;
+}
+
+static bool _io_ring_accept(struct blob_io *io, struct blob_io_listener *self){
+	if(!_io_ring_submit(io, IORING_OP_ACCEPT, self->fd, NULL, 0, SOCK_CLOEXEC, (uintptr_t)self | BLOB_IO_TAG_ACCEPT)) return false;
+	self->accepting = true;
+	return true;
+}
+
+static void _io_ring_write(struct blob_io_conn *self){
+	size_t count = _io_fill_iov(self);
+	uintptr_t user_data = (uintptr_t)self | BLOB_IO_TAG_WRITE;
+	bool queued = self->socket
+		? _io_ring_submit(self->io, IORING_OP_SENDMSG, self->fd, &self->msg, 1, MSG_NOSIGNAL, user_data)
+		: _io_ring_submit(self->io, IORING_OP_WRITEV, self->fd, self->iov, count, 0, user_data);
+	if(!queued){
+		_io_close(self, EBUSY);
+		return;
+	}
+	self->writing = true;
+	self->pending++;
+}
+
+static void _io_ring_complete(struct blob_io *self, uint64_t user_data, int res){
+	uintptr_t tag = user_data & BLOB_IO_TAG_MASK;
+	if(tag == BLOB_IO_TAG_CANCEL) return;
+	if(tag == BLOB_IO_TAG_ACCEPT){
+		struct blob_io_listener *l = (struct blob_io_listener*)(uintptr_t)(user_data & ~(uint64_t)BLOB_IO_TAG_MASK);
+		l->accepting = false;
+		if(l->closing){
+			if(res >= 0) close(res);
+			return;
+		}
+		if(res >= 0) l->cb(self, res, l->user);
+		if(res == -EMFILE || res == -ENFILE || res == -ENOBUFS || res == -ENOMEM) _io_pause_accept(self, l);
+		else if(res != -EBADF && res != -EINVAL && res != -ENOTSOCK) _io_ring_accept(self, l);
+		return;
+	}
+
+	struct blob_io_conn *conn = (struct blob_io_conn*)(uintptr_t)(user_data & ~(uint64_t)BLOB_IO_TAG_MASK);
+	conn->pending--;
+	if(tag == BLOB_IO_TAG_READ){
+		conn->reading = false;
+		if(conn->closing) return;
+		if(res > 0){
+			conn->rx_len += res;
+			_io_received(conn);
+		} else if(res == 0){
+			_io_close(conn, 0);
+		} else if(res != -EAGAIN && res != -EINTR){
+			_io_close(conn, -res);
+		}
+		if(!conn->closing && !_io_ring_read(conn)) _io_close(conn, EBUSY);
+	} else {
+		conn->writing = false;
+		if(conn->closing) return;
+		if(res >= 0) _io_sent(conn, res);
+		else if(res != -EAGAIN && res != -EINTR) _io_close(conn, -res);
+		if(!conn->closing && conn->tx_count) _io_mark_dirty(conn);
+	}
+}
+
+static int _io_ring_run(struct blob_io *self, int timeout_ms){
+	struct blob_io_ring *ring = self->ring;
+	unsigned int head = *ring->cq_head;
+	bool empty = head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	if(_io_ring_enter(self, (empty && timeout_ms != 0) ? 1 : 0, timeout_ms) < 0) return -1;
+
+	// only what has completed so far is handled so that callbacks can not keep the loop busy
+	unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+	int count = 0;
+	while(head != tail){
+		struct io_uring_cqe cqe = ring->cqes[head & *ring->cq_mask];
+		__atomic_store_n(ring->cq_head, ++head, __ATOMIC_RELEASE);
+		_io_ring_complete(self, cqe.user_data, cqe.res);
+		count++;
+	}
+	return count;
+}
+#else
+static void _io_ring_free(struct blob_io_ring *ring){ }
+static bool _io_ring_init(struct blob_io *self){ return false; }
+static void _io_ring_cancel(struct blob_io *self, uintptr_t user_data){ }
+static bool _io_ring_read(struct blob_io_conn *self){ return false; }
+static bool _io_ring_accept(struct blob_io *io, struct blob_io_listener *self){ return false; }
+static void _io_ring_write(struct blob_io_conn *self){ }
+static int _io_ring_run(struct blob_io *self, int timeout_ms){ return -1; }
+#endif
+
+/********************************
+** EPOLL
+********************************/
+
+static void _io_epoll_watch(struct blob_io_conn *self, bool out){
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN | (out ? EPOLLOUT : 0);
+	ev.data.ptr = self;
+	epoll_ctl(self->io->fd, EPOLL_CTL_MOD, self->fd, &ev);
+	self->writing = out;
+}
+
+// writes as much as the socket takes and waits for EPOLLOUT if something is left
+static void _io_epoll_write(struct blob_io_conn *self){
+	while(self->tx_count){
+		size_t count = _io_fill_iov(self);
+		ssize_t ret = self->socket ? sendmsg(self->fd, &self->msg, MSG_NOSIGNAL) : writev(self->fd, self->iov, count);
+		if(ret < 0){
+			if(errno == EINTR) continue;
+			if(errno == EAGAIN || errno == EWOULDBLOCK){
+				if(!self->writing) _io_epoll_watch(self, true);
+				return;
+			}
+			_io_close(self, errno);
+			return;
+		}
+		_io_sent(self, ret);
+	}
+	if(self->writing) _io_epoll_watch(self, false);
+}
+
+static void _io_epoll_read(struct blob_io_conn *self){
+	ssize_t ret = read(self->fd, (char*)self->rx.buf + self->rx_len, self->rx.memlen - self->rx_len);
+	if(ret > 0){
+		self->rx_len += ret;
+		_io_received(self);
+	} else if(ret == 0){
+		_io_close(self, 0);
+	} else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+		_io_close(self, errno);
+	}
+}
+
+static bool _io_epoll_listen(struct blob_io *self, struct blob_io_listener *l){
+	struct epoll_event ev;
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.ptr = (void*)((uintptr_t)l | BLOB_IO_TAG_ACCEPT);
+	return epoll_ctl(self->fd, EPOLL_CTL_ADD, l->fd, &ev) == 0;
+}
+
+static void _io_epoll_accept(struct blob_io *self, struct blob_io_listener *l){
+	int fd;
+	while((fd = accept4(l->fd, NULL, NULL, SOCK_CLOEXEC)) >= 0) l->cb(self, fd, l->user);
+	if(errno == EMFILE || errno == ENFILE || errno == ENOBUFS || errno == ENOMEM) _io_pause_accept(self, l);
+}
+
+static int _io_epoll_run(struct blob_io *self, int timeout_ms){
+	struct epoll_event events[BLOB_IO_MAX_EVENTS];
+	int count = epoll_wait(self->fd, events, BLOB_IO_MAX_EVENTS, timeout_ms);
+	if(count < 0) return (errno == EINTR) ? 0 : -1;
+	for(int c = 0; c < count; c++){
+		uintptr_t data = (uintptr_t)events[c].data.ptr;
+		if((data & BLOB_IO_TAG_MASK) == BLOB_IO_TAG_ACCEPT){
+			_io_epoll_accept(self, (struct blob_io_listener*)(data & ~(uintptr_t)BLOB_IO_TAG_MASK));
+			continue;
+		}
+		// connections closed by an earlier event stay allocated until the end of blob_io_run()
+		struct blob_io_conn *conn = events[c].data.ptr;
+		if(!conn->closing && (events[c].events & EPOLLOUT)) _io_epoll_write(conn);
+		if(!conn->closing && (events[c].events & (EPOLLIN | EPOLLHUP | EPOLLERR))) _io_epoll_read(conn);
+	}
+	return count;
+}
+
+/********************************
+** LISTENERS
+********************************/
+
+static long long _io_now_ms(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+// the pending connection that could not be accepted would be reported again right away, so
+// the listener stops accepting for a while instead of spinning until fds are closed
+static void _io_pause_accept(struct blob_io *self, struct blob_io_listener *l){
+	if(!self->ring) epoll_ctl(self->fd, EPOLL_CTL_DEL, l->fd, NULL);
+	l->paused = true;
+	l->resume_ms = _io_now_ms() + BLOB_IO_ACCEPT_BACKOFF_MS;
+}
+
+// starts accepting again on the listeners whose pause is over. Returns the timeout to wait with
+// so that the others are resumed in time.
+static int _io_resume_accept(struct blob_io *self, int timeout_ms){
+	long long now = -1;
+	for(struct blob_io_listener *l = self->listeners; l; l = l->next){
+		if(!l->paused) continue;
+		if(now < 0) now = _io_now_ms();
+		if(l->resume_ms <= now){
+			l->paused = !(self->ring ? _io_ring_accept(self, l) : _io_epoll_listen(self, l));
+			if(l->paused) l->resume_ms = now + BLOB_IO_ACCEPT_BACKOFF_MS;
+		}
+		if(l->paused && (timeout_ms < 0 || l->resume_ms - now < timeout_ms)) timeout_ms = (int)(l->resume_ms - now);
+	}
+	return timeout_ms;
+}
+
+/********************************
+** CONNECTIONS
+********************************/
+
+static bool _io_grow(struct blob *blob, uint32_t size){
+	if(size <= blob->memlen) return true;
+	void *buf = realloc(blob->buf, size);
+	if(!buf) return false;
+	blob->buf = buf;
+	blob->memlen = size;
+	return true;
+}
+
+// hands every complete frame in the receive buffer to on_blob. The start of the next frame that
+// was read along with it is moved into a fresh blob from the pool.
+static void _io_received(struct blob_io_conn *self){
+	struct blob_pool *pool = &self->io->pool;
+	while(!self->closing && self->rx_len >= sizeof(struct blob_field)){
+		const struct blob_field *head = blob_head(&self->rx);
+		uint32_t frame = blob_field_raw_pad_len(head);
+		if(blob_field_raw_len(head) < sizeof(struct blob_field) || frame > BLOB_MAX_SIZE){
+			_io_close(self, EPROTO);
+			return;
+		}
+		if(self->rx_len < frame){
+			// the rest of a big frame is read straight into its blob
+			if(!_io_grow(&self->rx, frame)) _io_close(self, ENOMEM);
+			return;
+		}
+
+		struct blob msg = self->rx;
+		uint32_t rest = self->rx_len - frame;
+		if(!blob_pool_get(pool, &self->rx) || !_io_grow(&self->rx, rest)){
+			blob_pool_put(pool, &self->rx);
+			self->rx = msg;
+			_io_close(self, ENOMEM);
+			return;
+		}
+		memcpy(self->rx.buf, (char*)msg.buf + frame, rest);
+		self->rx_len = rest;
+
+		if(BLOB_CAPTURE_ON()) blob_capture_blob(blob_head(&msg));
+		self->ops->on_blob(self, &msg);
+		blob_pool_put(pool, &msg);
+	}
+}
+
+static size_t _io_fill_iov(struct blob_io_conn *self){
+	size_t count = 0;
+	uint32_t offset = self->tx_offset;
+	while(count < self->tx_count && count < BLOB_IO_MAX_IOV){
+		struct blob *blob = &self->tx[self->tx_first + count];
+		self->iov[count].iov_base = (char*)blob->buf + offset;
+		self->iov[count].iov_len = blob_size(blob) - offset;
+		offset = 0;
+		count++;
+	}
+	self->msg.msg_iov = self->iov;
+	self->msg.msg_iovlen = count;
+	return count;
+}
+
+// drops the first len bytes of the output queue
+static void _io_sent(struct blob_io_conn *self, size_t len){
+	while(len && self->tx_count){
+		struct blob *blob = &self->tx[self->tx_first];
+		size_t left = blob_size(blob) - self->tx_offset;
+		if(len < left){
+			self->tx_offset += len;
+			return;
+		}
+		len -= left;
+		self->tx_offset = 0;
+		blob_pool_put(&self->io->pool, blob);
+		self->tx_first++;
+		self->tx_count--;
+	}
+	if(!self->tx_count) self->tx_first = 0;
+}
+
+static void _io_mark_dirty(struct blob_io_conn *self){
+	if(self->dirty) return;
+	self->dirty = true;
+	self->next_dirty = self->io->dirty;
+	self->io->dirty = self;
+}
+
+// starts writing everything that was queued since the last call
+static void _io_flush_dirty(struct blob_io *self){
+	while(self->dirty){
+		struct blob_io_conn *conn = self->dirty;
+		self->dirty = conn->next_dirty;
+		conn->dirty = false;
+		if(conn->closing || conn->writing || !conn->tx_count) continue;
+		if(self->ring) _io_ring_write(conn);
+		else _io_epoll_write(conn);
+	}
+}
+
+static void _io_close(struct blob_io_conn *self, int error){
+	struct blob_io *io = self->io;
+	if(self->closing) return;
+	self->closing = true;
+	self->error = error;
+
+	if(self->prev) self->prev->next = self->next;
+	else io->conns = self->next;
+	if(self->next) self->next->prev = self->prev;
+	self->prev = NULL;
+	self->next = io->closed;
+	io->closed = self;
+
+	if(io->ring){
+		if(self->reading) _io_ring_cancel(io, (uintptr_t)self | BLOB_IO_TAG_READ);
+		if(self->writing) _io_ring_cancel(io, (uintptr_t)self | BLOB_IO_TAG_WRITE);
+	} else {
+		epoll_ctl(io->fd, EPOLL_CTL_DEL, self->fd, NULL);
+	}
+}
+
+// frees closed connections that the kernel is done with
+static void _io_reap(struct blob_io *self){
+	struct blob_io_conn **ptr = &self->closed;
+	while(*ptr){
+		struct blob_io_conn *conn = *ptr;
+		if(conn->pending || conn->dirty){
+			ptr = &conn->next;
+			continue;
+		}
+		*ptr = conn->next;
+		if(conn->ops->on_close) conn->ops->on_close(conn, conn->error);
+		close(conn->fd);
+		blob_pool_put(&self->pool, &conn->rx);
+		for(size_t c = 0; c < conn->tx_count; c++) blob_pool_put(&self->pool, &conn->tx[conn->tx_first + c]);
+		free(conn->tx);
+		free(conn);
+	}
+}
+
+/********************************
+** PUBLIC
+********************************/
+
+bool blob_io_init(struct blob_io *self, size_t blob_size, unsigned int flags){
+	memset(self, 0, sizeof(*self));
+	self->fd = -1;
+	if(!blob_pool_init(&self->pool, 1024, blob_size ? blob_size : BLOB_IO_BLOB_SIZE)) return false;
+	if((flags & BLOB_IO_EPOLL) || !_io_ring_init(self)){
+		self->flags |= BLOB_IO_EPOLL;
+		self->fd = epoll_create1(EPOLL_CLOEXEC);
+		if(self->fd < 0){
+			blob_pool_free(&self->pool);
+			return false;
+		}
+	}
+	return true;
+}
+
+void blob_io_free(struct blob_io *self){
+	while(self->conns) _io_close(self->conns, ECANCELED);
+	for(struct blob_io_listener *l = self->listeners; l; l = l->next){
+		l->closing = true;
+		if(l->accepting) _io_ring_cancel(self, (uintptr_t)l | BLOB_IO_TAG_ACCEPT);
+	}
+	// the kernel may still be reading into blobs of the closed connections
+	while(self->ring){
+		bool busy = false;
+		for(struct blob_io_listener *l = self->listeners; l; l = l->next) busy = busy || l->accepting;
+		for(struct blob_io_conn *conn = self->closed; conn; conn = conn->next) busy = busy || conn->pending;
+		if(!busy || blob_io_run(self, -1) < 0) break;
+	}
+	_io_reap(self);
+
+	while(self->listeners){
+		struct blob_io_listener *l = self->listeners;
+		self->listeners = l->next;
+		close(l->fd);
+		free(l);
+	}
+	_io_ring_free(self->ring);
+	self->ring = NULL;
+	if(self->fd >= 0) close(self->fd);
+	self->fd = -1;
+	blob_pool_free(&self->pool);
+}
+
+struct blob_io_conn *blob_io_add(struct blob_io *self, int fd, const struct blob_io_ops *ops, void *user){
+	struct blob_io_conn *conn = calloc(1, sizeof(struct blob_io_conn));
+	if(!conn) return NULL;
+	conn->io = self;
+	conn->ops = ops;
+	conn->user = user;
+	conn->fd = fd;
+	if(!blob_pool_get(&self->pool, &conn->rx)) goto fail;
+	struct stat st;
+	conn->socket = fstat(fd, &st) == 0 && S_ISSOCK(st.st_mode);
+
+	int flags = fcntl(fd, F_GETFL);
+	if(flags < 0) goto fail;
+	if(self->ring){
+		// io_uring parks blocking reads in the kernel instead of failing them with EAGAIN
+		if(fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0 || !_io_ring_read(conn)) goto fail;
+	} else {
+		struct epoll_event ev;
+		memset(&ev, 0, sizeof(ev));
+		ev.events = EPOLLIN;
+		ev.data.ptr = conn;
+		if(fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 || epoll_ctl(self->fd, EPOLL_CTL_ADD, fd, &ev) < 0) goto fail;
+	}
+
+	conn->next = self->conns;
+	if(self->conns) self->conns->prev = conn;
+	self->conns = conn;
+	return conn;
+fail:
+	blob_pool_put(&self->pool, &conn->rx);
+	free(conn);
+	return NULL;
+}
+
+bool blob_io_listen(struct blob_io *self, int fd, blob_io_accept_cb_t cb, void *user){
+	struct blob_io_listener *l = calloc(1, sizeof(struct blob_io_listener));
+	if(!l) return false;
+	l->fd = fd;
+	l->cb = cb;
+	l->user = user;
+
+	int flags = fcntl(fd, F_GETFL);
+	if(flags < 0) goto fail;
+	if(self->ring){
+		if(fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) < 0 || !_io_ring_accept(self, l)) goto fail;
+	} else {
+		if(fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0 || !_io_epoll_listen(self, l)) goto fail;
+	}
+	l->next = self->listeners;
+	self->listeners = l;
+	return true;
+fail:
+	free(l);
+	return false;
+}
+
+bool blob_io_send(struct blob_io_conn *conn, struct blob *blob){
+	if(conn->closing || !blob->buf) return false;
+	if(conn->tx_first + conn->tx_count == conn->tx_size){
+		if(conn->tx_first){
+			memmove(conn->tx, conn->tx + conn->tx_first, conn->tx_count * sizeof(struct blob));
+			conn->tx_first = 0;
+		} else {
+			size_t size = conn->tx_size ? conn->tx_size * 2 : 8;
+			struct blob *tx = realloc(conn->tx, size * sizeof(struct blob));
+			if(!tx) return false;
+			conn->tx = tx;
+			conn->tx_size = size;
+		}
+	}
+	conn->tx[conn->tx_first + conn->tx_count++] = *blob;
+	blob->buf = NULL;
+	blob->memlen = 0;
+	_io_mark_dirty(conn);
+	return true;
+}
+
+void blob_io_close(struct blob_io_conn *conn){
+	_io_close(conn, 0);
+}
+
+bool blob_io_alloc(struct blob_io *self, struct blob *blob){
+	if(!blob_pool_get(&self->pool, blob)) return false;
+	blob_reset(blob);
+	return true;
+}
+
+void blob_io_recycle(struct blob_io *self, struct blob *blob){
+	blob_pool_put(&self->pool, blob);
+}
+
+void *blob_io_conn_user(const struct blob_io_conn *conn){
+	return conn->user;
+}
+
+int blob_io_conn_fd(const struct blob_io_conn *conn){
+	return conn->fd;
+}
+
+int blob_io_run(struct blob_io *self, int timeout_ms){
+	// blobs sent outside of the callbacks
+	_io_flush_dirty(self);
+	timeout_ms = _io_resume_accept(self, timeout_ms);
+	int ret = self->ring ? _io_ring_run(self, timeout_ms) : _io_epoll_run(self, timeout_ms);
+	// replies sent from the callbacks. With io_uring they go out with the next submission.
+	_io_flush_dirty(self);
+	_io_reap(self);
+	return ret;
+}
+#endif
@@ -0,0 +1,119 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "blob.h"
+#include "blob_pool.h"
+
+//! use epoll with readv/writev even if io_uring is available
+#define BLOB_IO_EPOLL (1 << 0)
+
+//! default size of the pooled blobs that frames are read into
+#define BLOB_IO_BLOB_SIZE 4096
+//! at most this many queued blobs are written with one writev
+#define BLOB_IO_MAX_IOV 16
+
+struct blob_io;
+struct blob_io_conn;
+struct blob_io_ring;
+struct blob_io_listener;
+
+//! Callbacks of a connection.
+struct blob_io_ops {
+	//! Called with every blob read from the connection. The blob goes back to the pool when the
+	//! callback returns unless the callback hands it to blob_io_send() or takes it over (by
+	//! copying the struct and setting blob->buf to NULL).
+	void (*on_blob)(struct blob_io_conn *conn, struct blob *blob);
+	//! Called once when the connection is gone. error is 0 at end of file or after
+	//! blob_io_close() and an errno value otherwise. The fd is closed after this returns.
+	void (*on_close)(struct blob_io_conn *conn, int error);
+};
+
+//! called with every accepted connection on a listening socket
+typedef void (*blob_io_accept_cb_t)(struct blob_io *io, int fd, void *user);
+
+//! An event loop that reads and writes framed blobs on many connections from one thread. A frame
+//! is simply the encoded blob (blob_size() bytes of it): the length in its head field tells the
+//! reader how much to read. Frames are read straight into pooled blobs which are handed to the
+//! on_blob callback, and blobs passed to blob_io_send() are gathered into one writev (sendmsg for
+//! sockets) per connection.
+//!
+//! With io_uring every call of blob_io_run() submits all queued reads and writes and waits for
+//! completions in a single system call. Where io_uring is not available (or BLOB_IO_EPOLL is
+//! given) the loop falls back to epoll and read/writev.
+//!
+//! Sockets are written with MSG_NOSIGNAL, so a peer that has gone away closes the connection
+//! with EPIPE. Writing to a pipe whose reader is gone still raises SIGPIPE.
+//!
+//! A listener that runs out of fds (or memory) stops accepting for a moment instead of retrying
+//! the connection it could not accept over and over.
+struct blob_io {
+	//! BLOB_IO_EPOLL is set if the epoll backend is used
+	unsigned int flags;
+	//! the epoll or io_uring fd
+	int fd;
+	struct blob_io_ring *ring;
+	struct blob_pool pool;
+	//! all open connections
+	struct blob_io_conn *conns;
+	//! connections that have blobs queued that are not being written yet
+	struct blob_io_conn *dirty;
+	//! closed connections waiting for their last io_uring operation
+	struct blob_io_conn *closed;
+	struct blob_io_listener *listeners;
+};
+
+//! Sets up the loop. Frames are read into blobs of blob_size bytes (0 for BLOB_IO_BLOB_SIZE)
+//! that grow when a frame does not fit.
+bool blob_io_init(struct blob_io *self, size_t blob_size, unsigned int flags);
+
+//! Closes all connections (on_close gets ECANCELED) and listening sockets and frees the loop.
+void blob_io_free(struct blob_io *self);
+
+//! Adds a connected socket or pipe. The loop takes over fd and switches it to the blocking mode
+//! the backend needs. Returns NULL (and leaves fd open) on failure.
+struct blob_io_conn *blob_io_add(struct blob_io *self, int fd, const struct blob_io_ops *ops, void *user);
+
+//! Accepts connections on the listening socket fd and passes them to cb, which usually calls
+//! blob_io_add(). The loop takes over fd.
+bool blob_io_listen(struct blob_io *self, int fd, blob_io_accept_cb_t cb, void *user);
+
+//! Queues blob to be written and takes it over (blob->buf is set to NULL). The blob goes back to
+//! the pool once it has been written. Returns false and leaves blob alone if the connection is
+//! closed or out of memory.
+bool blob_io_send(struct blob_io_conn *conn, struct blob *blob);
+
+//! Closes the connection. Queued blobs that have not been written yet are dropped.
+void blob_io_close(struct blob_io_conn *conn);
+
+//! Gets an empty blob from the pool for building a message to send.
+bool blob_io_alloc(struct blob_io *self, struct blob *blob);
+
+//! Gives a blob taken from on_blob or blob_io_alloc() back to the pool.
+void blob_io_recycle(struct blob_io *self, struct blob *blob);
+
+void *blob_io_conn_user(const struct blob_io_conn *conn);
+int blob_io_conn_fd(const struct blob_io_conn *conn);
+
+//! Waits up to timeout_ms (-1 for no limit) for I/O and runs the callbacks of everything that
+//! completed. Returns the number of completed events (0 on timeout) or -1 on error.
+int blob_io_run(struct blob_io *self, int timeout_ms);
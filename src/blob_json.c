@@ -19,6 +19,9 @@
 #include <inttypes.h>
 #include "blob.h"
 #include "blob_json.h"
+#include "blob_columns.h"
+#include "blob_stats_private.h"
+#include "blob_trace.h"
 
 //#include <json-c/json.h>
 
@@ -112,18 +115,67 @@ struct strbuf {
 	void *priv;
 	bool indent;
 	int indent_level;
+
+	// when fd is valid the buffer is drained into it instead of growing
+	int fd;
+	bool failed;
 };
 
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#define BLOB_JSON_STREAM_BUFFER_SIZE (64 * 1024)
+
+static bool blob_write_all(struct strbuf *s, const char *c, int len)
+{
+	while (len > 0) {
+		ssize_t ret = write(s->fd, c, len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0) {
+			s->failed = true;
+			return false;
+		}
+		c += ret;
+		len -= ret;
+	}
+	return true;
+}
+
+static bool blob_flush(struct strbuf *s)
+{
+	bool ret = blob_write_all(s, s->buf, s->pos);
+	s->pos = 0;
+	return ret;
+}
+#endif
+
 static bool blob_puts(struct strbuf *s, const char *c, int len)
 {
+	if (s->failed)
+		return false;
+
 	if (len <= 0)
 		return true;
 
 	if (s->pos + len >= s->len) {
-		s->len += 16 + len;
-		s->buf = realloc(s->buf, s->len);
-		if (!s->buf)
-			return false;
+#ifdef HAVE_UNISTD_H
+		if (s->fd >= 0) {
+			if (!blob_flush(s))
+				return false;
+			if (len >= s->len)
+				return blob_write_all(s, c, len);
+		} else
+#endif
+		{
+			s->len += 16 + len;
+			s->buf = realloc(s->buf, s->len);
+			BLOB_STATS_GLOBAL_ADD(json_grows, 1);
+			if (!s->buf)
+				return false;
+		}
 	}
 	memcpy(s->buf + s->pos, c, len);
 	s->pos += len;
@@ -207,6 +259,7 @@ static void blob_format_string(struct strbuf *s, const char *str)
 }
 
 static void blob_format_json_list(struct strbuf *s, const struct blob_field *attr, bool array);
+static void blob_format_json_columns(struct strbuf *s, const struct blob_field *attr);
 
 static void blob_format_element(struct strbuf *s, const struct blob_field *attr, bool array, bool head)
 {
@@ -262,6 +315,9 @@ static void blob_format_element(struct strbuf *s, const struct blob_field *attr,
 	case BLOB_FIELD_TABLE:
 		blob_format_json_list(s, attr, false);
 		return;
+	case BLOB_FIELD_COLUMNS:
+		blob_format_json_columns(s, attr);
+		return;
 	}
 
 out:
@@ -307,7 +363,72 @@ static void blob_format_json_list(struct strbuf *s, const struct blob_field *att
 	blob_puts(s, (array ? "]" : "}"), 1);
 }
 
-static char *blob_format_json_with_cb(const struct blob_field *attr, bool list, blob_json_format_t cb, void *priv, int indent)
+static void blob_format_json_cell(struct strbuf *s, const struct blob_column *column, uint32_t row){
+	const char *str;
+	char buf[32];
+
+	switch(column->type){
+	case BLOB_FIELD_FLOAT32:
+		sprintf(buf, "%f", blob_column_get_real(column, row));
+		break;
+	case BLOB_FIELD_FLOAT64:
+		sprintf(buf, "%e", blob_column_get_real(column, row));
+		break;
+	case BLOB_FIELD_STRING:
+		str = blob_column_get_string(column, row);
+		if(str){
+			blob_format_string(s, str);
+			return;
+		}
+		sprintf(buf, "null");
+		break;
+	default:
+		sprintf(buf, "%lld", blob_column_get_int(column, row));
+		break;
+	}
+	blob_puts(s, buf, strlen(buf));
+}
+
+// columns are written out as the array of tables that they were built from
+static void blob_format_json_columns(struct strbuf *s, const struct blob_field *attr){
+	const struct blob_field *key;
+	struct blob_column column;
+	uint32_t rows = blob_columns_rows(attr);
+
+	blob_puts(s, "[", 1);
+	s->indent_level++;
+	add_separator(s);
+
+	for(uint32_t row = 0; row < rows; row++){
+		bool first = true;
+		if(row > 0){
+			blob_puts(s, ",", 1);
+			add_separator(s);
+		}
+		blob_puts(s, "{", 1);
+		s->indent_level++;
+		add_separator(s);
+		blob_columns_for_each_kv(attr, key, column){
+			if(!first){
+				blob_puts(s, ",", 1);
+				add_separator(s);
+			}
+			blob_format_string(s, blob_field_data(key));
+			blob_puts(s, ":", s->indent ? 2 : 1);
+			blob_format_json_cell(s, &column, row);
+			first = false;
+		}
+		s->indent_level--;
+		add_separator(s);
+		blob_puts(s, "}", 1);
+	}
+
+	s->indent_level--;
+	add_separator(s);
+	blob_puts(s, "]", 1);
+}
+
+static char *blob_format_json_with_cb(const struct blob_field *attr, bool list, blob_json_format_t cb, void *priv, int indent, size_t *len)
 {
 	struct strbuf s;
 	bool array;
@@ -318,6 +439,8 @@ static char *blob_format_json_with_cb(const struct blob_field *attr, bool list,
 	s.custom_format = cb;
 	s.priv = priv;
 	s.indent = false;
+	s.fd = -1;
+	s.failed = false;
 
 	if (indent >= 0) {
 		s.indent = true;
@@ -338,17 +461,157 @@ static char *blob_format_json_with_cb(const struct blob_field *attr, bool list,
 
 	s.buf = realloc(s.buf, s.pos + 1);
 	s.buf[s.pos] = 0;
+	if (len)
+		*len = s.pos;
 
 	return s.buf;
 }
 
 char *blob_field_to_json(const struct blob_field *attr){
-	return blob_format_json_with_cb(attr, false, NULL, NULL, -1);
+	uint64_t start = (BLOB_PROBE_ENABLED(json_encode_done) || BLOB_STATS_LATENCY_ON()) ? blob_trace_now() : 0;
+	size_t len = 0;
+	// the probe arguments are evaluated even when nothing is attached
+	if(BLOB_PROBE_ENABLED(json_encode_start)) BLOB_PROBE2(json_encode_start, attr, blob_field_raw_pad_len(attr));
+	char *json = blob_format_json_with_cb(attr, false, NULL, NULL, -1, &len);
+	uint64_t ns = start ? blob_trace_now() - start : 0;
+	if(BLOB_PROBE_ENABLED(json_encode_done)) BLOB_PROBE3(json_encode_done, attr, len, ns);
+	if(start && BLOB_STATS_LATENCY_ON()) blob_stats_record(BLOB_STATS_OP_JSON_ENCODE, ns);
+	return json;
+}
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+
+struct blob_json_range {
+	pthread_t thread;
+	bool running;
+	const struct blob_field *parent;
+	const struct blob_field *first;
+	size_t count;
+	size_t size;
+	struct strbuf s;
+};
+
+static void *_blob_json_format_range(void *arg){
+	struct blob_json_range *r = arg;
+	const struct blob_field *pos = r->first;
+
+	for(size_t c = 0; c < r->count; c++, pos = blob_field_next_child(r->parent, pos)){
+		if (c > 0)
+			blob_puts(&r->s, ",", 1);
+		blob_format_element(&r->s, pos, true, false);
+	}
+	return NULL;
+}
+
+char *blob_field_to_json_parallel(const struct blob_field *attr, unsigned int nthreads){
+	const struct blob_field *child;
+	size_t count = 0;
+
+	if(blob_field_type(attr) != BLOB_FIELD_ARRAY || nthreads < 2)
+		return blob_field_to_json(attr);
+
+	blob_field_for_each_child(attr, child)
+		count++;
+
+	if(count < BLOB_JSON_PARALLEL_MIN_CHILDREN)
+		return blob_field_to_json(attr);
+	if(nthreads > count)
+		nthreads = count;
+
+	struct blob_json_range *ranges = calloc(nthreads, sizeof(*ranges));
+	if(!ranges)
+		return blob_field_to_json(attr);
+
+	// split the children into ranges of equal count and size the buffers after the binary size of each range
+	child = blob_field_first_child(attr);
+	for(unsigned int c = 0; c < nthreads; c++){
+		struct blob_json_range *r = &ranges[c];
+		r->parent = attr;
+		r->first = child;
+		r->count = count / nthreads + ((c < count % nthreads)?1:0);
+		for(size_t i = 0; i < r->count; i++, child = blob_field_next_child(attr, child))
+			r->size += blob_field_raw_pad_len(child);
+		r->s.len = r->size + 16;
+		r->s.buf = malloc(r->s.len);
+		r->s.fd = -1;
+		if(c > 0 && r->s.buf)
+			r->running = pthread_create(&r->thread, NULL, _blob_json_format_range, r) == 0;
+	}
+
+	size_t total = 2;
+	for(unsigned int c = 0; c < nthreads; c++){
+		struct blob_json_range *r = &ranges[c];
+		if(r->running)
+			pthread_join(r->thread, NULL);
+		else if(r->s.buf)
+			_blob_json_format_range(r);
+		total += r->s.pos + ((c > 0)?1:0);
+	}
+
+	char *json = malloc(total + 1);
+	char *out = json;
+	if(json)
+		*out++ = '[';
+	for(unsigned int c = 0; c < nthreads; c++){
+		if(!ranges[c].s.buf){
+			free(json);
+			json = NULL;
+		}
+		if(json){
+			if(c > 0)
+				*out++ = ',';
+			memcpy(out, ranges[c].s.buf, ranges[c].s.pos);
+			out += ranges[c].s.pos;
+		}
+		free(ranges[c].s.buf);
+	}
+	if(json){
+		*out++ = ']';
+		*out = 0;
+	}
+
+	free(ranges);
+	return json;
+}
+#else
+char *blob_field_to_json_parallel(const struct blob_field *attr, unsigned int nthreads){
+	return blob_field_to_json(attr);
 }
+#endif
 
 static char *blob_field_to_json_pretty(const struct blob_field *attr){
-	return blob_format_json_with_cb(attr, false, NULL, NULL, 1);
+	return blob_format_json_with_cb(attr, false, NULL, NULL, 1, NULL);
+}
+
+#ifdef HAVE_UNISTD_H
+bool blob_field_write_json(const struct blob_field *attr, int fd){
+	struct strbuf s;
+
+	memset(&s, 0, sizeof(s));
+	s.len = BLOB_JSON_STREAM_BUFFER_SIZE;
+	s.buf = malloc(s.len);
+	s.fd = fd;
+	if (!s.buf)
+		return false;
+
+	blob_format_element(&s, attr, false, false);
+	blob_flush(&s);
+
+	free(s.buf);
+	return !s.failed;
+}
+
+bool blob_write_json_to_file(const struct blob *self, const char *file){
+	int fd = open(file, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (fd < 0)
+		return false;
+	bool ret = blob_field_write_json(blob_head_const(self), fd);
+	if (close(fd) < 0)
+		ret = false;
+	return ret;
 }
+#endif
 
 static void _blob_field_dump_json(const struct blob_field *self, int indent){
 	assert(self); 
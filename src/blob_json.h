@@ -37,10 +37,25 @@ void blob_field_dump_json_pretty(const struct blob_field *self);
 static inline void blob_dump_json(const struct blob *self){ blob_field_dump_json(blob_head_const(self)); }
 
 char *blob_field_to_json(const struct blob_field *self); 
+
+//! arrays with fewer children than this are always formatted on the calling thread
+#define BLOB_JSON_PARALLEL_MIN_CHILDREN 1024
+//! same output as blob_field_to_json but large arrays are formatted by nthreads threads
+char *blob_field_to_json_parallel(const struct blob_field *self, unsigned int nthreads); 
 static inline char *blob_to_json(const struct blob *self){ return blob_field_to_json(blob_head_const(self)); }
 
 bool blob_init_from_json(struct blob *self, const char *json); 
 
 bool blob_put_json(struct blob *self, const char *json); 
+//! Like blob_put_json but only keeps object members that lie on one of the dot separated
+//! paths (for example "user.name") in the NULL terminated paths array (at most 64 paths).
+//! Everything below the end of a path is kept, arrays do not count as a path level and
+//! other members are skipped without being decoded.
+bool blob_put_json_projected(struct blob *self, const char *json, const char *const paths[]); 
 bool blob_put_json_from_file(struct blob *self, const char *file); 
 
+//! writes the json representation of a field to a file descriptor without building the whole string in memory
+bool blob_field_write_json(const struct blob_field *self, int fd); 
+//! writes the blob as json into a file, replacing its contents
+bool blob_write_json_to_file(const struct blob *self, const char *file); 
+
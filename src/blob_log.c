@@ -0,0 +1,218 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "blob.h"
+#include "blob_log.h"
+#include "blob_crc32.h"
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+struct blob_log_map {
+	struct blob_log_map *next;
+	char *map;
+	size_t size;
+};
+
+struct blob_log_record {
+	uint32_t len;
+	uint32_t crc;
+};
+
+static uint32_t _blob_log_crc(uint32_t len_be, const void *data, size_t len){
+	return blob_crc32(blob_crc32(0, &len_be, sizeof(len_be)), data, len);
+}
+
+// maps at least size bytes of the file. Mapping past the end of the file is fine as long as
+// only the part that has been written is touched, so the mapping is made larger than needed.
+static bool _blob_log_map(struct blob_log *self, uint64_t size){
+	if(self->map && size <= self->map_size) return true;
+
+	size_t map_size = self->map_size ? self->map_size : BLOB_LOG_MIN_MAP_SIZE;
+	while(map_size < size) map_size *= 2;
+
+	void *map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, self->fd, 0);
+	if(map == MAP_FAILED) return false;
+
+	if(self->map){
+		struct blob_log_map *old = malloc(sizeof(struct blob_log_map));
+		if(!old){
+			munmap(map, map_size);
+			return false;
+		}
+		old->map = self->map;
+		old->size = self->map_size;
+		old->next = self->old_maps;
+		self->old_maps = old;
+	}
+	self->map = map;
+	self->map_size = map_size;
+	return true;
+}
+
+// returns the length of the valid record at offset or 0
+static uint64_t _blob_log_check_record(struct blob_log *self, uint64_t offset, uint64_t end){
+	struct blob_log_record rec;
+	if(end - offset < BLOB_LOG_RECORD_HEADER_SIZE + sizeof(struct blob_field)) return 0;
+	memcpy(&rec, self->map + offset, sizeof(rec));
+
+	uint32_t len = be32toh(rec.len);
+	const struct blob_field *field = (const struct blob_field*)(self->map + offset + BLOB_LOG_RECORD_HEADER_SIZE);
+	if(len < sizeof(struct blob_field) || len > end - offset - BLOB_LOG_RECORD_HEADER_SIZE) return 0;
+	if(blob_field_raw_len(field) < sizeof(struct blob_field) || blob_field_raw_pad_len(field) != len) return 0;
+	if(_blob_log_crc(rec.len, field, len) != be32toh(rec.crc)) return 0;
+	return BLOB_LOG_RECORD_HEADER_SIZE + len;
+}
+
+// cuts off what a failed append left behind
+static void _blob_log_undo(struct blob_log *self){
+	while(ftruncate(self->fd, self->size) < 0 && errno == EINTR);
+}
+
+static bool _blob_log_recover(struct blob_log *self, uint64_t file_size){
+	uint64_t offset = BLOB_LOG_HEADER_SIZE;
+	uint64_t len;
+	while((len = _blob_log_check_record(self, offset, file_size)) != 0){
+		offset += len;
+		self->records++;
+	}
+	self->size = offset;
+	if(offset != file_size && !(self->flags & BLOB_LOG_RDONLY))
+		return ftruncate(self->fd, offset) == 0;
+	return true;
+}
+
+bool blob_log_open(struct blob_log *self, const char *path, unsigned int flags){
+	struct stat st;
+
+	memset(self, 0, sizeof(*self));
+	self->flags = flags;
+	if(flags & BLOB_LOG_RDONLY) self->fd = open(path, O_RDONLY | O_CLOEXEC);
+	else if(flags & BLOB_LOG_TRUNCATE) self->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_NOFOLLOW | O_CLOEXEC, 0644);
+	else self->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+	if(self->fd < 0) return false;
+	if(fstat(self->fd, &st) < 0) goto fail;
+
+	if(st.st_size == 0 && !(flags & BLOB_LOG_RDONLY)){
+		if(pwrite(self->fd, BLOB_LOG_MAGIC, BLOB_LOG_HEADER_SIZE, 0) != BLOB_LOG_HEADER_SIZE) goto fail;
+		st.st_size = BLOB_LOG_HEADER_SIZE;
+	}
+	if(st.st_size < BLOB_LOG_HEADER_SIZE || !_blob_log_map(self, st.st_size)) goto fail;
+	if(memcmp(self->map, BLOB_LOG_MAGIC, BLOB_LOG_HEADER_SIZE) != 0) goto fail;
+	if(!_blob_log_recover(self, st.st_size)) goto fail;
+	return true;
+fail:
+	blob_log_close(self);
+	return false;
+}
+
+void blob_log_close(struct blob_log *self){
+	while(self->old_maps){
+		struct blob_log_map *old = self->old_maps;
+		self->old_maps = old->next;
+		munmap(old->map, old->size);
+		free(old);
+	}
+	if(self->map) munmap(self->map, self->map_size);
+	if(self->fd >= 0) close(self->fd);
+	self->map = NULL;
+	self->map_size = 0;
+	self->fd = -1;
+}
+
+bool blob_log_append(struct blob_log *self, const struct blob_field *field, uint64_t *offset){
+	uint32_t len = blob_field_raw_pad_len(field);
+	struct blob_log_record rec;
+
+	if(self->flags & BLOB_LOG_RDONLY) return false;
+	if(!_blob_log_map(self, self->size + sizeof(rec) + len)) return false;
+
+	rec.len = htobe32(len);
+	rec.crc = htobe32(_blob_log_crc(rec.len, field, len));
+
+	// header and data go out in one call and a short write is finished piece by piece
+	struct iovec iov[2] = {
+		{ .iov_base = &rec, .iov_len = sizeof(rec) },
+		{ .iov_base = (void*)(uintptr_t)field, .iov_len = len }
+	};
+	struct iovec *cur = iov;
+	int count = 2;
+	uint64_t pos = self->size;
+	while(count > 0){
+		ssize_t ret = pwritev(self->fd, cur, count, pos);
+		if(ret < 0 && errno == EINTR) continue;
+		if(ret <= 0){
+			// leave no partial record behind
+			_blob_log_undo(self);
+			return false;
+		}
+		pos += ret;
+		while(count > 0 && (size_t)ret >= cur->iov_len){
+			ret -= cur->iov_len;
+			cur++;
+			count--;
+		}
+		if(count > 0){
+			cur->iov_base = (char*)cur->iov_base + ret;
+			cur->iov_len -= ret;
+		}
+	}
+	// a record that may not be on disk is not kept either
+	if((self->flags & BLOB_LOG_SYNC) && fdatasync(self->fd) < 0){
+		_blob_log_undo(self);
+		return false;
+	}
+
+	if(offset) *offset = self->size;
+	self->size = pos;
+	self->records++;
+	return true;
+}
+
+const struct blob_field *blob_log_read(struct blob_log *self, uint64_t offset){
+	struct blob_log_record rec;
+	if(offset < BLOB_LOG_HEADER_SIZE || (offset & (BLOB_FIELD_ALIGN - 1))) return NULL;
+	if(offset + BLOB_LOG_RECORD_HEADER_SIZE + sizeof(struct blob_field) > self->size) return NULL;
+	memcpy(&rec, self->map + offset, sizeof(rec));
+	const struct blob_field *field = (const struct blob_field*)(self->map + offset + BLOB_LOG_RECORD_HEADER_SIZE);
+	// an offset inside a record is refused unless its bytes happen to look like a record header.
+	// The crc is not checked here, it was when the record was appended or the log was opened.
+	uint32_t len = be32toh(rec.len);
+	if(blob_field_raw_len(field) < sizeof(struct blob_field) || blob_field_raw_pad_len(field) != len) return NULL;
+	if(offset + BLOB_LOG_RECORD_HEADER_SIZE + len > self->size) return NULL;
+	return field;
+}
+
+const struct blob_field *blob_log_next(struct blob_log *self, uint64_t *offset){
+	if(*offset == 0) *offset = BLOB_LOG_HEADER_SIZE;
+	const struct blob_field *field = blob_log_read(self, *offset);
+	if(!field) return NULL;
+	*offset += BLOB_LOG_RECORD_HEADER_SIZE + blob_field_raw_pad_len(field);
+	return field;
+}
+
+bool blob_log_sync(struct blob_log *self){
+	return fdatasync(self->fd) == 0;
+}
+#endif
@@ -0,0 +1,82 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "blob.h"
+
+//! open the log for reading only. A damaged tail is ignored instead of truncated.
+#define BLOB_LOG_RDONLY (1 << 0)
+//! flush every record to disk before blob_log_append returns
+#define BLOB_LOG_SYNC (1 << 1)
+//! start with an empty log, cutting off whatever the file held. A symlink at path is refused.
+#define BLOB_LOG_TRUNCATE (1 << 2)
+
+//! the file starts with this 8 byte magic
+#define BLOB_LOG_MAGIC "BLOBLOG1"
+#define BLOB_LOG_HEADER_SIZE 8
+//! every record is a big endian length and crc32 followed by the blob data
+#define BLOB_LOG_RECORD_HEADER_SIZE 8
+//! the file is mapped in steps of at least this size so that reads rarely need a new mapping
+#define BLOB_LOG_MIN_MAP_SIZE (16 * 1024 * 1024)
+
+struct blob_log_map;
+
+//! An append only file of blobs. Records are read straight out of a read only mapping of the
+//! file. Only one blob_log may append to a file at a time.
+struct blob_log {
+	int fd;
+	unsigned int flags;
+	//! the current mapping of the file. Older (smaller) mappings are kept until the log is
+	//! closed so that pointers returned by the read functions stay valid until then.
+	char *map;
+	size_t map_size;
+	struct blob_log_map *old_maps;
+	//! end of the last valid record
+	uint64_t size;
+	//! number of valid records in the log
+	uint64_t records;
+};
+
+//! Opens (or creates unless BLOB_LOG_RDONLY is given) the log at path. The log is scanned and
+//! everything after the last record with a valid length and crc is cut off, which is what is
+//! left behind when the process dies in the middle of an append.
+bool blob_log_open(struct blob_log *self, const char *path, unsigned int flags);
+
+//! Unmaps and closes the log. Fields returned by the read functions are no longer valid.
+void blob_log_close(struct blob_log *self);
+
+//! Appends the field (usually blob_head() of a blob) as a new record. The offset of the record
+//! is stored in offset if it is not NULL. On failure (including a failed flush with
+//! BLOB_LOG_SYNC) the record is cut off again and the log is left as it was before the call.
+bool blob_log_append(struct blob_log *self, const struct blob_field *field, uint64_t *offset);
+
+//! Returns the record at offset (as returned by blob_log_append or blob_log_next) without
+//! copying it. Returns NULL if offset is not inside the log or does not point at a record header.
+//! Offsets inside a record are refused by a cheap length check only, so they must not come from
+//! untrusted input.
+const struct blob_field *blob_log_read(struct blob_log *self, uint64_t offset);
+
+//! Iterates over the records. Start with *offset set to 0. Returns the record at *offset and
+//! moves *offset to the next record, or returns NULL after the last record.
+const struct blob_field *blob_log_next(struct blob_log *self, uint64_t *offset);
+
+//! Flushes appended records to disk.
+bool blob_log_sync(struct blob_log *self);
@@ -0,0 +1,310 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <endian.h>
+#include "blob.h"
+#include "blob_msgpack.h"
+#include "blob_columns.h"
+#include "ieee754.h"
+
+/********************************
+** DECODING
+********************************/
+
+struct msgpack_reader {
+	const uint8_t *pos;
+	const uint8_t *end;
+};
+
+static inline bool _mp_read(struct msgpack_reader *self, size_t size, const uint8_t **out){
+	if((size_t)(self->end - self->pos) < size) return false;
+	*out = self->pos;
+	self->pos += size;
+	return true;
+}
+
+static inline bool _mp_read_uint(struct msgpack_reader *self, unsigned int bytes, uint64_t *out){
+	const uint8_t *p;
+	if(!_mp_read(self, bytes, &p)) return false;
+	uint64_t val = 0;
+	for(unsigned int c = 0; c < bytes; c++)
+		val = (val << 8) | p[c];
+	*out = val;
+	return true;
+}
+
+static bool _mp_put_value(struct blob *b, struct msgpack_reader *r, int depth);
+
+static bool _mp_put_string(struct blob *b, struct msgpack_reader *r, uint64_t len){
+	const uint8_t *p;
+	if(!_mp_read(r, len, &p)) return false;
+	// blob strings are null terminated so they can not hold a null byte
+	if(memchr(p, 0, len)) return false;
+	return blob_put_string_len(b, (const char*)p, len) != NULL;
+}
+
+static bool _mp_put_binary(struct blob *b, struct msgpack_reader *r, uint64_t len){
+	const uint8_t *p;
+	if(!_mp_read(r, len, &p)) return false;
+	blob_offset_t o = blob_open_array(b);
+	for(uint64_t c = 0; c < len; c++){
+		if(!blob_put_int(b, p[c])) return false;
+	}
+	blob_close_array(b, o);
+	return true;
+}
+
+static bool _mp_put_array(struct blob *b, struct msgpack_reader *r, uint64_t count, int depth){
+	// every element takes at least one byte
+	if(count > (uint64_t)(r->end - r->pos)) return false;
+	blob_offset_t o = blob_open_array(b);
+	for(uint64_t c = 0; c < count; c++){
+		if(!_mp_put_value(b, r, depth + 1)) return false;
+	}
+	blob_close_array(b, o);
+	return true;
+}
+
+static bool _mp_put_map(struct blob *b, struct msgpack_reader *r, uint64_t count, int depth){
+	if(count > (uint64_t)(r->end - r->pos) / 2) return false;
+	blob_offset_t o = blob_open_table(b);
+	for(uint64_t c = 0; c < count; c++){
+		// blob tables only have string keys
+		if(r->pos == r->end) return false;
+		uint8_t m = *r->pos;
+		if(!((m & 0xe0) == 0xa0 || m == 0xd9 || m == 0xda || m == 0xdb)) return false;
+		if(!_mp_put_value(b, r, depth + 1) || !_mp_put_value(b, r, depth + 1)) return false;
+	}
+	blob_close_table(b, o);
+	return true;
+}
+
+static bool _mp_put_value(struct blob *b, struct msgpack_reader *r, int depth){
+	const uint8_t *p;
+	uint64_t val;
+
+	if(depth > BLOB_MSGPACK_MAX_DEPTH) return false;
+	if(!_mp_read(r, 1, &p)) return false;
+
+	uint8_t m = *p;
+	if(m <= 0x7f) return blob_put_int(b, m) != NULL;
+	if(m >= 0xe0) return blob_put_int(b, (int8_t)m) != NULL;
+	switch(m & 0xf0){
+		case 0x80: return _mp_put_map(b, r, m & 0x0f, depth);
+		case 0x90: return _mp_put_array(b, r, m & 0x0f, depth);
+		case 0xa0:
+		case 0xb0: return _mp_put_string(b, r, m & 0x1f);
+	}
+
+	switch(m){
+		case 0xc0: return blob_put_int(b, 0) != NULL;
+		case 0xc2: return blob_put_bool(b, false) != NULL;
+		case 0xc3: return blob_put_bool(b, true) != NULL;
+		case 0xc4: case 0xc5: case 0xc6:
+			return _mp_read_uint(r, 1 << (m - 0xc4), &val) && _mp_put_binary(b, r, val);
+		case 0xca:
+			return _mp_read_uint(r, 4, &val) && blob_put_real(b, unpack754_32(val)) != NULL;
+		case 0xcb:
+			return _mp_read_uint(r, 8, &val) && blob_put_real(b, unpack754_64(val)) != NULL;
+		case 0xcc: case 0xcd: case 0xce: case 0xcf:
+			return _mp_read_uint(r, 1 << (m - 0xcc), &val) && val <= INT64_MAX && blob_put_int(b, (long long)val) != NULL;
+		case 0xd0: return _mp_read_uint(r, 1, &val) && blob_put_int(b, (int8_t)val) != NULL;
+		case 0xd1: return _mp_read_uint(r, 2, &val) && blob_put_int(b, (int16_t)val) != NULL;
+		case 0xd2: return _mp_read_uint(r, 4, &val) && blob_put_int(b, (int32_t)val) != NULL;
+		case 0xd3: return _mp_read_uint(r, 8, &val) && blob_put_int(b, (int64_t)val) != NULL;
+		case 0xd9: case 0xda: case 0xdb:
+			return _mp_read_uint(r, 1 << (m - 0xd9), &val) && _mp_put_string(b, r, val);
+		case 0xdc: case 0xdd:
+			return _mp_read_uint(r, 2 << (m - 0xdc), &val) && _mp_put_array(b, r, val, depth);
+		case 0xde: case 0xdf:
+			return _mp_read_uint(r, 2 << (m - 0xde), &val) && _mp_put_map(b, r, val, depth);
+	}
+	// ext types and the reserved 0xc1
+	return false;
+}
+
+bool blob_put_msgpack(struct blob *self, const void *data, size_t size){
+	struct msgpack_reader r = { .pos = data, .end = (const uint8_t*)data + size };
+	return _mp_put_value(self, &r, 0) && r.pos == r.end;
+}
+
+/********************************
+** ENCODING
+********************************/
+
+// output is collected in a small buffer so that the sink is not called for every byte
+struct msgpack_writer {
+	struct blob_sink *sink;
+	bool failed;
+	size_t len;
+	uint8_t buf[4096];
+};
+
+static void _mp_flush(struct msgpack_writer *self){
+	if(self->len && !self->failed && !self->sink->write(self->sink, self->buf, self->len))
+		self->failed = true;
+	self->len = 0;
+}
+
+static void _mp_write(struct msgpack_writer *self, const void *data, size_t size){
+	if(self->len + size > sizeof(self->buf)){
+		_mp_flush(self);
+		if(size > sizeof(self->buf)){
+			if(!self->failed && !self->sink->write(self->sink, data, size))
+				self->failed = true;
+			return;
+		}
+	}
+	memcpy(self->buf + self->len, data, size);
+	self->len += size;
+}
+
+static void _mp_write_uint(struct msgpack_writer *self, uint8_t marker, uint64_t val, unsigned int bytes){
+	uint8_t out[9];
+	out[0] = marker;
+	for(unsigned int c = 0; c < bytes; c++)
+		out[bytes - c] = (uint8_t)(val >> (8 * c));
+	_mp_write(self, out, bytes + 1);
+}
+
+static void _mp_write_int(struct msgpack_writer *self, long long val){
+	if(val >= 0){
+		if(val <= 0x7f) _mp_write_uint(self, (uint8_t)val, 0, 0);
+		else if(val <= UINT8_MAX) _mp_write_uint(self, 0xcc, val, 1);
+		else if(val <= UINT16_MAX) _mp_write_uint(self, 0xcd, val, 2);
+		else if(val <= UINT32_MAX) _mp_write_uint(self, 0xce, val, 4);
+		else _mp_write_uint(self, 0xcf, val, 8);
+	} else {
+		if(val >= -32) _mp_write_uint(self, (uint8_t)val, 0, 0);
+		else if(val >= INT8_MIN) _mp_write_uint(self, 0xd0, (uint8_t)val, 1);
+		else if(val >= INT16_MIN) _mp_write_uint(self, 0xd1, (uint16_t)val, 2);
+		else if(val >= INT32_MIN) _mp_write_uint(self, 0xd2, (uint32_t)val, 4);
+		else _mp_write_uint(self, 0xd3, (uint64_t)val, 8);
+	}
+}
+
+static void _mp_write_header(struct msgpack_writer *self, uint8_t fix, uint8_t m16, size_t count){
+	if(count <= 15) _mp_write_uint(self, fix | count, 0, 0);
+	else if(count <= UINT16_MAX) _mp_write_uint(self, m16, count, 2);
+	else _mp_write_uint(self, m16 + 1, count, 4);
+}
+
+static void _mp_write_string(struct msgpack_writer *self, const char *str){
+	size_t len = strlen(str);
+	if(len <= 31) _mp_write_uint(self, 0xa0 | len, 0, 0);
+	else if(len <= UINT8_MAX) _mp_write_uint(self, 0xd9, len, 1);
+	else if(len <= UINT16_MAX) _mp_write_uint(self, 0xda, len, 2);
+	else _mp_write_uint(self, 0xdb, len, 4);
+	_mp_write(self, str, len);
+}
+
+static void _mp_write_cell(struct msgpack_writer *self, const struct blob_column *column, uint32_t row){
+	switch(column->type){
+		case BLOB_FIELD_FLOAT32:
+			_mp_write_uint(self, 0xca, pack754_32(blob_column_get_real(column, row)), 4);
+			break;
+		case BLOB_FIELD_FLOAT64:
+			_mp_write_uint(self, 0xcb, pack754_64(blob_column_get_real(column, row)), 8);
+			break;
+		case BLOB_FIELD_STRING:
+			_mp_write_string(self, blob_column_get_string(column, row));
+			break;
+		default:
+			_mp_write_int(self, blob_column_get_int(column, row));
+			break;
+	}
+}
+
+// columns are written out as the array of maps that they were built from
+static void _mp_write_columns(struct msgpack_writer *self, const struct blob_field *attr){
+	const struct blob_field *key;
+	struct blob_column column;
+	uint32_t rows = blob_columns_rows(attr);
+	size_t count = 0;
+
+	blob_columns_for_each_kv(attr, key, column) count++;
+	_mp_write_header(self, 0x90, 0xdc, rows);
+	for(uint32_t row = 0; row < rows; row++){
+		_mp_write_header(self, 0x80, 0xde, count);
+		blob_columns_for_each_kv(attr, key, column){
+			_mp_write_string(self, blob_field_get_string(key));
+			_mp_write_cell(self, &column, row);
+		}
+	}
+}
+
+static void _mp_write_field(struct msgpack_writer *self, const struct blob_field *attr){
+	const struct blob_field *child;
+	size_t count = 0;
+	bool array;
+
+	switch(blob_field_type(attr)){
+		case BLOB_FIELD_INT8:
+		case BLOB_FIELD_INT16:
+		case BLOB_FIELD_INT32:
+		case BLOB_FIELD_INT64:
+			_mp_write_int(self, blob_field_get_int(attr));
+			break;
+		// blob floats are already stored as big endian ieee 754 just like in msgpack
+		case BLOB_FIELD_FLOAT32:
+			_mp_write_uint(self, 0xca, 0, 0);
+			_mp_write(self, blob_field_data(attr), 4);
+			break;
+		case BLOB_FIELD_FLOAT64:
+			_mp_write_uint(self, 0xcb, 0, 0);
+			_mp_write(self, blob_field_data(attr), 8);
+			break;
+		case BLOB_FIELD_STRING:
+			_mp_write_string(self, blob_field_get_string(attr));
+			break;
+		case BLOB_FIELD_ARRAY:
+		case BLOB_FIELD_TABLE:
+			array = blob_field_type(attr) == BLOB_FIELD_ARRAY;
+			blob_field_for_each_child(attr, child){
+				if(!array && (count & 1) == 0 && blob_field_type(child) != BLOB_FIELD_STRING)
+					array = true;
+				count++;
+			}
+			if(array){
+				_mp_write_header(self, 0x90, 0xdc, count);
+			} else {
+				_mp_write_header(self, 0x80, 0xde, (count + 1) / 2);
+			}
+			blob_field_for_each_child(attr, child)
+				_mp_write_field(self, child);
+			// a key without a value
+			if(!array && (count & 1))
+				_mp_write_uint(self, 0xc0, 0, 0);
+			break;
+		case BLOB_FIELD_COLUMNS:
+			_mp_write_columns(self, attr);
+			break;
+		default:
+			_mp_write_uint(self, 0xc0, 0, 0);
+			break;
+	}
+}
+
+bool blob_field_to_msgpack(const struct blob_field *self, struct blob_sink *sink){
+	struct msgpack_writer w;
+	w.sink = sink;
+	w.failed = false;
+	w.len = 0;
+	_mp_write_field(&w, self);
+	_mp_flush(&w);
+	return !w.failed;
+}
@@ -0,0 +1,36 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "blob.h"
+#include "blob_sink.h"
+
+//! maximum nesting of arrays and maps accepted by blob_put_msgpack
+#define BLOB_MSGPACK_MAX_DEPTH 1024
+
+//! Decodes one msgpack value from data and writes it to the blob. Maps must have string keys,
+//! nil is written as 0 (like json null), bin as an array of integers. Ext types and strings that
+//! contain a null byte are rejected.
+//! Returns false if the data is not exactly one valid msgpack value.
+bool blob_put_msgpack(struct blob *self, const void *data, size_t size);
+
+//! Encodes the field as msgpack into the sink. Tables whose keys are not all strings are
+//! written as arrays, the same way as blob_field_to_json does.
+bool blob_field_to_msgpack(const struct blob_field *self, struct blob_sink *sink);
@@ -0,0 +1,214 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "blob.h"
+#include "blob_json.h"
+#include "blob_ndjson.h"
+
+#if defined(HAVE_UNISTD_H) && defined(HAVE_PTHREAD_H)
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+struct blob_ndjson {
+	const char *data;
+	size_t size;
+	unsigned int flags;
+	blob_ndjson_cb_t cb;
+	void *priv;
+
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	// everything below is protected by the lock
+	size_t pos;
+	uint64_t next_seq;
+	uint64_t deliver_seq;
+	bool stop;
+};
+
+struct blob_ndjson_worker {
+	struct blob_ndjson *job;
+	pthread_t thread;
+	bool running;
+	struct blob blob;
+	// lines are copied here so that the decoder always gets a zero terminated string
+	char *line;
+	size_t line_size;
+};
+
+static bool _ndjson_put_line(struct blob_ndjson_worker *self, const char *line, size_t len){
+	if(len + 1 > self->line_size){
+		char *buf = realloc(self->line, len + 1);
+		if(!buf) return false;
+		self->line = buf;
+		self->line_size = len + 1;
+	}
+	memcpy(self->line, line, len);
+	self->line[len] = 0;
+
+	// a failed line may have left a partial value behind so roll the blob back
+	unsigned int len_before = blob_field_raw_len(blob_head(&self->blob));
+	if(!blob_put_json(&self->blob, self->line)){
+		blob_field_set_raw_len(blob_head(&self->blob), len_before);
+		return false;
+	}
+	return true;
+}
+
+static void _ndjson_parse_chunk(struct blob_ndjson_worker *self, const char *data, size_t size, struct blob_ndjson_batch *batch){
+	const char *end = data + size;
+	while(data < end){
+		const char *nl = memchr(data, '\n', end - data);
+		const char *line_end = nl ? nl : end;
+		const char *next = nl ? nl + 1 : end;
+
+		if(line_end > data && line_end[-1] == '\r') line_end--;
+		while(data < line_end && (*data == ' ' || *data == '\t')) data++;
+
+		if(data < line_end){
+			batch->lines++;
+			if(!_ndjson_put_line(self, data, line_end - data))
+				batch->errors++;
+		}
+		data = next;
+	}
+}
+
+static void *_ndjson_worker(void *arg){
+	struct blob_ndjson_worker *self = arg;
+	struct blob_ndjson *job = self->job;
+
+	for(;;){
+		struct blob_ndjson_batch batch;
+		size_t start, end;
+
+		// hand out the next chunk of the file extended to the end of its last line
+		pthread_mutex_lock(&job->lock);
+		if(job->stop || job->pos >= job->size){
+			pthread_mutex_unlock(&job->lock);
+			break;
+		}
+		start = job->pos;
+		end = start + BLOB_NDJSON_CHUNK_SIZE;
+		if(end >= job->size){
+			end = job->size;
+		} else {
+			const char *nl = memchr(job->data + end, '\n', job->size - end);
+			end = nl ? (size_t)(nl - job->data) + 1 : job->size;
+		}
+		job->pos = end;
+		memset(&batch, 0, sizeof(batch));
+		batch.seq = job->next_seq++;
+		batch.offset = start;
+		batch.blob = &self->blob;
+		pthread_mutex_unlock(&job->lock);
+
+		blob_reset(&self->blob);
+		_ndjson_parse_chunk(self, job->data + start, end - start, &batch);
+
+		if(job->flags & BLOB_NDJSON_UNORDERED){
+			if(!job->cb(job->priv, &batch)){
+				pthread_mutex_lock(&job->lock);
+				job->stop = true;
+				pthread_mutex_unlock(&job->lock);
+			}
+			continue;
+		}
+
+		// wait for our turn so that batches are delivered in file order
+		pthread_mutex_lock(&job->lock);
+		while(!job->stop && job->deliver_seq != batch.seq)
+			pthread_cond_wait(&job->cond, &job->lock);
+		if(job->stop){
+			pthread_mutex_unlock(&job->lock);
+			break;
+		}
+		pthread_mutex_unlock(&job->lock);
+
+		bool ok = job->cb(job->priv, &batch);
+
+		pthread_mutex_lock(&job->lock);
+		job->deliver_seq++;
+		if(!ok) job->stop = true;
+		pthread_cond_broadcast(&job->cond);
+		pthread_mutex_unlock(&job->lock);
+	}
+	return NULL;
+}
+
+bool blob_ndjson_ingest(int fd, unsigned int nthreads, unsigned int flags, blob_ndjson_cb_t cb, void *priv){
+	struct stat st;
+	if(!cb || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) return false;
+	if(st.st_size == 0) return true;
+
+	if(nthreads == 0){
+		long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = (ncpu > 0)?ncpu:1;
+	}
+
+	struct blob_ndjson job;
+	memset(&job, 0, sizeof(job));
+	job.size = st.st_size;
+	job.flags = flags;
+	job.cb = cb;
+	job.priv = priv;
+
+	void *data = mmap(NULL, job.size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if(data == MAP_FAILED) return false;
+	madvise(data, job.size, MADV_SEQUENTIAL);
+	job.data = data;
+
+	struct blob_ndjson_worker *workers = calloc(nthreads, sizeof(*workers));
+	if(!workers){
+		munmap(data, job.size);
+		return false;
+	}
+
+	pthread_mutex_init(&job.lock, NULL);
+	pthread_cond_init(&job.cond, NULL);
+
+	// the calling thread works as well so we only start nthreads - 1 threads
+	for(unsigned int c = 0; c < nthreads; c++){
+		workers[c].job = &job;
+		blob_init(&workers[c].blob, 0, 0);
+		if(c > 0)
+			workers[c].running = pthread_create(&workers[c].thread, NULL, _ndjson_worker, &workers[c]) == 0;
+	}
+	_ndjson_worker(&workers[0]);
+
+	for(unsigned int c = 1; c < nthreads; c++){
+		if(workers[c].running)
+			pthread_join(workers[c].thread, NULL);
+	}
+
+	for(unsigned int c = 0; c < nthreads; c++){
+		blob_free(&workers[c].blob);
+		free(workers[c].line);
+	}
+
+	bool ret = !job.stop;
+
+	pthread_cond_destroy(&job.cond);
+	pthread_mutex_destroy(&job.lock);
+	free(workers);
+	munmap(data, job.size);
+	return ret;
+}
+#endif
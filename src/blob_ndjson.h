@@ -0,0 +1,51 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "blob.h"
+
+//! deliver batches as soon as they are parsed instead of in file order
+#define BLOB_NDJSON_UNORDERED (1 << 0)
+
+//! approximate amount of input that goes into one batch
+#define BLOB_NDJSON_CHUNK_SIZE (1024 * 1024)
+
+struct blob_ndjson_batch {
+	//! batches are numbered from 0 in the order in which they appear in the file
+	uint64_t seq;
+	//! byte offset of the first line of the batch in the file
+	uint64_t offset;
+	//! number of non empty lines in the batch
+	uint32_t lines;
+	//! number of lines that could not be parsed and were left out of the blob
+	uint32_t errors;
+	//! one root element for every line that was parsed. Only valid during the callback.
+	struct blob *blob;
+};
+
+//! return false to stop the ingestion
+typedef bool (*blob_ndjson_cb_t)(void *priv, const struct blob_ndjson_batch *batch);
+
+//! Parses a newline delimited json file on nthreads threads (0 for one per cpu).
+//! The file is split into batches of whole lines that are parsed into per thread blobs.
+//! Batches are passed to the callback one at a time in file order unless flags contain
+//! BLOB_NDJSON_UNORDERED in which case the callback may be called from several threads at once.
+//! Returns false if the file could not be mapped or the callback stopped the ingestion.
+bool blob_ndjson_ingest(int fd, unsigned int nthreads, unsigned int flags, blob_ndjson_cb_t cb, void *priv);
@@ -0,0 +1,58 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "blob.h"
+#include "blob_pool.h"
+
+bool blob_pool_init(struct blob_pool *self, size_t max, size_t blob_size){
+	memset(self, 0, sizeof(*self));
+	if(blob_size < sizeof(struct blob_field)) blob_size = sizeof(struct blob_field);
+	self->blobs = calloc(max ? max : 1, sizeof(struct blob));
+	if(!self->blobs) return false;
+	self->max = max;
+	self->blob_size = blob_size;
+	return true;
+}
+
+void blob_pool_free(struct blob_pool *self){
+	while(self->count) blob_free(&self->blobs[--self->count]);
+	free(self->blobs);
+	self->blobs = NULL;
+	self->max = 0;
+}
+
+bool blob_pool_get(struct blob_pool *self, struct blob *blob){
+	if(self->count){
+		*blob = self->blobs[--self->count];
+		return true;
+	}
+	blob_init(blob, NULL, self->blob_size);
+	return blob->buf != NULL;
+}
+
+void blob_pool_put(struct blob_pool *self, struct blob *blob){
+	if(!blob->buf || blob->fixed) return;
+	if(self->count < self->max && blob->memlen <= self->blob_size * 16)
+		self->blobs[self->count++] = *blob;
+	else
+		blob_free(blob);
+	blob->buf = NULL;
+	blob->memlen = 0;
+}
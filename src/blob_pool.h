@@ -0,0 +1,49 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "blob.h"
+
+//! A free list of blobs so that buffers of messages that come and go all the time are reused
+//! instead of being allocated and freed for every message.
+struct blob_pool {
+	struct blob *blobs;
+	size_t count;
+	//! at most this many free blobs are kept
+	size_t max;
+	//! new blobs are allocated with this many bytes. Blobs that have grown to more than 16
+	//! times this size are freed instead of kept.
+	size_t blob_size;
+};
+
+//! Sets up an empty pool that keeps up to max free blobs of (initially) blob_size bytes.
+bool blob_pool_init(struct blob_pool *self, size_t max, size_t blob_size);
+
+//! Frees the pool and all blobs in it.
+void blob_pool_free(struct blob_pool *self);
+
+//! Moves a free blob into blob or allocates a new one if the pool is empty. A blob from the
+//! pool still holds whatever was in it before, call blob_reset() before writing into it.
+bool blob_pool_get(struct blob_pool *self, struct blob *blob);
+
+//! Gives blob back to the pool (or frees it if the pool is full). blob->buf is set to NULL.
+//! Blobs that do not own their memory and blobs without a buffer are left alone.
+void blob_pool_put(struct blob_pool *self, struct blob *blob);
@@ -0,0 +1,152 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "blob.h"
+#include "blob_queue.h"
+
+#ifdef HAVE_UNISTD_H
+#include <sched.h>
+#endif
+
+// the largest ring, so that record lengths fit the 32 bit header fields
+#define BLOB_QUEUE_MAX_SIZE ((size_t)1 << 31)
+// marks the space at the end of the ring that a record did not fit into
+#define BLOB_QUEUE_SKIP UINT32_MAX
+
+// len is the size of the whole record. Messages store the size of the skip record in front of
+// them in pad so that the writer can find where its reservation started when it commits.
+struct blob_queue_record {
+	uint32_t len;
+	uint32_t pad;
+	char data[];
+};
+
+static inline size_t _queue_align(size_t len){
+	return (len + BLOB_QUEUE_RECORD_HEADER_SIZE - 1) & ~(size_t)(BLOB_QUEUE_RECORD_HEADER_SIZE - 1);
+}
+
+static inline struct blob_queue_record *_queue_record(struct blob_queue *self, uint64_t pos){
+	return (struct blob_queue_record*)(void*)(self->buf + (pos & (self->size - 1)));
+}
+
+static inline void _queue_relax(void){
+#ifdef HAVE_UNISTD_H
+	sched_yield();
+#endif
+}
+
+bool blob_queue_init(struct blob_queue *self, size_t size, unsigned int flags){
+	size_t ring = 64;
+	memset(self, 0, sizeof(*self));
+	if(size > BLOB_QUEUE_MAX_SIZE) return false;
+	while(ring < size) ring <<= 1;
+	if(!(self->buf = malloc(ring))) return false;
+	self->size = ring;
+	self->flags = flags;
+	self->state = &self->local;
+	atomic_init(&self->state->head, 0);
+	atomic_init(&self->state->committed, 0);
+	atomic_init(&self->state->tail, 0);
+	return true;
+}
+
+void blob_queue_free(struct blob_queue *self){
+	free(self->buf);
+	self->buf = NULL;
+	self->size = 0;
+}
+
+bool blob_queue_reserve(struct blob_queue *self, struct blob *blob, size_t size){
+	size_t len = _queue_align(BLOB_QUEUE_RECORD_HEADER_SIZE + size);
+	uint64_t head = atomic_load_explicit(&self->state->head, memory_order_relaxed);
+	size_t pad;
+
+	if(len > self->size) return false;
+	for(;;){
+		// tail is loaded with acquire so that the reader is done with the space before it is reused
+		uint64_t tail = atomic_load_explicit(&self->state->tail, memory_order_acquire);
+		size_t pos = head & (self->size - 1);
+		// a record never wraps around the end of the ring since the blob must be contiguous
+		pad = (pos + len > self->size) ? self->size - pos : 0;
+		if(head + pad + len - tail > self->size) return false;
+		if(!(self->flags & BLOB_QUEUE_MPSC)){
+			atomic_store_explicit(&self->state->head, head + pad + len, memory_order_relaxed);
+			break;
+		}
+		if(atomic_compare_exchange_weak_explicit(&self->state->head, &head, head + pad + len, memory_order_relaxed, memory_order_relaxed))
+			break;
+	}
+
+	if(pad){
+		struct blob_queue_record *skip = _queue_record(self, head);
+		skip->len = pad;
+		skip->pad = BLOB_QUEUE_SKIP;
+	}
+	struct blob_queue_record *rec = _queue_record(self, head + pad);
+	rec->len = len;
+	rec->pad = pad;
+	blob_init_fixed(blob, rec->data, len - BLOB_QUEUE_RECORD_HEADER_SIZE);
+	return true;
+}
+
+void blob_queue_commit(struct blob_queue *self, struct blob *blob){
+	struct blob_queue_record *rec = (struct blob_queue_record*)(void*)((char*)blob->buf - BLOB_QUEUE_RECORD_HEADER_SIZE);
+	size_t start = ((char*)rec - self->buf - rec->pad) & (self->size - 1);
+	uint64_t committed = atomic_load_explicit(&self->state->committed, memory_order_relaxed);
+
+	if(!(self->flags & BLOB_QUEUE_MPSC)){
+		// the only writer can give back the part of the slot that the blob did not use
+		rec->len = _queue_align(BLOB_QUEUE_RECORD_HEADER_SIZE + blob_size(blob));
+		atomic_store_explicit(&self->state->head, committed + rec->pad + rec->len, memory_order_relaxed);
+	} else {
+		// wait for the writers that reserved before us. The committed position is less than a
+		// ring size behind our start so comparing the ring offsets is enough.
+		while(((committed = atomic_load_explicit(&self->state->committed, memory_order_acquire)) & (self->size - 1)) != start)
+			_queue_relax();
+	}
+	atomic_store_explicit(&self->state->committed, committed + rec->pad + rec->len, memory_order_release);
+	blob->buf = NULL;
+	blob->memlen = 0;
+}
+
+const struct blob_field *blob_queue_peek(struct blob_queue *self){
+	uint64_t tail = atomic_load_explicit(&self->state->tail, memory_order_relaxed);
+	uint64_t committed = atomic_load_explicit(&self->state->committed, memory_order_acquire);
+
+	while(tail != committed){
+		struct blob_queue_record *rec = _queue_record(self, tail);
+		// the writer may be another process so nothing in the ring is trusted
+		if(rec->len < BLOB_QUEUE_RECORD_HEADER_SIZE || (tail & (self->size - 1)) + rec->len > self->size) return NULL;
+		if(rec->pad != BLOB_QUEUE_SKIP){
+			const struct blob_field *field = (const struct blob_field*)(const void*)rec->data;
+			if(rec->len - BLOB_QUEUE_RECORD_HEADER_SIZE < sizeof(struct blob_field) ||
+				blob_field_raw_pad_len(field) > rec->len - BLOB_QUEUE_RECORD_HEADER_SIZE) return NULL;
+			return field;
+		}
+		tail += rec->len;
+		atomic_store_explicit(&self->state->tail, tail, memory_order_release);
+	}
+	return NULL;
+}
+
+void blob_queue_release(struct blob_queue *self){
+	uint64_t tail = atomic_load_explicit(&self->state->tail, memory_order_relaxed);
+	if(tail == atomic_load_explicit(&self->state->committed, memory_order_acquire)) return;
+	atomic_store_explicit(&self->state->tail, tail + _queue_record(self, tail)->len, memory_order_release);
+}
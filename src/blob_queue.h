@@ -0,0 +1,85 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "blob.h"
+
+//! any number of threads may write to the queue (one thread otherwise)
+#define BLOB_QUEUE_MPSC (1 << 0)
+
+//! every record in the ring starts with this header and is aligned to it
+#define BLOB_QUEUE_RECORD_HEADER_SIZE 8
+
+//! A bounded ring of blobs for passing messages between threads without copying them. Writers
+//! reserve a slot, encode into it with the normal blob_put_* functions through a struct blob
+//! bound to the slot and commit it. The single reader gets the blobs in place as fields.
+//!
+//! Commits are published in the order the slots were reserved, so with BLOB_QUEUE_MPSC a
+//! writer that is slow to commit holds back the messages reserved after it. None of the
+//! functions block: reserve fails while the ring is full and peek returns NULL while it is
+//! empty.
+//!
+//! Without BLOB_QUEUE_MPSC the writer gets back the unused part of a slot when it commits, so it
+//! must commit a slot before it reserves the next one.
+struct blob_queue_state {
+	//! end of the reserved space, advanced by writers
+	_Atomic uint64_t head __attribute__((aligned(64)));
+	//! end of the committed space, everything before it can be read
+	_Atomic uint64_t committed __attribute__((aligned(64)));
+	//! start of the unread space, advanced by the reader
+	_Atomic uint64_t tail __attribute__((aligned(64)));
+};
+
+struct blob_queue {
+	char *buf;
+	size_t size;
+	unsigned int flags;
+	//! points to local for queues between threads. Queues between processes keep the ring and
+	//! its state in shared memory (see blob_shm.h).
+	struct blob_queue_state *state;
+	struct blob_queue_state local;
+};
+
+//! Allocates a ring of size bytes (rounded up to a power of two). A message takes its encoded
+//! size plus BLOB_QUEUE_RECORD_HEADER_SIZE rounded up to 8 bytes. A slot never wraps around the
+//! end of the ring, so the space up to the end is lost when a slot does not fit before it. Only
+//! slots of up to half the ring (including the record header) can always be reserved once the
+//! ring is empty; larger ones also depend on where the last message ended.
+bool blob_queue_init(struct blob_queue *self, size_t size, unsigned int flags);
+
+void blob_queue_free(struct blob_queue *self);
+
+//! Reserves a slot of up to size bytes and binds blob to it with blob_init_fixed(). Writes that
+//! do not fit into the slot fail like writes to any fixed blob. Returns false if the ring does
+//! not have size bytes free in one piece. Every reserved slot must be committed.
+bool blob_queue_reserve(struct blob_queue *self, struct blob *blob, size_t size);
+
+//! Publishes the blob reserved with blob_queue_reserve() to the reader. The blob must not be
+//! used after this.
+void blob_queue_commit(struct blob_queue *self, struct blob *blob);
+
+//! Returns the oldest message (the head field of the blob that was committed) or NULL if there
+//! is none. The field stays valid until blob_queue_release() is called.
+const struct blob_field *blob_queue_peek(struct blob_queue *self);
+
+//! Frees the message returned by blob_queue_peek().
+void blob_queue_release(struct blob_queue *self);
@@ -0,0 +1,223 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// memfd_create
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "blob.h"
+#include "blob_shm.h"
+
+#if defined(HAVE_LINUX_FUTEX_H) && defined(HAVE_UNISTD_H)
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+// same limit as blob_queue
+#define BLOB_SHM_MAX_SIZE ((size_t)1 << 31)
+
+struct blob_shm_header {
+	char magic[8];
+	uint64_t size;
+	uint32_t flags;
+	//! bumped on every commit and on every release. Sleepers wait for these to change.
+	_Atomic uint32_t data_seq;
+	_Atomic uint32_t space_seq;
+	_Atomic uint32_t readers_waiting;
+	_Atomic uint32_t writers_waiting;
+	struct blob_queue_state state;
+};
+
+static int _shm_futex(_Atomic uint32_t *word, int op, uint32_t val, const struct timespec *timeout){
+	return syscall(SYS_futex, (void*)(uintptr_t)word, op, val, timeout, NULL, 0);
+}
+
+static int64_t _shm_now_ms(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// sleeps while *word is val. Returns false once the deadline (-1 for none) has passed.
+static bool _shm_wait(_Atomic uint32_t *word, uint32_t val, int64_t deadline){
+	struct timespec ts, *timeout = NULL;
+	if(deadline >= 0){
+		int64_t left = deadline - _shm_now_ms();
+		if(left <= 0) return false;
+		ts.tv_sec = left / 1000;
+		ts.tv_nsec = (left % 1000) * 1000000;
+		timeout = &ts;
+	}
+	_shm_futex(word, FUTEX_WAIT, val, timeout);
+	return true;
+}
+
+static void _shm_wake(_Atomic uint32_t *seq, _Atomic uint32_t *waiting, int count){
+	atomic_fetch_add(seq, 1);
+	// pairs with the fence in the sleeper between announcing itself and checking the ring again
+	atomic_thread_fence(memory_order_seq_cst);
+	if(atomic_load_explicit(waiting, memory_order_relaxed)) _shm_futex(seq, FUTEX_WAKE, count, NULL);
+}
+
+static bool _shm_map(struct blob_shm_channel *self){
+	struct stat st;
+
+	if(fstat(self->fd, &st) < 0 || st.st_size <= BLOB_SHM_HEADER_SIZE) return false;
+	void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, self->fd, 0);
+	if(map == MAP_FAILED) return false;
+	self->map = map;
+	self->map_size = st.st_size;
+	self->header = map;
+
+	// the size comes from the other process so it has to match what was actually mapped
+	uint64_t size = self->header->size;
+	if(memcmp(self->header->magic, BLOB_SHM_MAGIC, sizeof(self->header->magic)) != 0) return false;
+	if(size < 64 || size > BLOB_SHM_MAX_SIZE || (size & (size - 1)) || size + BLOB_SHM_HEADER_SIZE != self->map_size) return false;
+
+	memset(&self->queue, 0, sizeof(self->queue));
+	self->queue.buf = self->map + BLOB_SHM_HEADER_SIZE;
+	self->queue.size = size;
+	self->queue.flags = self->header->flags;
+	self->queue.state = &self->header->state;
+	return true;
+}
+
+bool blob_shm_channel_create(struct blob_shm_channel *self, const char *path, size_t size, unsigned int flags){
+	size_t ring = 64;
+
+	memset(self, 0, sizeof(*self));
+	self->fd = -1;
+	if(size > BLOB_SHM_MAX_SIZE) return false;
+	while(ring < size) ring <<= 1;
+
+	if(path){
+		self->fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+	} else {
+#ifdef HAVE_MEMFD_CREATE
+		self->fd = memfd_create("blob_shm_channel", MFD_CLOEXEC);
+#endif
+	}
+	if(self->fd < 0) return false;
+	if(ftruncate(self->fd, BLOB_SHM_HEADER_SIZE + ring) < 0) goto fail;
+
+	struct blob_shm_header *header = mmap(NULL, BLOB_SHM_HEADER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, self->fd, 0);
+	if(header == MAP_FAILED) goto fail;
+	header->size = ring;
+	header->flags = flags;
+	atomic_init(&header->data_seq, 0);
+	atomic_init(&header->space_seq, 0);
+	atomic_init(&header->readers_waiting, 0);
+	atomic_init(&header->writers_waiting, 0);
+	atomic_init(&header->state.head, 0);
+	atomic_init(&header->state.committed, 0);
+	atomic_init(&header->state.tail, 0);
+	// the magic goes last so that a process opening the file early does not see a half made header
+	atomic_thread_fence(memory_order_release);
+	memcpy(header->magic, BLOB_SHM_MAGIC, sizeof(header->magic));
+	munmap(header, BLOB_SHM_HEADER_SIZE);
+
+	if(!_shm_map(self)) goto fail;
+	return true;
+fail:
+	blob_shm_channel_close(self);
+	return false;
+}
+
+bool blob_shm_channel_open(struct blob_shm_channel *self, const char *path){
+	memset(self, 0, sizeof(*self));
+	self->fd = open(path, O_RDWR | O_CLOEXEC);
+	if(self->fd < 0) return false;
+	if(_shm_map(self)) return true;
+	blob_shm_channel_close(self);
+	return false;
+}
+
+bool blob_shm_channel_open_fd(struct blob_shm_channel *self, int fd){
+	memset(self, 0, sizeof(*self));
+	self->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if(self->fd < 0) return false;
+	if(_shm_map(self)) return true;
+	blob_shm_channel_close(self);
+	return false;
+}
+
+void blob_shm_channel_close(struct blob_shm_channel *self){
+	if(self->map) munmap(self->map, self->map_size);
+	if(self->fd >= 0) close(self->fd);
+	self->map = NULL;
+	self->header = NULL;
+	self->fd = -1;
+}
+
+bool blob_shm_channel_reserve(struct blob_shm_channel *self, struct blob *blob, size_t size, int timeout_ms){
+	int64_t deadline = (timeout_ms < 0) ? -1 : _shm_now_ms() + timeout_ms;
+	struct blob_shm_header *header = self->header;
+
+	// a message that is bigger than the ring would wait forever
+	if(size + BLOB_QUEUE_RECORD_HEADER_SIZE > self->queue.size) return false;
+	for(;;){
+		if(blob_queue_reserve(&self->queue, blob, size)) return true;
+		if(timeout_ms == 0) return false;
+
+		uint32_t seq = atomic_load(&header->space_seq);
+		atomic_fetch_add(&header->writers_waiting, 1);
+		atomic_thread_fence(memory_order_seq_cst);
+		bool ok = blob_queue_reserve(&self->queue, blob, size);
+		bool waited = ok || _shm_wait(&header->space_seq, seq, deadline);
+		atomic_fetch_sub(&header->writers_waiting, 1);
+		if(ok) return true;
+		if(!waited) return blob_queue_reserve(&self->queue, blob, size);
+	}
+}
+
+void blob_shm_channel_commit(struct blob_shm_channel *self, struct blob *blob){
+	blob_queue_commit(&self->queue, blob);
+	_shm_wake(&self->header->data_seq, &self->header->readers_waiting, 1);
+}
+
+const struct blob_field *blob_shm_channel_peek(struct blob_shm_channel *self, int timeout_ms){
+	int64_t deadline = (timeout_ms < 0) ? -1 : _shm_now_ms() + timeout_ms;
+	struct blob_shm_header *header = self->header;
+	const struct blob_field *msg;
+
+	for(;;){
+		if((msg = blob_queue_peek(&self->queue)) != NULL) return msg;
+		if(timeout_ms == 0) return NULL;
+
+		uint32_t seq = atomic_load(&header->data_seq);
+		atomic_store(&header->readers_waiting, 1);
+		atomic_thread_fence(memory_order_seq_cst);
+		msg = blob_queue_peek(&self->queue);
+		bool waited = msg || _shm_wait(&header->data_seq, seq, deadline);
+		atomic_store(&header->readers_waiting, 0);
+		if(msg) return msg;
+		if(!waited) return blob_queue_peek(&self->queue);
+	}
+}
+
+void blob_shm_channel_release(struct blob_shm_channel *self){
+	blob_queue_release(&self->queue);
+	_shm_wake(&self->header->space_seq, &self->header->writers_waiting, INT_MAX);
+}
+#endif
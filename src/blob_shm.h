@@ -0,0 +1,76 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "blob.h"
+#include "blob_queue.h"
+
+//! the mapping starts with a page holding the magic, the ring size and the ring state
+#define BLOB_SHM_MAGIC "BLOBSHM1"
+#define BLOB_SHM_HEADER_SIZE 4096
+
+struct blob_shm_header;
+
+//! A blob_queue in memory shared between processes. Writers encode straight into the shared
+//! ring and the reader gets the messages in place, so a message is never copied. A reader with
+//! nothing to read and writers without space sleep on a futex in the shared page and are only
+//! woken when the other side sees that someone is sleeping.
+//!
+//! Pass BLOB_QUEUE_MPSC to blob_shm_channel_create() if more than one process (or thread)
+//! writes. There is always exactly one reader.
+//!
+//! Channels need linux futexes. Elsewhere the functions are declared but not built.
+struct blob_shm_channel {
+	int fd;
+	char *map;
+	size_t map_size;
+	struct blob_shm_header *header;
+	struct blob_queue queue;
+};
+
+//! Creates a channel with a ring of size bytes (rounded up to a power of two). The channel is
+//! backed by the file at path, which is usually on /dev/shm, or by an anonymous memfd if path
+//! is NULL. Other processes get the channel through blob_shm_channel_open() or by inheriting
+//! (or receiving) self->fd and calling blob_shm_channel_open_fd().
+bool blob_shm_channel_create(struct blob_shm_channel *self, const char *path, size_t size, unsigned int flags);
+
+//! Maps the channel created at path.
+bool blob_shm_channel_open(struct blob_shm_channel *self, const char *path);
+
+//! Maps the channel behind fd. The channel keeps its own duplicate of fd.
+bool blob_shm_channel_open_fd(struct blob_shm_channel *self, int fd);
+
+//! Unmaps the channel. The ring lives on as long as another process has it open.
+void blob_shm_channel_close(struct blob_shm_channel *self);
+
+//! Like blob_queue_reserve() but waits up to timeout_ms milliseconds (forever if negative) for
+//! space in the ring.
+bool blob_shm_channel_reserve(struct blob_shm_channel *self, struct blob *blob, size_t size, int timeout_ms);
+
+//! Publishes the message and wakes the reader if it is sleeping.
+void blob_shm_channel_commit(struct blob_shm_channel *self, struct blob *blob);
+
+//! Like blob_queue_peek() but waits up to timeout_ms milliseconds (forever if negative) for a
+//! message.
+const struct blob_field *blob_shm_channel_peek(struct blob_shm_channel *self, int timeout_ms);
+
+//! Frees the message returned by blob_shm_channel_peek() and wakes writers waiting for space.
+void blob_shm_channel_release(struct blob_shm_channel *self);
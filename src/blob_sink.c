@@ -0,0 +1,72 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "blob_sink.h"
+
+static bool _buffer_sink_write(struct blob_sink *sink, const void *data, size_t size){
+	struct blob_buffer_sink *self = (struct blob_buffer_sink*)sink;
+	if(self->len + size > self->size){
+		size_t newsize = self->size ? self->size * 2 : 256;
+		while(newsize < self->len + size) newsize *= 2;
+		char *buf = realloc(self->buf, newsize);
+		if(!buf) return false;
+		self->buf = buf;
+		self->size = newsize;
+	}
+	memcpy(self->buf + self->len, data, size);
+	self->len += size;
+	return true;
+}
+
+void blob_buffer_sink_init(struct blob_buffer_sink *self){
+	memset(self, 0, sizeof(*self));
+	self->sink.write = _buffer_sink_write;
+}
+
+void blob_buffer_sink_reset(struct blob_buffer_sink *self){
+	self->len = 0;
+}
+
+void blob_buffer_sink_free(struct blob_buffer_sink *self){
+	free(self->buf);
+	blob_buffer_sink_init(self);
+}
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+
+static bool _fd_sink_write(struct blob_sink *sink, const void *data, size_t size){
+	struct blob_fd_sink *self = (struct blob_fd_sink*)sink;
+	const char *ptr = data;
+	while(size > 0){
+		ssize_t ret = write(self->fd, ptr, size);
+		if(ret < 0 && errno == EINTR) continue;
+		if(ret <= 0) return false;
+		ptr += ret;
+		size -= ret;
+	}
+	return true;
+}
+
+void blob_fd_sink_init(struct blob_fd_sink *self, int fd){
+	self->sink.write = _fd_sink_write;
+	self->fd = fd;
+}
+#endif
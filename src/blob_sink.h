@@ -0,0 +1,47 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+//! Destination for the streaming encoders. write is called with consecutive pieces of the
+//! output and returns false to abort the encoding.
+struct blob_sink {
+	bool (*write)(struct blob_sink *self, const void *data, size_t size);
+};
+
+//! sink that collects the output in a malloced buffer
+struct blob_buffer_sink {
+	struct blob_sink sink;
+	char *buf;
+	size_t len;
+	size_t size;
+};
+
+//! sink that writes the output to a file descriptor
+struct blob_fd_sink {
+	struct blob_sink sink;
+	int fd;
+};
+
+void blob_buffer_sink_init(struct blob_buffer_sink *self);
+void blob_buffer_sink_reset(struct blob_buffer_sink *self);
+void blob_buffer_sink_free(struct blob_buffer_sink *self);
+
+void blob_fd_sink_init(struct blob_fd_sink *self, int fd);
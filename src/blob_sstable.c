@@ -0,0 +1,310 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "blob.h"
+#include "blob_sstable.h"
+#include "blob_crc32.h"
+
+#ifdef HAVE_UNISTD_H
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define BLOB_SSTABLE_ENTRY_HEADER_SIZE 8
+
+static inline uint32_t _sst_get32(const char *p){
+	uint32_t val;
+	memcpy(&val, p, sizeof(val));
+	return be32toh(val);
+}
+
+static inline uint64_t _sst_get64(const char *p){
+	uint64_t val;
+	memcpy(&val, p, sizeof(val));
+	return be64toh(val);
+}
+
+// a key is stored with a terminating null and padded so that the blob after it stays aligned
+static inline uint64_t _sst_key_pad_len(uint64_t len){
+	return (len + 4) & ~(uint64_t)3;
+}
+
+static inline int _sst_compare(const char *a, size_t alen, const char *b, size_t blen){
+	int ret = memcmp(a, b, (alen < blen) ? alen : blen);
+	if(ret) return ret;
+	return (alen > blen) - (alen < blen);
+}
+
+/********************************
+** WRITING
+********************************/
+
+static void _sst_flush(struct blob_sstable_writer *self){
+	const char *ptr = self->buf;
+	size_t size = self->buf_len;
+	self->buf_len = 0;
+	while(size > 0 && !self->failed){
+		ssize_t ret = write(self->fd, ptr, size);
+		if(ret < 0 && errno == EINTR) continue;
+		if(ret <= 0){
+			self->failed = true;
+			break;
+		}
+		ptr += ret;
+		size -= ret;
+	}
+}
+
+static void _sst_write(struct blob_sstable_writer *self, const void *data, size_t size){
+	while(size > 0){
+		if(self->buf_len == sizeof(self->buf)) _sst_flush(self);
+		size_t len = sizeof(self->buf) - self->buf_len;
+		if(len > size) len = size;
+		memcpy(self->buf + self->buf_len, data, len);
+		self->buf_len += len;
+		data = (const char*)data + len;
+		size -= len;
+	}
+}
+
+static void _sst_put32(struct blob_sstable_writer *self, uint32_t val){
+	val = htobe32(val);
+	_sst_write(self, &val, sizeof(val));
+}
+
+static void _sst_put64(struct blob_sstable_writer *self, uint64_t val){
+	val = htobe64(val);
+	_sst_write(self, &val, sizeof(val));
+}
+
+bool blob_sstable_writer_open(struct blob_sstable_writer *self, const char *path){
+	memset(self, 0, offsetof(struct blob_sstable_writer, buf));
+	self->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(self->fd < 0) return false;
+	_sst_write(self, BLOB_SSTABLE_MAGIC, BLOB_SSTABLE_HEADER_SIZE);
+	self->offset = BLOB_SSTABLE_HEADER_SIZE;
+	return true;
+}
+
+bool blob_sstable_writer_add(struct blob_sstable_writer *self, const char *key, struct blob *blob){
+	static const char zero[4] = { 0 };
+	size_t key_len = strlen(key);
+	uint32_t value_len = blob_size(blob);
+
+	if(self->failed) return false;
+	if(self->entries && _sst_compare(key, key_len, self->last_key, self->last_key_len) <= 0) return false;
+
+	// remember the key for the order check before anything is written
+	if(key_len > self->last_key_size){
+		char *last = realloc(self->last_key, key_len);
+		if(!last) return false;
+		self->last_key = last;
+		self->last_key_size = key_len;
+	}
+
+	if(!self->index_count || self->offset - self->block_start >= BLOB_SSTABLE_BLOCK_SIZE){
+		if(self->index_count == self->index_size){
+			size_t size = self->index_size ? self->index_size * 2 : 1024;
+			uint64_t *index = realloc(self->index, size * sizeof(uint64_t));
+			if(!index) return false;
+			self->index = index;
+			self->index_size = size;
+		}
+		self->index[self->index_count++] = self->offset;
+		self->block_start = self->offset;
+	}
+
+	memcpy(self->last_key, key, key_len);
+	self->last_key_len = key_len;
+
+	uint64_t key_pad_len = _sst_key_pad_len(key_len);
+	_sst_put32(self, key_len);
+	_sst_put32(self, value_len);
+	_sst_write(self, key, key_len);
+	_sst_write(self, zero, key_pad_len - key_len);
+	_sst_write(self, blob_head(blob), value_len);
+	self->offset += BLOB_SSTABLE_ENTRY_HEADER_SIZE + key_pad_len + value_len;
+	self->entries++;
+	return !self->failed;
+}
+
+bool blob_sstable_writer_finish(struct blob_sstable_writer *self){
+	uint64_t index_offset = self->offset;
+	uint32_t crc = 0;
+
+	for(size_t c = 0; c < self->index_count; c++){
+		uint64_t val = htobe64(self->index[c]);
+		crc = blob_crc32(crc, &val, sizeof(val));
+		_sst_write(self, &val, sizeof(val));
+	}
+	_sst_put64(self, index_offset);
+	_sst_put64(self, self->index_count);
+	_sst_put64(self, self->entries);
+	_sst_put32(self, crc);
+	_sst_put32(self, 0);
+	_sst_write(self, BLOB_SSTABLE_MAGIC, BLOB_SSTABLE_HEADER_SIZE);
+	_sst_flush(self);
+
+	if(fsync(self->fd) < 0) self->failed = true;
+	if(close(self->fd) < 0) self->failed = true;
+	free(self->index);
+	free(self->last_key);
+	self->index = NULL;
+	self->last_key = NULL;
+	self->fd = -1;
+	return !self->failed;
+}
+
+/********************************
+** READING
+********************************/
+
+bool blob_sstable_open(struct blob_sstable *self, const char *path){
+	struct stat st;
+
+	memset(self, 0, sizeof(*self));
+	self->fd = open(path, O_RDONLY);
+	if(self->fd < 0) return false;
+	if(fstat(self->fd, &st) < 0 || st.st_size < BLOB_SSTABLE_HEADER_SIZE + BLOB_SSTABLE_FOOTER_SIZE) goto fail;
+
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, self->fd, 0);
+	if(map == MAP_FAILED) goto fail;
+	self->map = map;
+	self->size = st.st_size;
+
+	const char *footer = self->map + self->size - BLOB_SSTABLE_FOOTER_SIZE;
+	if(memcmp(self->map, BLOB_SSTABLE_MAGIC, BLOB_SSTABLE_HEADER_SIZE) != 0) goto fail;
+	if(memcmp(footer + 32, BLOB_SSTABLE_MAGIC, BLOB_SSTABLE_HEADER_SIZE) != 0) goto fail;
+
+	uint64_t index_offset = _sst_get64(footer);
+	self->index_count = _sst_get64(footer + 8);
+	self->entries = _sst_get64(footer + 16);
+	uint64_t index_space = self->size - BLOB_SSTABLE_FOOTER_SIZE;
+	if(index_offset < BLOB_SSTABLE_HEADER_SIZE || index_offset > index_space) goto fail;
+	if(self->index_count != (index_space - index_offset) / sizeof(uint64_t) || (index_space - index_offset) % sizeof(uint64_t)) goto fail;
+	self->index = self->map + index_offset;
+	self->data_end = index_offset;
+	if(blob_crc32(0, self->index, self->index_count * sizeof(uint64_t)) != _sst_get32(footer + 24)) goto fail;
+
+	// lookups jump around the file so read ahead would only waste the page cache
+	madvise(map, self->size, MADV_RANDOM);
+	return true;
+fail:
+	blob_sstable_close(self);
+	return false;
+}
+
+void blob_sstable_close(struct blob_sstable *self){
+	if(self->map) munmap((void*)(uintptr_t)self->map, self->size);
+	if(self->fd >= 0) close(self->fd);
+	self->map = NULL;
+	self->fd = -1;
+}
+
+// parses the entry at offset and returns the offset of the next one, or 0 if the entry is damaged
+static uint64_t _sst_entry(const struct blob_sstable *self, uint64_t offset, const char **key, size_t *key_len, const struct blob_field **value){
+	if(offset >= self->data_end || self->data_end - offset < BLOB_SSTABLE_ENTRY_HEADER_SIZE) return 0;
+	uint64_t klen = _sst_get32(self->map + offset);
+	uint64_t vlen = _sst_get32(self->map + offset + 4);
+	uint64_t kpad = _sst_key_pad_len(klen);
+	if(vlen < sizeof(struct blob_field) || kpad + vlen > self->data_end - offset - BLOB_SSTABLE_ENTRY_HEADER_SIZE) return 0;
+	*key = self->map + offset + BLOB_SSTABLE_ENTRY_HEADER_SIZE;
+	*key_len = klen;
+	*value = (const struct blob_field*)(*key + kpad);
+	// the data blocks have no crc, so the value must at least stay inside its entry
+	if(blob_field_raw_len(*value) < sizeof(struct blob_field) || blob_field_raw_pad_len(*value) != vlen) return 0;
+	return offset + BLOB_SSTABLE_ENTRY_HEADER_SIZE + kpad + vlen;
+}
+
+static inline uint64_t _sst_block(const struct blob_sstable *self, uint64_t block){
+	if(block >= self->index_count) return self->data_end;
+	return _sst_get64(self->index + block * sizeof(uint64_t));
+}
+
+// returns the number of blocks whose first key is not greater than key
+static uint64_t _sst_find_block(const struct blob_sstable *self, const char *key, size_t key_len){
+	uint64_t lo = 0, hi = self->index_count;
+	while(lo < hi){
+		uint64_t mid = lo + (hi - lo) / 2;
+		const char *first;
+		size_t first_len;
+		const struct blob_field *value;
+		if(_sst_entry(self, _sst_block(self, mid), &first, &first_len, &value) &&
+			_sst_compare(first, first_len, key, key_len) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+const struct blob_field *blob_sstable_get(const struct blob_sstable *self, const char *key){
+	size_t key_len = strlen(key);
+	uint64_t block = _sst_find_block(self, key, key_len);
+	if(block == 0) return NULL;
+
+	uint64_t offset = _sst_block(self, block - 1);
+	uint64_t end = _sst_block(self, block);
+	while(offset && offset < end){
+		const char *k;
+		size_t klen;
+		const struct blob_field *value;
+		offset = _sst_entry(self, offset, &k, &klen, &value);
+		if(!offset) break;
+		int cmp = _sst_compare(k, klen, key, key_len);
+		if(cmp == 0) return value;
+		if(cmp > 0) break;
+	}
+	return NULL;
+}
+
+void blob_sstable_seek(const struct blob_sstable *self, struct blob_sstable_iter *iter, const char *key){
+	iter->table = self;
+	iter->offset = _sst_block(self, 0);
+	if(!key) return;
+
+	size_t key_len = strlen(key);
+	uint64_t block = _sst_find_block(self, key, key_len);
+	if(block == 0) return;
+
+	uint64_t offset = _sst_block(self, block - 1);
+	while(offset < self->data_end){
+		const char *k;
+		size_t klen;
+		const struct blob_field *value;
+		uint64_t next = _sst_entry(self, offset, &k, &klen, &value);
+		if(!next || _sst_compare(k, klen, key, key_len) >= 0) break;
+		offset = next;
+	}
+	iter->offset = offset;
+}
+
+bool blob_sstable_next(struct blob_sstable_iter *iter, const char **key, const struct blob_field **value){
+	size_t key_len;
+	uint64_t next = _sst_entry(iter->table, iter->offset, key, &key_len, value);
+	if(!next){
+		iter->offset = iter->table->data_end;
+		return false;
+	}
+	iter->offset = next;
+	return true;
+}
+#endif
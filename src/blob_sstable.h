@@ -0,0 +1,99 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "blob.h"
+
+//! Layout of a blob sstable file (all numbers are big endian):
+//!  - 8 byte magic
+//!  - entries sorted by key: key length (u32), value length (u32), the key with a terminating
+//!    null padded to 4 bytes and the blob data of the value
+//!  - the index: file offset (u64) of the first entry of every block
+//!  - the footer: index offset, index count, entry count (u64 each), crc32 of the index (u32),
+//!    4 reserved bytes and the magic again
+#define BLOB_SSTABLE_MAGIC "BLOBSST1"
+#define BLOB_SSTABLE_HEADER_SIZE 8
+#define BLOB_SSTABLE_FOOTER_SIZE 40
+//! a new block (and index entry) is started once a block holds this many bytes
+#define BLOB_SSTABLE_BLOCK_SIZE 4096
+
+//! Builds a table file. Entries must be added in strictly increasing key order (compared
+//! bytewise like strcmp).
+struct blob_sstable_writer {
+	int fd;
+	bool failed;
+	uint64_t offset;
+	uint64_t block_start;
+	uint64_t entries;
+	uint64_t *index;
+	size_t index_count;
+	size_t index_size;
+	char *last_key;
+	size_t last_key_len;
+	size_t last_key_size;
+	size_t buf_len;
+	char buf[64 * 1024];
+};
+
+//! A table file mapped for reading. Fields returned by the lookup functions point into the
+//! mapping and stay valid until the table is closed.
+struct blob_sstable {
+	int fd;
+	const char *map;
+	size_t size;
+	const char *index;
+	uint64_t index_count;
+	uint64_t data_end;
+	//! number of entries in the table
+	uint64_t entries;
+};
+
+//! position in a table for range scans
+struct blob_sstable_iter {
+	const struct blob_sstable *table;
+	uint64_t offset;
+};
+
+//! Creates (or truncates) the file at path and prepares it for writing.
+bool blob_sstable_writer_open(struct blob_sstable_writer *self, const char *path);
+
+//! Appends the blob under key. The payload is blob_head(blob) and blob_size(blob) bytes long.
+//! Returns false if key is not greater than the previous key or on a write error.
+bool blob_sstable_writer_add(struct blob_sstable_writer *self, const char *key, struct blob *blob);
+
+//! Writes the index and footer, syncs and closes the file. Returns false if anything failed
+//! while the table was written, in which case the file must not be used.
+bool blob_sstable_writer_finish(struct blob_sstable_writer *self);
+
+//! Maps a table written by blob_sstable_writer_finish and checks its footer and index.
+bool blob_sstable_open(struct blob_sstable *self, const char *path);
+
+void blob_sstable_close(struct blob_sstable *self);
+
+//! Returns the value stored under key or NULL if there is none.
+const struct blob_field *blob_sstable_get(const struct blob_sstable *self, const char *key);
+
+//! Positions the iterator at the first entry whose key is not less than key (or at the first
+//! entry if key is NULL).
+void blob_sstable_seek(const struct blob_sstable *self, struct blob_sstable_iter *iter, const char *key);
+
+//! Returns the entry at the iterator and advances it. Returns false after the last entry.
+bool blob_sstable_next(struct blob_sstable_iter *iter, const char **key, const struct blob_field **value);
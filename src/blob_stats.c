@@ -0,0 +1,303 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "blob.h"
+#include "blob_stats.h"
+#include "blob_stats_private.h"
+
+#define BLOB_STATS_HIST_SUB (1 << BLOB_STATS_HIST_SUB_BITS)
+
+int blob_stats_latency_on;
+
+static const char *const _stats_op_names[BLOB_STATS_OPS] = {
+	[BLOB_STATS_OP_PUT] = "put",
+	[BLOB_STATS_OP_JSON_ENCODE] = "json_encode",
+	[BLOB_STATS_OP_JSON_DECODE] = "json_decode",
+	[BLOB_STATS_OP_VALIDATE] = "validate",
+	[BLOB_STATS_OP_PARSE_VALUES] = "parse_values"
+};
+
+static void _stats_merge(struct blob_stats *self, const struct blob_stats *other){
+	self->resizes += __atomic_load_n(&other->resizes, __ATOMIC_RELAXED);
+	self->reallocs += __atomic_load_n(&other->reallocs, __ATOMIC_RELAXED);
+	self->realloc_moves += __atomic_load_n(&other->realloc_moves, __ATOMIC_RELAXED);
+	self->bytes_memset += __atomic_load_n(&other->bytes_memset, __ATOMIC_RELAXED);
+	self->bytes_copied += __atomic_load_n(&other->bytes_copied, __ATOMIC_RELAXED);
+	self->json_grows += __atomic_load_n(&other->json_grows, __ATOMIC_RELAXED);
+	uint64_t peak = __atomic_load_n(&other->peak_memlen, __ATOMIC_RELAXED);
+	if(peak > self->peak_memlen) self->peak_memlen = peak;
+}
+
+/********************************
+** LATENCY HISTOGRAMS
+********************************/
+
+static inline unsigned int _hist_index(uint64_t ns){
+	if(ns < BLOB_STATS_HIST_SUB) return ns;
+	if(ns >> BLOB_STATS_HIST_MAX_BITS) return BLOB_STATS_HIST_BUCKETS - 1;
+	unsigned int shift = 63 - __builtin_clzll(ns) - BLOB_STATS_HIST_SUB_BITS;
+	return ((shift + 1) << BLOB_STATS_HIST_SUB_BITS) + (unsigned int)(ns >> shift) - BLOB_STATS_HIST_SUB;
+}
+
+// the largest duration that is counted in bucket index
+static inline uint64_t _hist_upper(unsigned int index){
+	if(index < BLOB_STATS_HIST_SUB) return index;
+	unsigned int shift = (index >> BLOB_STATS_HIST_SUB_BITS) - 1;
+	uint64_t lower = (uint64_t)(BLOB_STATS_HIST_SUB + (index & (BLOB_STATS_HIST_SUB - 1))) << shift;
+	return lower + ((uint64_t)1 << shift) - 1;
+}
+
+// only the owning thread writes its histograms, see BLOB_STATS_GLOBAL_ADD
+static void _hist_add(struct blob_stats_hist *self, uint64_t ns){
+	unsigned int index = _hist_index(ns);
+	if(!self->count || ns < self->min_ns) __atomic_store_n(&self->min_ns, ns, __ATOMIC_RELAXED);
+	if(ns > self->max_ns) __atomic_store_n(&self->max_ns, ns, __ATOMIC_RELAXED);
+	__atomic_store_n(&self->sum_ns, self->sum_ns + ns, __ATOMIC_RELAXED);
+	__atomic_store_n(&self->buckets[index], self->buckets[index] + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&self->count, self->count + 1, __ATOMIC_RELAXED);
+}
+
+void blob_stats_hist_add(struct blob_stats_hist *hist, uint64_t ns){
+	_hist_add(hist, ns);
+}
+
+static void _hist_merge(struct blob_stats_hist *self, const struct blob_stats_hist *other){
+	uint64_t count = __atomic_load_n(&other->count, __ATOMIC_RELAXED);
+	if(!count) return;
+	uint64_t min = __atomic_load_n(&other->min_ns, __ATOMIC_RELAXED);
+	uint64_t max = __atomic_load_n(&other->max_ns, __ATOMIC_RELAXED);
+	if(!self->count || min < self->min_ns) self->min_ns = min;
+	if(max > self->max_ns) self->max_ns = max;
+	self->count += count;
+	self->sum_ns += __atomic_load_n(&other->sum_ns, __ATOMIC_RELAXED);
+	for(unsigned int c = 0; c < BLOB_STATS_HIST_BUCKETS; c++)
+		self->buckets[c] += __atomic_load_n(&other->buckets[c], __ATOMIC_RELAXED);
+}
+
+static void _stats_merge_latency(struct blob_stats_hist *self, const struct blob_stats_local *local){
+	const struct blob_stats_hist *latency = __atomic_load_n(&local->latency, __ATOMIC_ACQUIRE);
+	if(latency) for(int c = 0; c < BLOB_STATS_OPS; c++) _hist_merge(&self[c], &latency[c]);
+}
+
+void blob_stats_latency(bool enable){
+	__atomic_store_n(&blob_stats_latency_on, enable, __ATOMIC_RELAXED);
+}
+
+uint64_t blob_stats_hist_percentile(const struct blob_stats_hist *hist, double percentile){
+	// the buckets of a histogram that was copied while it was recorded into can be a few
+	// counts ahead of count, so the total is taken from the buckets
+	uint64_t total = 0;
+	for(unsigned int c = 0; c < BLOB_STATS_HIST_BUCKETS; c++) total += hist->buckets[c];
+	if(!total) return 0;
+	if(percentile > 100) percentile = 100;
+	uint64_t rank = (uint64_t)(percentile / 100 * total + 0.5);
+	if(rank < 1) rank = 1;
+	if(rank > total) rank = total;
+
+	uint64_t seen = 0;
+	for(unsigned int c = 0; c < BLOB_STATS_HIST_BUCKETS; c++){
+		seen += hist->buckets[c];
+		if(seen >= rank){
+			uint64_t upper = _hist_upper(c);
+			return (hist->max_ns && upper > hist->max_ns) ? hist->max_ns : upper;
+		}
+	}
+	return hist->max_ns;
+}
+
+const char *blob_stats_op_name(enum blob_stats_op op){
+	if((unsigned int)op >= BLOB_STATS_OPS) return NULL;
+	return _stats_op_names[op];
+}
+
+/********************************
+** THREADS
+********************************/
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+
+__thread struct blob_stats_local blob_stats_local;
+
+static pthread_mutex_t _stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t _stats_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _stats_key;
+static struct blob_stats_local *_stats_threads;
+// what threads that have exited had counted
+static struct blob_stats _stats_retired;
+static struct blob_stats_hist _stats_retired_latency[BLOB_STATS_OPS];
+
+static void _stats_thread_exit(void *arg){
+	struct blob_stats_local *local = arg;
+	pthread_mutex_lock(&_stats_lock);
+	_stats_merge(&_stats_retired, &local->stats);
+	_stats_merge_latency(_stats_retired_latency, local);
+	if(local->prev) local->prev->next = local->next;
+	else _stats_threads = local->next;
+	if(local->next) local->next->prev = local->prev;
+	pthread_mutex_unlock(&_stats_lock);
+	free(local->latency);
+	memset(local, 0, sizeof(*local));
+	// blobs used by destructors that run after this one are not counted. Registering the thread
+	// again could leave it on the list after its thread local storage is gone, since there may
+	// be no further round of destructors to take it off.
+	local->registered = true;
+	local->exiting = true;
+}
+
+static void _stats_init(void){
+	pthread_key_create(&_stats_key, _stats_thread_exit);
+}
+
+void blob_stats_register(void){
+	struct blob_stats_local *local = &blob_stats_local;
+	pthread_once(&_stats_once, _stats_init);
+	pthread_mutex_lock(&_stats_lock);
+	local->prev = NULL;
+	local->next = _stats_threads;
+	if(_stats_threads) _stats_threads->prev = local;
+	_stats_threads = local;
+	local->registered = true;
+	pthread_mutex_unlock(&_stats_lock);
+	// the key only exists to get the counters merged when the thread exits
+	pthread_setspecific(_stats_key, local);
+}
+
+void blob_stats_get(struct blob_stats *stats){
+	pthread_mutex_lock(&_stats_lock);
+	*stats = _stats_retired;
+	for(struct blob_stats_local *local = _stats_threads; local; local = local->next) _stats_merge(stats, &local->stats);
+	pthread_mutex_unlock(&_stats_lock);
+}
+
+void blob_stats_get_latency(enum blob_stats_op op, struct blob_stats_hist *hist){
+	memset(hist, 0, sizeof(*hist));
+	if((unsigned int)op >= BLOB_STATS_OPS) return;
+	pthread_mutex_lock(&_stats_lock);
+	_hist_merge(hist, &_stats_retired_latency[op]);
+	for(struct blob_stats_local *local = _stats_threads; local; local = local->next){
+		const struct blob_stats_hist *latency = __atomic_load_n(&local->latency, __ATOMIC_ACQUIRE);
+		if(latency) _hist_merge(hist, &latency[op]);
+	}
+	pthread_mutex_unlock(&_stats_lock);
+}
+#else
+struct blob_stats_local blob_stats_local;
+
+void blob_stats_register(void){
+	blob_stats_local.registered = true;
+}
+
+void blob_stats_get(struct blob_stats *stats){
+	memset(stats, 0, sizeof(*stats));
+	_stats_merge(stats, &blob_stats_local.stats);
+}
+
+void blob_stats_get_latency(enum blob_stats_op op, struct blob_stats_hist *hist){
+	memset(hist, 0, sizeof(*hist));
+	if((unsigned int)op >= BLOB_STATS_OPS || !blob_stats_local.latency) return;
+	_hist_merge(hist, &blob_stats_local.latency[op]);
+}
+#endif
+
+void blob_stats_record(enum blob_stats_op op, uint64_t ns){
+	struct blob_stats_local *local = &blob_stats_local;
+	if(!local->registered) blob_stats_register();
+	if(local->exiting) return;
+	if(!local->latency){
+		struct blob_stats_hist *latency = calloc(BLOB_STATS_OPS, sizeof(struct blob_stats_hist));
+		if(!latency) return;
+		__atomic_store_n(&local->latency, latency, __ATOMIC_RELEASE);
+	}
+	_hist_add(&local->latency[op], ns);
+}
+
+bool blob_stats_attach(struct blob *blob, struct blob_stats *stats){
+#ifdef BLOB_STATS_PER_BLOB
+	blob->stats = stats;
+	return true;
+#else
+	return false;
+#endif
+}
+
+void blob_stats_dump_hist(struct blob *blob, const struct blob_stats_hist *hist){
+	static const struct { const char *name; double percentile; } percentiles[] = {
+		{ "p50", 50 }, { "p90", 90 }, { "p99", 99 }, { "p99.9", 99.9 }
+	};
+	blob_offset_t table = blob_open_table(blob);
+	blob_put_string(blob, "count");
+	blob_put_int(blob, hist->count);
+	blob_put_string(blob, "min");
+	blob_put_int(blob, hist->min_ns);
+	blob_put_string(blob, "mean");
+	blob_put_int(blob, hist->count ? hist->sum_ns / hist->count : 0);
+	for(size_t c = 0; c < sizeof(percentiles) / sizeof(percentiles[0]); c++){
+		blob_put_string(blob, percentiles[c].name);
+		blob_put_int(blob, blob_stats_hist_percentile(hist, percentiles[c].percentile));
+	}
+	blob_put_string(blob, "max");
+	blob_put_int(blob, hist->max_ns);
+	blob_put_string(blob, "buckets");
+	blob_offset_t buckets = blob_open_array(blob);
+	for(unsigned int c = 0; c < BLOB_STATS_HIST_BUCKETS; c++){
+		if(!hist->buckets[c]) continue;
+		blob_offset_t pair = blob_open_array(blob);
+		blob_put_int(blob, _hist_upper(c));
+		blob_put_int(blob, hist->buckets[c]);
+		blob_close_array(blob, pair);
+	}
+	blob_close_array(blob, buckets);
+	blob_close_table(blob, table);
+}
+
+void blob_stats_dump(struct blob *blob){
+	struct blob_stats stats;
+	// the histograms are too big for the stack of small threads
+	struct blob_stats_hist *hist = malloc(sizeof(*hist));
+	blob_stats_get(&stats);
+
+	blob_offset_t table = blob_open_table(blob);
+	blob_put_string(blob, "resizes");
+	blob_put_int(blob, stats.resizes);
+	blob_put_string(blob, "reallocs");
+	blob_put_int(blob, stats.reallocs);
+	blob_put_string(blob, "realloc_moves");
+	blob_put_int(blob, stats.realloc_moves);
+	blob_put_string(blob, "bytes_memset");
+	blob_put_int(blob, stats.bytes_memset);
+	blob_put_string(blob, "bytes_copied");
+	blob_put_int(blob, stats.bytes_copied);
+	blob_put_string(blob, "json_grows");
+	blob_put_int(blob, stats.json_grows);
+	blob_put_string(blob, "peak_memlen");
+	blob_put_int(blob, stats.peak_memlen);
+	if(hist){
+		blob_put_string(blob, "latency");
+		blob_offset_t latency = blob_open_table(blob);
+		for(int c = 0; c < BLOB_STATS_OPS; c++){
+			blob_stats_get_latency(c, hist);
+			blob_put_string(blob, _stats_op_names[c]);
+			blob_stats_dump_hist(blob, hist);
+		}
+		blob_close_table(blob, latency);
+		free(hist);
+	}
+	blob_close_table(blob, table);
+}
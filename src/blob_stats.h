@@ -0,0 +1,109 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "blob.h"
+
+//! Counters of the memory traffic of the library. Every thread counts into its own copy, so
+//! counting costs no more than an add, and blob_stats_get() sums up the copies of all threads
+//! (including threads that have exited).
+struct blob_stats {
+	//! calls of blob_resize(), which every write into a blob goes through
+	uint64_t resizes;
+	//! times a blob buffer was reallocated to grow it
+	uint64_t reallocs;
+	//! reallocations that had to move the buffer (and copy its contents)
+	uint64_t realloc_moves;
+	//! bytes cleared when blobs are initialized, reset or grown
+	uint64_t bytes_memset;
+	//! bytes copied by blob_put_attr()
+	uint64_t bytes_copied;
+	//! times the output buffer of the JSON encoder had to grow
+	uint64_t json_grows;
+	//! the largest buffer (memlen) a blob has had
+	uint64_t peak_memlen;
+};
+
+//! Stores the counters of the whole process in stats.
+void blob_stats_get(struct blob_stats *stats);
+
+//! Makes blob count into stats as well. stats is not cleared and can be shared by several blobs
+//! of one thread. Counting per blob is only compiled in with ./configure --enable-blob-stats,
+//! otherwise this returns false and does nothing.
+bool blob_stats_attach(struct blob *blob, struct blob_stats *stats);
+
+//! Operations whose latency is recorded while blob_stats_latency() is on.
+enum blob_stats_op {
+	//! blob_put_attr()
+	BLOB_STATS_OP_PUT,
+	//! blob_field_to_json()
+	BLOB_STATS_OP_JSON_ENCODE,
+	//! blob_put_json() and blob_put_json_projected()
+	BLOB_STATS_OP_JSON_DECODE,
+	//! blob_field_validate()
+	BLOB_STATS_OP_VALIDATE,
+	//! blob_field_parse_values()
+	BLOB_STATS_OP_PARSE_VALUES,
+	BLOB_STATS_OPS
+};
+
+//! Every power of two of nanoseconds is split into 2^BLOB_STATS_HIST_SUB_BITS buckets, so a
+//! bucket is never wider than 1/16 of its lower bound. Durations of 2^BLOB_STATS_HIST_MAX_BITS ns
+//! (about 18 minutes) and more are counted in the last bucket.
+#define BLOB_STATS_HIST_SUB_BITS 4
+#define BLOB_STATS_HIST_MAX_BITS 40
+#define BLOB_STATS_HIST_BUCKETS ((BLOB_STATS_HIST_MAX_BITS - BLOB_STATS_HIST_SUB_BITS + 1) << BLOB_STATS_HIST_SUB_BITS)
+
+//! Log-linear (HDR style) histogram of the durations of one operation in nanoseconds.
+struct blob_stats_hist {
+	uint64_t count;
+	uint64_t sum_ns;
+	uint64_t min_ns;
+	uint64_t max_ns;
+	uint64_t buckets[BLOB_STATS_HIST_BUCKETS];
+};
+
+//! Turns recording of latency histograms on or off for the whole process. It is off by default
+//! because every recorded operation reads the clock twice. Every thread records into its own
+//! histograms, which are allocated the first time the thread records something.
+void blob_stats_latency(bool enable);
+
+//! Stores the histogram of op merged over all threads in hist.
+void blob_stats_get_latency(enum blob_stats_op op, struct blob_stats_hist *hist);
+
+//! Adds a duration to a histogram of the caller, for tools that measure their own operations.
+//! The histograms kept by the library itself are only written by their own threads.
+void blob_stats_hist_add(struct blob_stats_hist *hist, uint64_t ns);
+
+//! Appends hist as a table like the ones under "latency" in blob_stats_dump().
+void blob_stats_dump_hist(struct blob *blob, const struct blob_stats_hist *hist);
+
+//! Returns the duration in ns that percentile (0 to 100) of the recorded operations did not
+//! exceed, rounded up to the upper bound of its bucket. Returns 0 for an empty histogram.
+uint64_t blob_stats_hist_percentile(const struct blob_stats_hist *hist, double percentile);
+
+//! Returns the name of op as used by blob_stats_dump() ("put", "json_encode", ...).
+const char *blob_stats_op_name(enum blob_stats_op op);
+
+//! Appends a table with the counters of blob_stats_get() and, under "latency", a table for every
+//! operation with its count, min, mean, p50, p90, p99, p99.9 and max (in ns) and its non empty
+//! buckets as [upper bound, count] pairs.
+void blob_stats_dump(struct blob *blob);
@@ -0,0 +1,84 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdbool.h>
+#include "blob_stats.h"
+#include "blob_trace.h"
+
+// counters of one thread (not installed, only used inside the library)
+struct blob_stats_local {
+	struct blob_stats stats;
+	// BLOB_STATS_OPS histograms, allocated on the first recorded operation
+	struct blob_stats_hist *latency;
+	struct blob_stats_local *next;
+	struct blob_stats_local *prev;
+	bool registered;
+	// set once the counters have been merged at thread exit. Nothing is counted after that.
+	bool exiting;
+};
+
+#ifdef HAVE_PTHREAD_H
+extern __thread struct blob_stats_local blob_stats_local __attribute__((tls_model("initial-exec"), visibility("hidden")));
+#else
+extern struct blob_stats_local blob_stats_local __attribute__((visibility("hidden")));
+#endif
+
+void blob_stats_register(void) __attribute__((visibility("hidden")));
+
+extern int blob_stats_latency_on __attribute__((visibility("hidden")));
+void blob_stats_record(enum blob_stats_op op, uint64_t ns) __attribute__((visibility("hidden")));
+
+#define BLOB_STATS_LATENCY_ON() __builtin_expect(__atomic_load_n(&blob_stats_latency_on, __ATOMIC_RELAXED), 0)
+
+// start time of an operation or 0 if latencies are not recorded
+static inline uint64_t blob_stats_latency_start(void){
+	return BLOB_STATS_LATENCY_ON() ? blob_trace_now() : 0;
+}
+
+static inline void blob_stats_latency_end(enum blob_stats_op op, uint64_t start){
+	if(start) blob_stats_record(op, blob_trace_now() - start);
+}
+
+// only the owning thread writes its counters, so a plain add is enough as long as the result is
+// stored in one piece for blob_stats_get()
+#define BLOB_STATS_GLOBAL_ADD(field, n) do { \
+	if(!blob_stats_local.registered) blob_stats_register(); \
+	__atomic_store_n(&blob_stats_local.stats.field, blob_stats_local.stats.field + (n), __ATOMIC_RELAXED); \
+} while(0)
+
+#define BLOB_STATS_GLOBAL_MAX(field, n) do { \
+	if(!blob_stats_local.registered) blob_stats_register(); \
+	if((uint64_t)(n) > blob_stats_local.stats.field) \
+		__atomic_store_n(&blob_stats_local.stats.field, (uint64_t)(n), __ATOMIC_RELAXED); \
+} while(0)
+
+#ifdef BLOB_STATS_PER_BLOB
+#define BLOB_STATS_ADD(blob, field, n) do { \
+	BLOB_STATS_GLOBAL_ADD(field, n); \
+	if((blob)->stats) (blob)->stats->field += (n); \
+} while(0)
+#define BLOB_STATS_MAX(blob, field, n) do { \
+	BLOB_STATS_GLOBAL_MAX(field, n); \
+	if((blob)->stats && (uint64_t)(n) > (blob)->stats->field) (blob)->stats->field = (n); \
+} while(0)
+#else
+#define BLOB_STATS_ADD(blob, field, n) BLOB_STATS_GLOBAL_ADD(field, n)
+#define BLOB_STATS_MAX(blob, field, n) BLOB_STATS_GLOBAL_MAX(field, n)
+#endif
@@ -0,0 +1,33 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "blob_trace.h"
+
+#ifdef BLOB_USDT
+// the tracer finds these through the probe notes and counts them up while it is attached
+#define BLOB_PROBE_DEFINE_SEMAPHORE(name) \
+	unsigned short BLOB_PROBE_SEMAPHORE(name) __attribute__((section(".probes")))
+
+BLOB_PROBE_DEFINE_SEMAPHORE(blob_init);
+BLOB_PROBE_DEFINE_SEMAPHORE(blob_resize);
+BLOB_PROBE_DEFINE_SEMAPHORE(blob_free);
+BLOB_PROBE_DEFINE_SEMAPHORE(json_decode_start);
+BLOB_PROBE_DEFINE_SEMAPHORE(json_decode_done);
+BLOB_PROBE_DEFINE_SEMAPHORE(json_encode_start);
+BLOB_PROBE_DEFINE_SEMAPHORE(json_encode_done);
+#endif
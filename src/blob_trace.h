@@ -0,0 +1,57 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+//! Static (USDT) probes for bpftrace, perf and SystemTap under the provider "blobpack". They are
+//! compiled in with ./configure --enable-usdt and cost a nop each until a tracer attaches. Every
+//! probe has a semaphore that the tracer sets while it is attached, so arguments that take work
+//! to compute (the durations) are only computed while someone is listening:
+//!  - blob_init(blob, memlen), blob_resize(blob, size, memlen), blob_free(blob, memlen)
+//!  - json_decode_start(json, len), json_decode_done(len, ok, ns)
+//!  - json_encode_start(field, size), json_encode_done(field, len, ns)
+#ifdef BLOB_USDT
+#define _SDT_HAS_SEMAPHORES 1
+#include <sys/sdt.h>
+
+#define BLOB_PROBE_SEMAPHORE(name) blobpack_##name##_semaphore
+extern unsigned short blobpack_blob_init_semaphore;
+extern unsigned short blobpack_blob_resize_semaphore;
+extern unsigned short blobpack_blob_free_semaphore;
+extern unsigned short blobpack_json_decode_start_semaphore;
+extern unsigned short blobpack_json_decode_done_semaphore;
+extern unsigned short blobpack_json_encode_start_semaphore;
+extern unsigned short blobpack_json_encode_done_semaphore;
+
+#define BLOB_PROBE_ENABLED(name) __builtin_expect(BLOB_PROBE_SEMAPHORE(name) != 0, 0)
+#define BLOB_PROBE2(name, a, b) STAP_PROBE2(blobpack, name, a, b)
+#define BLOB_PROBE3(name, a, b, c) STAP_PROBE3(blobpack, name, a, b, c)
+#else
+#define BLOB_PROBE_ENABLED(name) 0
+#define BLOB_PROBE2(name, a, b) do { } while(0)
+#define BLOB_PROBE3(name, a, b, c) do { } while(0)
+#endif
+
+static inline uint64_t blob_trace_now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
@@ -45,6 +45,9 @@ http://www.opensource.apple.com/source/tcl/tcl-14/tcl/license.terms
 //#include <fcntl.h>
 //#include <sys/stat.h>
 #include "ujson.h"
+#include "blob_stats_private.h"
+#include "blob_capture_private.h"
+#include "blob_trace.h"
 
 #define DEBUG(...) {}
 
@@ -58,14 +61,10 @@ static void Object_arrayAddItem(void *prv, JSOBJ obj, JSOBJ value){
 }
 
 static JSOBJ Object_newString(void *prv, char *start, char *end){
-	size_t len = end - start + 1; 
-	char *str = malloc(len); 
-	memset(str, 0, len); 
-	strncpy(str, start, end - start); 
-	DEBUG("new string %s\n", str); 
-	void* ret = blob_put_string(prv, str);  
-	free(str); 
-	return ret; 
+	// the decoder leaves room for the terminator so no need to copy the string
+	*end = 0; 
+	DEBUG("new string %s\n", start); 
+	return blob_put_string(prv, start);  
 }
 
 static JSOBJ Object_newTrue(void *prv){
@@ -134,7 +133,63 @@ static void *Object_Realloc(void *ptr, size_t size){
 	return realloc(ptr, size); 
 }
 
-bool blob_put_json(struct blob *self, const char *json){
+#define BLOB_JSON_MAX_PATHS 64
+
+struct blob_json_projection {
+	const char *const *paths;
+	// one entry for every selected member that is being decoded. mask holds the paths that
+	// still match at depth and all is set once a whole path has matched.
+	struct {
+		uint64_t mask;
+		unsigned int depth;
+		bool all;
+	} stack[JSON_MAX_OBJECT_DEPTH + 1];
+	int top;
+};
+
+static bool _path_segment_matches(const char *path, unsigned int depth, const char *start, const char *end, bool *last){
+	while(depth--){
+		path = strchr(path, '.');
+		if(!path) return false;
+		path++;
+	}
+	const char *seg_end = strchr(path, '.');
+	size_t len = seg_end ? (size_t)(seg_end - path) : strlen(path);
+	*last = !seg_end;
+	return len == (size_t)(end - start) && memcmp(path, start, len) == 0;
+}
+
+static int Projection_selectKey(void *prv, const char *start, const char *end){
+	struct blob_json_projection *self = prv;
+	uint64_t mask = 0;
+	bool all = self->stack[self->top].all;
+
+	if(self->top == JSON_MAX_OBJECT_DEPTH) return 0;
+
+	if(!all){
+		for(unsigned int c = 0; self->paths[c]; c++){
+			bool last = false;
+			if(!(self->stack[self->top].mask & (1ULL << c))) continue;
+			if(!_path_segment_matches(self->paths[c], self->stack[self->top].depth, start, end, &last)) continue;
+			if(last) all = true;
+			else mask |= 1ULL << c;
+		}
+		if(!all && !mask) return 0;
+	}
+
+	self->top++;
+	self->stack[self->top].mask = mask;
+	self->stack[self->top].depth = self->stack[self->top - 1].depth + 1;
+	self->stack[self->top].all = all;
+	return 1;
+}
+
+static void Projection_endKey(void *prv){
+	struct blob_json_projection *self = prv;
+	self->top--;
+}
+
+static bool _blob_put_json(struct blob *self, const char *json, size_t len, struct blob_json_projection *proj){
 	JSONObjectDecoder decoder = {
 		.newString = Object_newString,
 		.objectAddKey = Object_objectAddKey,
@@ -158,9 +213,25 @@ bool blob_put_json(struct blob *self, const char *json){
 		.prv = self
 	};
 
-	JSON_DecodeObject(&decoder, json, strlen(json));
+	if(proj){
+		decoder.selectKey = Projection_selectKey;
+		decoder.endKey = Projection_endKey;
+		decoder.selectPrv = proj;
+	}
+
+	if(BLOB_CAPTURE_ON()) blob_capture_json(json, len);
 
-	if (decoder.errorStr){
+	uint64_t start = (BLOB_PROBE_ENABLED(json_decode_done) || BLOB_STATS_LATENCY_ON()) ? blob_trace_now() : 0;
+	BLOB_PROBE2(json_decode_start, json, len);
+
+	// a NULL result without an error string means the blob ran out of space
+	JSOBJ ret = JSON_DecodeObject(&decoder, json, len);
+	bool ok = ret && !decoder.errorStr;
+	uint64_t ns = start ? blob_trace_now() - start : 0;
+	BLOB_PROBE3(json_decode_done, len, ok, ns);
+	if(start && BLOB_STATS_LATENCY_ON()) blob_stats_record(BLOB_STATS_OP_JSON_DECODE, ns);
+
+	if (!ok){
 		DEBUG("json parsing failed: %s", decoder.errorStr);
 		return false;
 	}
@@ -168,6 +239,24 @@ bool blob_put_json(struct blob *self, const char *json){
 	return true;
 }
 
+bool blob_put_json(struct blob *self, const char *json){
+	return _blob_put_json(self, json, strlen(json), NULL); 
+}
+
+bool blob_put_json_projected(struct blob *self, const char *json, const char *const paths[]){
+	struct blob_json_projection proj; 
+	unsigned int npaths = 0; 
+	while(paths[npaths]) npaths++; 
+	if(npaths > BLOB_JSON_MAX_PATHS) return false; 
+
+	proj.paths = paths; 
+	proj.top = 0; 
+	proj.stack[0].mask = (npaths == BLOB_JSON_MAX_PATHS)?~0ULL:((1ULL << npaths) - 1); 
+	proj.stack[0].depth = 0; 
+	proj.stack[0].all = false; 
+	return _blob_put_json(self, json, strlen(json), &proj); 
+}
+
 bool blob_init_from_json(struct blob *self, const char *json){
 	struct blob b; 
 	blob_init(&b, 0, 0); 
@@ -188,26 +277,41 @@ bool blob_init_from_json(struct blob *self, const char *json){
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 bool blob_put_json_from_file(struct blob *self, const char *file){
-	// this is a rather simplistic approach where we just load the whole file into memory and then parse the buffer. 
-	// there can probably be better ways where we parse data in place.. 
-	// TODO: solve if this becomes a problem later
-	size_t file_size = 0; 
+	// the file is decoded in place from a read only mapping. The mapping is placed at the
+	// start of a reserved anonymous area that is at least one byte longer than the file so
+	// that the decoder always finds a zero byte after the last character, even when the
+	// file size is an exact multiple of the page size. 
 	int fd = open(file, O_RDONLY); 
 	if(fd < 0) return false; 
-	file_size = lseek(fd, SEEK_END, 0); 
-	if(file_size > 1000000UL) { close(fd); return false; }
-	lseek(fd, SEEK_SET, 0); 	
-	char *buffer = malloc(file_size + 1); // allocate on stack
-	memset(buffer, 0, file_size + 1); 
-	int ret = 0; 
-	if((ret = read(fd, buffer, file_size)) > 0 && (size_t)ret != file_size){
+	struct stat st; 
+	if(fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)){ 
+		close(fd); 
+		return false; 
+	}
+	size_t file_size = st.st_size; 
+	if(file_size == 0){
+		close(fd); 
+		return blob_put_json(self, ""); 
+	}
+	size_t page_size = sysconf(_SC_PAGESIZE); 
+	size_t map_size = (file_size / page_size + 1) * page_size; 
+	char *area = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0); 
+	if(area == MAP_FAILED){
+		close(fd); 
+		return false; 
+	}
+	if(mmap(area, file_size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED){
+		munmap(area, map_size); 
 		close(fd); 
 		return false; 
 	}
 	close(fd); 
-	ret = blob_put_json(self, buffer); 
-	free(buffer); 
+	madvise(area, file_size, MADV_SEQUENTIAL); 
+	bool ret = _blob_put_json(self, area, file_size, NULL); 
+	munmap(area, map_size); 
 	return ret; 
 }
 #endif
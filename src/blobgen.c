@@ -0,0 +1,112 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blobpack.h"
+
+static void _usage(const char *name){
+	fprintf(stderr,
+		"usage: %s [options]\n"
+		"Writes generated documents to stdout, one JSON document per line or as raw blobs.\n"
+		"  -n count         number of documents (1)\n"
+		"  -s seed          seed, the same seed and shape give the same documents (1)\n"
+		"  -d depth         levels of containers below the top one\n"
+		"  -f min:max[:log] children per container\n"
+		"  -c share         share of children that are containers\n"
+		"  -t share         share of containers that are tables\n"
+		"  -k min:max[:log] key length\n"
+		"  -w a:b:c:d       weights of 8, 16, 32 and 64 bit integers\n"
+		"  -l min:max[:log] string length\n"
+		"  -r share         share of values that are reals\n"
+		"  -S share         share of values that are strings\n"
+		"  -b               write raw blobs (every blob starts with its own length)\n"
+		"Lengths without :log are uniform, with :log uniform over the powers of two.\n", name);
+}
+
+static bool _parse_dist(struct blob_gen_dist *dist, const char *arg){
+	char log[4] = "";
+	int n = sscanf(arg, "%u:%u:%3s", &dist->min, &dist->max, log);
+	if(n < 2 || dist->max < dist->min || (n == 3 && strcmp(log, "log") != 0)) return false;
+	dist->log = n == 3;
+	return true;
+}
+
+static bool _parse_share(double *share, const char *arg){
+	char *end;
+	*share = strtod(arg, &end);
+	return *end == 0 && *share >= 0 && *share <= 1;
+}
+
+int main(int argc, char **argv){
+	struct blob_gen_shape shape;
+	struct blob_gen gen;
+	struct blob blob;
+	unsigned long long count = 1, seed = 1;
+	bool raw = false, ok = true;
+	int opt;
+
+	blob_gen_shape_default(&shape);
+	while((opt = getopt(argc, argv, "n:s:d:f:c:t:k:w:l:r:S:bh")) != -1){
+		switch(opt){
+			case 'n': count = strtoull(optarg, NULL, 0); break;
+			case 's': seed = strtoull(optarg, NULL, 0); break;
+			case 'd': shape.depth = strtoul(optarg, NULL, 0); break;
+			case 'f': ok = _parse_dist(&shape.fanout, optarg); break;
+			case 'c': ok = _parse_share(&shape.container_share, optarg); break;
+			case 't': ok = _parse_share(&shape.table_share, optarg); break;
+			case 'k': ok = _parse_dist(&shape.key_len, optarg); break;
+			case 'w': ok = sscanf(optarg, "%u:%u:%u:%u", &shape.int_weights[0], &shape.int_weights[1], &shape.int_weights[2], &shape.int_weights[3]) == 4; break;
+			case 'l': ok = _parse_dist(&shape.string_len, optarg); break;
+			case 'r': ok = _parse_share(&shape.float_share, optarg); break;
+			case 'S': ok = _parse_share(&shape.string_share, optarg); break;
+			case 'b': raw = true; break;
+			default: ok = false; break;
+		}
+		if(!ok){
+			_usage(argv[0]);
+			return 1;
+		}
+	}
+	if(optind != argc){
+		_usage(argv[0]);
+		return 1;
+	}
+
+	blob_gen_init(&gen, &shape, seed);
+	blob_init(&blob, 0, 0);
+	for(unsigned long long c = 0; c < count && ok; c++){
+		blob_reset(&blob);
+		ok = blob_gen_put(&gen, &blob);
+		if(!ok) break;
+		const struct blob_field *doc = blob_field_first_child(blob_head(&blob));
+		if(raw){
+			ok = fwrite(doc, blob_field_raw_pad_len(doc), 1, stdout) == 1;
+		} else {
+			char *json = blob_field_to_json(doc);
+			ok = json && printf("%s\n", json) >= 0;
+			free(json);
+		}
+	}
+	blob_free(&blob);
+	if(fflush(stdout) != 0) ok = false;
+	if(!ok) fprintf(stderr, "%s: could not write the documents\n", argv[0]);
+	return ok ? 0 : 1;
+}
@@ -21,4 +21,21 @@
 #include "blob.h"
 #include "blob_field.h"
 #include "blob_json.h"
+#include "blob_ndjson.h"
+#include "blob_sink.h"
+#include "blob_msgpack.h"
+#include "blob_cbor.h"
+#include "blob_blobmsg.h"
+#include "blob_log.h"
+#include "blob_sstable.h"
+#include "blob_columns.h"
+#include "blob_aggregate.h"
+#include "blob_canonical.h"
+#include "blob_queue.h"
+#include "blob_shm.h"
+#include "blob_pool.h"
+#include "blob_io.h"
+#include "blob_stats.h"
+#include "blob_gen.h"
+#include "blob_capture.h"
 
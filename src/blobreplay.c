@@ -0,0 +1,97 @@
+/*
+	Copyright (C) 2016 Martin K. Schröder <mkschreder.uk@gmail.com>
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blobpack.h"
+
+#define MAX_KEYS 64
+
+static void _usage(const char *name){
+	fprintf(stderr,
+		"usage: %s [-t] [-s signature] [-k key,key,...] capture\n"
+		"Replays a capture made with blob_capture_start() (or BLOBPACK_CAPTURE=file) through decode,\n"
+		"validate, parse_values and JSON encode and prints throughput and latency as JSON.\n"
+		"  -t            replay at the pace the inputs were captured instead of as fast as possible\n"
+		"  -s signature  signature for blob_field_validate() (default: the type of the document)\n"
+		"  -k keys       keys for blob_field_parse_values() (default: the keys of the first table)\n", name);
+}
+
+int main(int argc, char **argv){
+	struct blob_replay_options options = { 0 };
+	struct blob_replay_result result;
+	struct blob_policy policy[MAX_KEYS];
+	char *keys = NULL;
+	int opt;
+
+	while((opt = getopt(argc, argv, "ts:k:h")) != -1){
+		switch(opt){
+			case 't': options.flags |= BLOB_REPLAY_TIMED; break;
+			case 's': options.signature = optarg; break;
+			case 'k': keys = optarg; break;
+			default:
+				_usage(argv[0]);
+				return 1;
+		}
+	}
+	if(optind + 1 != argc){
+		_usage(argv[0]);
+		return 1;
+	}
+	if(keys){
+		options.policy = policy;
+		for(char *key = strtok(keys, ","); key && options.policy_size < MAX_KEYS; key = strtok(NULL, ",")){
+			policy[options.policy_size++] = (struct blob_policy){ .name = key, .type = BLOB_FIELD_ANY };
+		}
+	}
+
+	if(!blob_capture_replay(argv[optind], &options, &result)){
+		fprintf(stderr, "%s: could not open capture %s\n", argv[0], argv[optind]);
+		return 1;
+	}
+
+	double seconds = result.elapsed_ns / 1e9;
+	struct blob out;
+	blob_init(&out, 0, 0);
+	blob_offset_t o = blob_open_table(&out);
+	blob_put_string(&out, "records");
+	blob_put_int(&out, result.records);
+	blob_put_string(&out, "bytes");
+	blob_put_int(&out, result.bytes);
+	blob_put_string(&out, "failed");
+	blob_put_int(&out, result.failed);
+	blob_put_string(&out, "invalid");
+	blob_put_int(&out, result.invalid);
+	blob_put_string(&out, "seconds");
+	blob_put_real(&out, seconds);
+	blob_put_string(&out, "records_per_s");
+	blob_put_real(&out, seconds > 0 ? result.records / seconds : 0);
+	blob_put_string(&out, "mb_per_s");
+	blob_put_real(&out, seconds > 0 ? result.bytes / seconds / 1e6 : 0);
+	blob_put_string(&out, "latency");
+	blob_stats_dump_hist(&out, &result.latency);
+	blob_close_table(&out, o);
+
+	char *json = blob_field_to_json(blob_field_first_child(blob_head(&out)));
+	printf("%s\n", json);
+	free(json);
+	blob_free(&out);
+	return 0;
+}
@@ -18,6 +18,7 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <math.h>
 
 uint64_t pack754(long double f, unsigned bits, unsigned expbits){
     long double fnorm;
@@ -27,6 +28,14 @@ uint64_t pack754(long double f, unsigned bits, unsigned expbits){
 
     if (f == 0.0) return 0; // get this special case out of the way
 
+    // infinity and nan have all exponent bits set, nan also has a significand
+    if (isinf(f) || isnan(f)) {
+        uint64_t special = (((1ULL<<expbits) - 1) << significandbits);
+        if (isnan(f)) special |= 1ULL << (significandbits - 1);
+        else if (f < 0) special |= 1ULL << (bits - 1);
+        return special;
+    }
+
     // check sign and begin normalization
     if (f < 0) { sign = 1; fnorm = -f; }
     else { sign = 0; fnorm = f; }
@@ -63,6 +72,10 @@ long double unpack754(uint64_t i, unsigned bits, unsigned expbits){
     // deal with the exponent
     bias = (1<<(expbits-1)) - 1;
     shift = ((i>>significandbits)&((1LL<<expbits)-1)) - bias;
+    if (shift == bias + 1) {
+        if (i & ((1LL<<significandbits)-1)) return NAN;
+        return (i>>(bits-1))&1? -INFINITY: INFINITY;
+    }
     while(shift > 0) { result *= 2.0; shift--; }
     while(shift < 0) { result /= 2.0; shift++; }
 
@@ -79,6 +79,15 @@ Dictates and limits how much stack space for buffers UltraJSON will use before r
 #define JSON_MAX_STACK_BUFFER_SIZE 64
 #endif
 
+/*
+Inputs at least this long are decoded in two stages on CPUs with AVX2: a vectorized pass
+that builds an index of structural characters and a second pass that walks the index.
+Shorter inputs (and CPUs without AVX2) use the byte-at-a-time decoder.
+Define JSON_NO_STRUCTURAL_INDEX to always use the byte-at-a-time decoder. */
+#ifndef JSON_INDEX_MIN_SIZE
+#define JSON_INDEX_MIN_SIZE 64
+#endif
+
 #ifdef _WIN32
 
 typedef __int64 JSINT64;
@@ -299,6 +308,9 @@ EXPORTFUNCTION char *JSON_EncodeObject(JSOBJ obj, JSONObjectEncoder *enc, char *
 
 typedef struct __JSONObjectDecoder
 {
+  /*
+  start and end point into a scratch buffer owned by the decoder. There is always room for one
+  more byte at end so the string may be null terminated in place. */
   JSOBJ (*newString)(void *prv, char *start, char *end);
   void (*objectAddKey)(void *prv, JSOBJ obj, JSOBJ name, JSOBJ value);
   void (*arrayAddItem)(void *prv, JSOBJ obj, JSOBJ value);
@@ -319,6 +331,15 @@ typedef struct __JSONObjectDecoder
   const char *errorOffset;
   int preciseFloat;
   void *prv;
+
+  /*
+  Optional. Called with the name of each object member before its value is decoded. When it
+  returns 0 the member is skipped: the value is only scanned for its end and no other callback
+  is called for the name or the value. endKey is called once a member for which selectKey
+  returned non zero has been decoded. */
+  int (*selectKey)(void *selectPrv, const char *start, const char *end);
+  void (*endKey)(void *selectPrv);
+  void *selectPrv;
 } JSONObjectDecoder;
 
 EXPORTFUNCTION JSOBJ JSON_DecodeObject(JSONObjectDecoder *dec, const char *buffer, size_t cbBuffer);
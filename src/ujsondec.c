@@ -43,6 +43,8 @@ http://www.opensource.apple.com/source/tcl/tcl-14/tcl/license.terms
 #include <limits.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <float.h>
+#include "ujsonpow10.h"
 
 #ifndef TRUE
 #define TRUE 1
@@ -63,6 +65,10 @@ struct DecoderState
 	JSUINT32 objDepth;
 	void *prv;
 	JSONObjectDecoder *dec;
+	const char *base;
+	const JSUINT32 *idx;
+	const JSUINT32 *idxEnd;
+	struct StructuralIndex *index;
 };
 
 JSOBJ decode_any( struct DecoderState *ds);
@@ -81,10 +87,240 @@ static double createDouble(double intNeg, double intValue, double frcValue, int
 	return (intValue + (frcValue * g_pow10[frcDecimalCount])) * intNeg;
 }
 
+/*
+Exact decimal to double conversion. Numbers with at most 19 significant digits are converted
+without going through strtod: small ones with a single exact multiplication or division
+(Clinger's fast path) and the rest with the Eisel-Lemire algorithm, which multiplies the
+normalized decimal mantissa by a 128 bit approximation of the power of ten. Whenever the
+result cannot be proven to be correctly rounded (more than 19 digits, subnormals, overflow
+or a product too close to a halfway point) we return FALSE and the caller uses strtod. */
+
+static INLINE_PREFIX JSUINT64 Mul64(JSUINT64 a, JSUINT64 b, JSUINT64 *lo)
+{
+#ifdef __SIZEOF_INT128__
+	__extension__ typedef unsigned __int128 JSUINT128;
+	JSUINT128 r = (JSUINT128) a * b;
+	*lo = (JSUINT64) r;
+	return (JSUINT64) (r >> 64);
+#else
+	JSUINT64 aLo = a & 0xffffffffULL, aHi = a >> 32;
+	JSUINT64 bLo = b & 0xffffffffULL, bHi = b >> 32;
+	JSUINT64 ll = aLo * bLo, lh = aLo * bHi, hl = aHi * bLo, hh = aHi * bHi;
+	JSUINT64 mid = (ll >> 32) + (lh & 0xffffffffULL) + (hl & 0xffffffffULL);
+	*lo = (mid << 32) | (ll & 0xffffffffULL);
+	return hh + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+static INLINE_PREFIX int LeadingZeros64(JSUINT64 x)
+{
+#ifdef __GNUC__
+	return __builtin_clzll(x);
+#else
+	int n = 0;
+	while (!(x & 0x8000000000000000ULL))
+	{
+		x <<= 1;
+		n ++;
+	}
+	return n;
+#endif
+}
+
+static int EiselLemire(JSUINT64 man, int exp10, int neg, double *value)
+{
+	const JSUINT64 *pow10;
+	JSUINT64 xHi, xLo, yHi, yLo, mergedHi, mergedLo, msb, retMantissa, retExp2, retBits;
+	int clz;
+
+	if (exp10 < JSON_POW10_MIN_EXP10 || exp10 > JSON_POW10_MAX_EXP10)
+	{
+		return FALSE;
+	}
+
+	pow10 = g_pow10Mantissa[exp10 - JSON_POW10_MIN_EXP10];
+
+	// Normalization, 217706 / 2^16 approximates log2(10)
+	clz = LeadingZeros64(man);
+	man <<= clz;
+	retExp2 = (JSUINT64) ((((JSINT64) 217706 * exp10) >> 16) + 64 + 1023) - (JSUINT64) clz;
+
+	// Multiplication, widened to the full 128 bit power when the top 64 bits are not enough
+	xHi = Mul64(man, pow10[0], &xLo);
+
+	if ((xHi & 0x1ff) == 0x1ff && xLo + man < man)
+	{
+		yHi = Mul64(man, pow10[1], &yLo);
+		mergedHi = xHi;
+		mergedLo = xLo + yHi;
+		if (mergedLo < xLo)
+		{
+			mergedHi ++;
+		}
+		if ((mergedHi & 0x1ff) == 0x1ff && mergedLo + 1 == 0 && yLo + man < man)
+		{
+			return FALSE;
+		}
+		xHi = mergedHi;
+		xLo = mergedLo;
+	}
+
+	// Shift to 54 bits and reject products that sit on a rounding boundary
+	msb = xHi >> 63;
+	retMantissa = xHi >> (msb + 9);
+	retExp2 -= 1 ^ msb;
+
+	if (xLo == 0 && (xHi & 0x1ff) == 0 && (retMantissa & 3) == 1)
+	{
+		return FALSE;
+	}
+
+	// Round to nearest even, 54 to 53 bits
+	retMantissa += retMantissa & 1;
+	retMantissa >>= 1;
+	if (retMantissa >> 53)
+	{
+		retMantissa >>= 1;
+		retExp2 ++;
+	}
+
+	// Subnormals, infinities and NaN are left to strtod
+	if (retExp2 - 1 >= 0x7ff - 1)
+	{
+		return FALSE;
+	}
+
+	retBits = retExp2 << 52 | (retMantissa & 0x000fffffffffffffULL);
+	if (neg)
+	{
+		retBits |= 0x8000000000000000ULL;
+	}
+
+	memcpy(value, &retBits, sizeof(*value));
+	return TRUE;
+}
+
+static int ParseExactDouble(const char *start, const char **end, double *value)
+{
+	static const double g_exactPow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+	const char *offset = start;
+	const char *digits;
+	JSUINT64 man = 0;
+	int manDigits = 0;
+	int exp10 = 0;
+	int expValue = 0;
+	int expNeg = 0;
+	int neg = 0;
+	int chr;
+	size_t digitCount;
+
+	if (*offset == '-')
+	{
+		neg = 1;
+		offset ++;
+	}
+
+	digits = offset;
+	for (; (chr = (unsigned char) *offset - '0') >= 0 && chr <= 9; offset ++)
+	{
+		if (manDigits == 19)
+		{
+			return FALSE;
+		}
+		man = man * 10 + (JSUINT64) chr;
+		manDigits += (man != 0);
+	}
+	digitCount = (size_t) (offset - digits);
+
+	if (*offset == '.')
+	{
+		digits = ++offset;
+		for (; (chr = (unsigned char) *offset - '0') >= 0 && chr <= 9; offset ++)
+		{
+			if (manDigits == 19)
+			{
+				return FALSE;
+			}
+			man = man * 10 + (JSUINT64) chr;
+			manDigits += (man != 0);
+			exp10 --;
+		}
+		digitCount += (size_t) (offset - digits);
+	}
+
+	if (digitCount == 0)
+	{
+		return FALSE;
+	}
+
+	// Like strtod the exponent is only consumed when it has at least one digit
+	if (*offset == 'e' || *offset == 'E')
+	{
+		const char *exponent = offset + 1;
+
+		if (*exponent == '-' || *exponent == '+')
+		{
+			expNeg = (*exponent == '-');
+			exponent ++;
+		}
+
+		if ((unsigned char) (*exponent - '0') <= 9)
+		{
+			for (; (chr = (unsigned char) *exponent - '0') >= 0 && chr <= 9; exponent ++)
+			{
+				if (expValue < 100000)
+				{
+					expValue = expValue * 10 + chr;
+				}
+			}
+			exp10 += expNeg ? -expValue : expValue;
+			offset = exponent;
+		}
+	}
+
+	*end = offset;
+
+	if (man == 0)
+	{
+		*value = neg ? -0.0 : 0.0;
+		return TRUE;
+	}
+
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+	if (man <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22)
+	{
+		*value = (double) man;
+		if (exp10 < 0)
+		{
+			*value /= g_exactPow10[-exp10];
+		}
+		else
+		{
+			*value *= g_exactPow10[exp10];
+		}
+		if (neg)
+		{
+			*value = -*value;
+		}
+		return TRUE;
+	}
+#endif
+
+	return EiselLemire(man, exp10, neg, value);
+}
+
 static JSOBJ decodePreciseFloat(struct DecoderState *ds)
 {
+	const char *fastEnd;
 	char *end;
 	double value;
+
+	if (ParseExactDouble(ds->start, &fastEnd, &value))
+	{
+		ds->start = fastEnd;
+		return ds->dec->newDouble(ds->prv, value);
+	}
+
 	errno = 0;
 
 	value = strtod(ds->start, &end);
@@ -98,6 +334,22 @@ static JSOBJ decodePreciseFloat(struct DecoderState *ds)
 	return ds->dec->newDouble(ds->prv, value);
 }
 
+#ifdef __LITTLE_ENDIAN__
+static INLINE_PREFIX int IsEightDigits(JSUINT64 chunk)
+{
+	return !(((chunk + 0x4646464646464646ULL) | (chunk - 0x3030303030303030ULL)) & 0x8080808080808080ULL);
+}
+
+static INLINE_PREFIX JSUINT64 ParseEightDigits(JSUINT64 chunk)
+{
+	// Combine digit pairs, then pairs of pairs, then the two halves
+	chunk -= 0x3030303030303030ULL;
+	chunk = (chunk * 10) + (chunk >> 8);
+	chunk = (((chunk & 0x000000ff000000ffULL) * 0x000f424000000064ULL) + (((chunk >> 16) & 0x000000ff000000ffULL) * 0x0000271000000001ULL)) >> 32;
+	return chunk;
+}
+#endif
+
 static JSOBJ decode_numeric (struct DecoderState *ds)
 {
 	int intNeg = 1;
@@ -123,6 +375,24 @@ static JSOBJ decode_numeric (struct DecoderState *ds)
 	// Scan integer part
 	intValue = 0;
 
+#ifdef __LITTLE_ENDIAN__
+	// Eight digits at a time for as long as the value can not overflow
+	while (mantSize <= 10 && ds->end - offset >= 8)
+	{
+		JSUINT64 chunk;
+		memcpy(&chunk, offset, sizeof(chunk));
+
+		if (!IsEightDigits(chunk))
+		{
+			break;
+		}
+
+		intValue = intValue * 100000000ULL + ParseEightDigits(chunk);
+		offset += 8;
+		mantSize += 8;
+	}
+#endif
+
 	while (1)
 	{
 		chr = (int) (unsigned char) *(offset);
@@ -421,54 +691,71 @@ static const JSUINT8 g_decoderLookup[256] =
 	/* 0xf0 */ 4, 4, 4, 4, 4, 4, 4, 4, DS_UTFLENERROR, DS_UTFLENERROR, DS_UTFLENERROR, DS_UTFLENERROR, DS_UTFLENERROR, DS_UTFLENERROR, DS_UTFLENERROR, DS_UTFLENERROR,
 };
 
-static JSOBJ decode_string ( struct DecoderState *ds)
+static int ReserveEscapeBuffer(struct DecoderState *ds, size_t newSize)
 {
-	JSUTF16 sur[2] = { 0 };
-	int iSur = 0;
-	char *escOffset;
 	char *escStart;
 	size_t escLen = (ds->escEnd - ds->escStart);
-	const JSUINT8 *inputOffset;
-	JSUINT8 oct;
-	//JSUTF32 ucs;
-	ds->lastType = JT_INVALID;
-	ds->start ++;
 
-	if ( (size_t) (ds->end - ds->start) > escLen)
+	if (newSize <= escLen)
 	{
-		size_t newSize = (ds->end - ds->start);
+		return TRUE;
+	}
 
-		if (ds->escHeap)
+	if (ds->escHeap)
+	{
+		if (newSize > (SIZE_MAX / sizeof(char)))
 		{
-			if (newSize > (SIZE_MAX / sizeof(char)))
-			{
-				return SetError(ds, -1, "Could not reserve memory block");
-			}
-			escStart = (char *)ds->dec->realloc(ds->escStart, newSize * sizeof(char));
-			if (!escStart)
-			{
-				ds->dec->free(ds->escStart);
-				return SetError(ds, -1, "Could not reserve memory block");
-			}
-			ds->escStart = escStart;
+			SetError(ds, -1, "Could not reserve memory block");
+			return FALSE;
 		}
-		else
+		escStart = (char *)ds->dec->realloc(ds->escStart, newSize * sizeof(char));
+		if (!escStart)
 		{
-			char *oldStart = ds->escStart;
-			if (newSize > (SIZE_MAX / sizeof(char)))
-			{
-				return SetError(ds, -1, "Could not reserve memory block");
-			}
-			ds->escStart = (char *) ds->dec->malloc(newSize * sizeof(char));
-			if (!ds->escStart)
-			{
-				return SetError(ds, -1, "Could not reserve memory block");
-			}
-			ds->escHeap = 1;
-			memcpy(ds->escStart, oldStart, escLen * sizeof(char));
+			ds->dec->free(ds->escStart);
+			SetError(ds, -1, "Could not reserve memory block");
+			return FALSE;
+		}
+		ds->escStart = escStart;
+	}
+	else
+	{
+		char *oldStart = ds->escStart;
+		if (newSize > (SIZE_MAX / sizeof(char)))
+		{
+			SetError(ds, -1, "Could not reserve memory block");
+			return FALSE;
 		}
+		ds->escStart = (char *) ds->dec->malloc(newSize * sizeof(char));
+		if (!ds->escStart)
+		{
+			SetError(ds, -1, "Could not reserve memory block");
+			return FALSE;
+		}
+		ds->escHeap = 1;
+		memcpy(ds->escStart, oldStart, escLen * sizeof(char));
+	}
+
+	ds->escEnd = ds->escStart + newSize;
+	return TRUE;
+}
+
+/*
+Unescapes the string at ds->start into the escape buffer and returns the end of the unescaped
+string, or NULL on error. */
+static char *scan_string ( struct DecoderState *ds)
+{
+	JSUTF16 sur[2] = { 0 };
+	int iSur = 0;
+	char *escOffset;
+	const JSUINT8 *inputOffset;
+	JSUINT8 oct;
+	//JSUTF32 ucs;
+	ds->lastType = JT_INVALID;
+	ds->start ++;
 
-		ds->escEnd = ds->escStart + newSize;
+	if (!ReserveEscapeBuffer(ds, (size_t) (ds->end - ds->start)))
+	{
+		return NULL;
 	}
 
 	escOffset = ds->escStart;
@@ -487,7 +774,7 @@ static JSOBJ decode_string ( struct DecoderState *ds)
 				ds->lastType = JT_UTF8;
 				inputOffset ++;
 				ds->start += ( (const char *) inputOffset - (ds->start));
-				return ds->dec->newString(ds->prv, ds->escStart, escOffset);
+				return escOffset;
 			}
 			case DS_UTFLENERROR:
 			{
@@ -669,83 +956,362 @@ static JSOBJ decode_string ( struct DecoderState *ds)
 	}
 }
 
-static JSOBJ decode_array(struct DecoderState *ds)
+static JSOBJ decode_string ( struct DecoderState *ds)
 {
-	JSOBJ itemValue;
-	JSOBJ newObj;
-	int len;
-	ds->objDepth++;
-	if (ds->objDepth > JSON_MAX_OBJECT_DEPTH) {
-		return SetError(ds, -1, "Reached object decoding depth limit");
+	char *end = scan_string(ds);
+
+	if (end == NULL)
+	{
+		return NULL;
 	}
 
-	newObj = ds->dec->newArray(ds->prv);
-	len = 0;
+	return ds->dec->newString(ds->prv, ds->escStart, end);
+}
 
-	ds->lastType = JT_INVALID;
-	ds->start ++;
+// what may follow the tokens seen so far while a value is skipped
+enum SKIPSTATE
+{
+	SS_VALUE,
+	SS_FIRST_VALUE,
+	SS_KEY,
+	SS_FIRST_KEY,
+	SS_COLON,
+	SS_NEXT
+};
 
-	for (;;)
+/*
+Checks that a token starting with chr may come next and moves on to the state after it. stack
+holds the closing bracket of every open array and object. Objects may end with a comma just
+like decode_object allows. */
+static int SkipToken(struct DecoderState *ds, char *stack, int *depth, int *state, char chr)
+{
+	switch (chr)
 	{
-		SkipWhitespace(ds);
+		case '[':
+		case '{':
+			if (*state != SS_VALUE && *state != SS_FIRST_VALUE)
+			{
+				break;
+			}
+			if (*depth == JSON_MAX_OBJECT_DEPTH || ds->objDepth + *depth >= JSON_MAX_OBJECT_DEPTH)
+			{
+				SetError(ds, -1, "Reached object decoding depth limit");
+				return FALSE;
+			}
+			stack[(*depth)++] = (char) (chr + 2);
+			*state = (chr == '[') ? SS_FIRST_VALUE : SS_FIRST_KEY;
+			return TRUE;
 
-		if ((*ds->start) == ']'){
-			ds->objDepth--;
-			if (len == 0)
+		case ']':
+			if (*depth == 0 || stack[*depth - 1] != chr || (*state != SS_NEXT && *state != SS_FIRST_VALUE))
 			{
-				ds->start ++;
-				return newObj;
+				break;
 			}
-		printf("release object\n"); 
-			ds->dec->releaseObject(ds->prv, newObj);
-			return SetError(ds, -1, "Unexpected character found when decoding array value (1)");
-		}
+			(*depth) --;
+			*state = SS_NEXT;
+			return TRUE;
 
-		itemValue = decode_any(ds);
+		case '}':
+			if (*depth == 0 || stack[*depth - 1] != chr || (*state != SS_NEXT && *state != SS_FIRST_KEY && *state != SS_KEY))
+			{
+				break;
+			}
+			(*depth) --;
+			*state = SS_NEXT;
+			return TRUE;
 
-		if (itemValue == NULL)
-		{
-			ds->dec->releaseObject(ds->prv, newObj);
-			return NULL;
-		}
-	
-		ds->dec->arrayAddItem (ds->prv, newObj, itemValue);
+		case ',':
+			if (*depth == 0 || *state != SS_NEXT)
+			{
+				break;
+			}
+			*state = (stack[*depth - 1] == ']') ? SS_VALUE : SS_KEY;
+			return TRUE;
 
-		SkipWhitespace(ds);
+		case ':':
+			if (*state != SS_COLON)
+			{
+				break;
+			}
+			*state = SS_VALUE;
+			return TRUE;
 
-		switch (*(ds->start++))
-		{
-		case ']':{
-			ds->objDepth--;
-			ds->dec->releaseObject(ds->prv, newObj);
-			return newObj;
-		}
-		case ',':
-			break;
+		case '\"':
+			if (*state == SS_KEY || *state == SS_FIRST_KEY)
+			{
+				*state = SS_COLON;
+				return TRUE;
+			}
+			if (*state != SS_VALUE && *state != SS_FIRST_VALUE)
+			{
+				break;
+			}
+			*state = SS_NEXT;
+			return TRUE;
 
 		default:
-			ds->dec->releaseObject(ds->prv, newObj);
-			return SetError(ds, -1, "Unexpected character found when decoding array value (2)");
-		}
-
-		len ++;
+			if (*state != SS_VALUE && *state != SS_FIRST_VALUE)
+			{
+				break;
+			}
+			*state = SS_NEXT;
+			return TRUE;
 	}
+
+	SetError(ds, -1, "Unexpected character found when skipping value");
+	return FALSE;
 }
 
-static JSOBJ decode_object( struct DecoderState *ds)
+/*
+Returns the end of the number or literal at offset or NULL if decoding it would fail. Accepts
+exactly what decode_numeric and the literal decoders accept, including the loose forms like "-",
+"1." and "1e" that the number scanner takes. Only numbers that decodePreciseFloat would parse are
+converted, everything else is just scanned. */
+static const char *SkipScalar(struct DecoderState *ds, const char *offset)
 {
-	JSOBJ itemName;
-	JSOBJ itemValue;
-	JSOBJ newObj;
+	const char *start = offset;
+	const char *fastEnd;
+	char *end;
+	double value;
+	JSUINT64 intValue = 0;
+	JSUINT64 prevIntValue;
+	int intNeg = 0;
 
-	ds->objDepth++;
-	if (ds->objDepth > JSON_MAX_OBJECT_DEPTH) {
-		return SetError(ds, -1, "Reached object decoding depth limit");
+	switch (*offset)
+	{
+		case 't': return strncmp(offset, "true", 4) == 0 ? offset + 4 : NULL;
+		case 'f': return strncmp(offset, "false", 5) == 0 ? offset + 5 : NULL;
+		case 'n': return strncmp(offset, "null", 4) == 0 ? offset + 4 : NULL;
 	}
 
-	newObj = ds->dec->newObject(ds->prv);
+	if (*offset == '-')
+	{
+		intNeg = 1;
+		offset ++;
+	}
+	else
+	if (*offset < '0' || *offset > '9')
+	{
+		return NULL;
+	}
 
-	ds->start ++;
+	// with the same overflow checks as decode_numeric
+	for (; *offset >= '0' && *offset <= '9'; offset ++)
+	{
+		prevIntValue = intValue;
+		intValue = intValue * 10ULL + (JSUINT64) (*offset - '0');
+
+		if ((!intNeg && prevIntValue > intValue) || (intNeg && intValue > (JSUINT64) LLONG_MIN))
+		{
+			return NULL;
+		}
+	}
+
+	if (*offset != '.' && *offset != 'e' && *offset != 'E')
+	{
+		return offset;
+	}
+
+	if (ds->dec->preciseFloat)
+	{
+		if (ParseExactDouble(start, &fastEnd, &value))
+		{
+			return fastEnd;
+		}
+
+		errno = 0;
+		value = strtod(start, &end);
+
+		// when strtod takes nothing the decoder does not move on and fails on what follows
+		return (errno == ERANGE || end == start) ? NULL : end;
+	}
+
+	if (*offset == '.')
+	{
+		for (offset ++; *offset >= '0' && *offset <= '9'; offset ++);
+	}
+
+	if (*offset == 'e' || *offset == 'E')
+	{
+		offset ++;
+		if (*offset == '+' || *offset == '-')
+		{
+			offset ++;
+		}
+		for (; *offset >= '0' && *offset <= '9'; offset ++);
+	}
+
+	return offset;
+}
+
+/*
+Skips over the value at ds->start without decoding it into objects. Everything is checked as
+strictly as decoding it would, strings are unescaped into the escape buffer to validate them. */
+static int SkipValue(struct DecoderState *ds)
+{
+	char stack[JSON_MAX_OBJECT_DEPTH];
+	int depth = 0;
+	int state = SS_VALUE;
+	const char *offset;
+
+	do
+	{
+		SkipWhitespace(ds);
+		offset = ds->start;
+
+		if (!SkipToken(ds, stack, &depth, &state, *offset))
+		{
+			return FALSE;
+		}
+
+		switch (*offset)
+		{
+			case '\"':
+				if (scan_string(ds) == NULL)
+				{
+					return FALSE;
+				}
+				offset = ds->start;
+				break;
+
+			case '[':
+			case '{':
+			case ']':
+			case '}':
+			case ',':
+			case ':':
+				offset ++;
+				break;
+
+			default:
+				offset = SkipScalar(ds, offset);
+
+				if (offset == NULL)
+				{
+					SetError(ds, -1, "Expected object or value");
+					return FALSE;
+				}
+				break;
+		}
+
+		ds->start = offset;
+	}
+	while (depth > 0);
+
+	return TRUE;
+}
+
+/*
+Called with the name of an object member in the escape buffer. Decodes the member if the
+selectKey callback wants it and skips its value otherwise. */
+static int DecodeSelectedMember(struct DecoderState *ds, JSOBJ obj, char *nameEnd, PFN_DECODER decodeValue, int (*skipValue)(struct DecoderState *ds))
+{
+	JSOBJ itemName;
+	JSOBJ itemValue;
+
+	if (!ds->dec->selectKey(ds->dec->selectPrv, ds->escStart, nameEnd))
+	{
+		return skipValue(ds);
+	}
+
+	itemName = ds->dec->newString(ds->prv, ds->escStart, nameEnd);
+
+	if (itemName == NULL)
+	{
+		ds->dec->endKey(ds->dec->selectPrv);
+		return FALSE;
+	}
+
+	itemValue = decodeValue(ds);
+	ds->dec->endKey(ds->dec->selectPrv);
+
+	if (itemValue == NULL)
+	{
+		ds->dec->releaseObject(ds->prv, itemName);
+		return FALSE;
+	}
+
+	ds->dec->objectAddKey (ds->prv, obj, itemName, itemValue);
+	return TRUE;
+}
+
+static JSOBJ decode_array(struct DecoderState *ds)
+{
+	JSOBJ itemValue;
+	JSOBJ newObj;
+	int len;
+	ds->objDepth++;
+	if (ds->objDepth > JSON_MAX_OBJECT_DEPTH) {
+		return SetError(ds, -1, "Reached object decoding depth limit");
+	}
+
+	newObj = ds->dec->newArray(ds->prv);
+	len = 0;
+
+	ds->lastType = JT_INVALID;
+	ds->start ++;
+
+	for (;;)
+	{
+		SkipWhitespace(ds);
+
+		if ((*ds->start) == ']'){
+			ds->objDepth--;
+			if (len == 0)
+			{
+				ds->start ++;
+				return newObj;
+			}
+		printf("release object\n"); 
+			ds->dec->releaseObject(ds->prv, newObj);
+			return SetError(ds, -1, "Unexpected character found when decoding array value (1)");
+		}
+
+		itemValue = decode_any(ds);
+
+		if (itemValue == NULL)
+		{
+			ds->dec->releaseObject(ds->prv, newObj);
+			return NULL;
+		}
+	
+		ds->dec->arrayAddItem (ds->prv, newObj, itemValue);
+
+		SkipWhitespace(ds);
+
+		switch (*(ds->start++))
+		{
+		case ']':{
+			ds->objDepth--;
+			ds->dec->releaseObject(ds->prv, newObj);
+			return newObj;
+		}
+		case ',':
+			break;
+
+		default:
+			ds->dec->releaseObject(ds->prv, newObj);
+			return SetError(ds, -1, "Unexpected character found when decoding array value (2)");
+		}
+
+		len ++;
+	}
+}
+
+static JSOBJ decode_object( struct DecoderState *ds)
+{
+	JSOBJ itemName;
+	JSOBJ itemValue;
+	JSOBJ newObj;
+
+	ds->objDepth++;
+	if (ds->objDepth > JSON_MAX_OBJECT_DEPTH) {
+		return SetError(ds, -1, "Reached object decoding depth limit");
+	}
+
+	newObj = ds->dec->newObject(ds->prv);
+
+	ds->start ++;
 
 	for (;;)
 	{
@@ -760,6 +1326,42 @@ static JSOBJ decode_object( struct DecoderState *ds)
 		}
 
 		ds->lastType = JT_INVALID;
+
+		if (ds->dec->selectKey)
+		{
+			char *nameEnd;
+
+			if (*ds->start != '\"')
+			{
+				ds->dec->releaseObject(ds->prv, newObj);
+				return SetError(ds, -1, "Key name of object must be 'string' when decoding 'object'");
+			}
+
+			nameEnd = scan_string(ds);
+
+			if (nameEnd == NULL)
+			{
+				ds->dec->releaseObject(ds->prv, newObj);
+				return NULL;
+			}
+
+			SkipWhitespace(ds);
+
+			if (*(ds->start++) != ':')
+			{
+				ds->dec->releaseObject(ds->prv, newObj);
+				return SetError(ds, -1, "No ':' found when decoding object value");
+			}
+
+			if (!DecodeSelectedMember(ds, newObj, nameEnd, decode_any, SkipValue))
+			{
+				ds->dec->releaseObject(ds->prv, newObj);
+				return NULL;
+			}
+
+			goto NEXT_MEMBER;
+		}
+
 		itemName = decode_any(ds);
 
 		if (itemName == NULL)
@@ -797,6 +1399,7 @@ static JSOBJ decode_object( struct DecoderState *ds)
 
 		ds->dec->objectAddKey (ds->prv, newObj, itemName, itemValue);
 
+NEXT_MEMBER:
 		SkipWhitespace(ds);
 
 		switch (*(ds->start++))
@@ -858,6 +1461,680 @@ JSOBJ decode_any(struct DecoderState *ds)
 	}
 }
 
+/*
+Two stage decoding
+
+The first stage classifies 64 bytes of input at a time with AVX2 and writes the offset of
+every structural character ({ } [ ] : , and unescaped quotes) and of the first character of
+every scalar (numbers, true, false, null) into an index. Characters inside strings never make
+it into the index, so the second stage can walk the index token by token without looking at
+whitespace or string contents one byte at a time. Strings without escapes or multibyte
+characters are copied out in one go; everything else is handed over to the byte-at-a-time
+routines above so that both paths produce identical results. */
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(JSON_NO_STRUCTURAL_INDEX)
+#define JSON_HAVE_STRUCTURAL_INDEX
+#endif
+
+#ifdef JSON_HAVE_STRUCTURAL_INDEX
+#include <immintrin.h>
+
+#ifndef JSON_INDEX_BATCH
+#define JSON_INDEX_BATCH 1024
+#endif
+
+// set on the closing quote of strings that contain escapes, multibyte or null characters
+#define INDEX_SPECIAL_STRING 0x80000000UL
+#define INDEX_OFFSET_MASK 0x7fffffffUL
+
+struct StructuralIndex
+{
+	JSUINT32 entries[JSON_INDEX_BATCH];
+	size_t pos;
+	JSUINT64 oddBackslash;
+	JSUINT64 inString;
+	JSUINT64 separator;
+	JSUINT64 special;
+};
+
+static int CpuHasAVX2(void)
+{
+	static int hasAVX2 = -1;
+
+	if (hasAVX2 < 0)
+	{
+		__builtin_cpu_init();
+		hasAVX2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+	}
+
+	return hasAVX2;
+}
+
+__attribute__((target("avx2")))
+static INLINE_PREFIX JSUINT64 ClassifyByte(__m256i lo, __m256i hi, char c)
+{
+	const __m256i needle = _mm256_set1_epi8(c);
+	JSUINT64 l = (JSUINT32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, needle));
+	JSUINT64 h = (JSUINT32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, needle));
+	return l | (h << 32);
+}
+
+/*
+Operators and whitespace are told apart with two 16 entry lookups, one on the low and one
+on the high nibble of each byte. A bit survives the AND of both lookups only for the
+characters of its class:
+	0x01 ','        0x02 ':'        0x04 '[' ']' '{' '}'
+	0x08 ' '        0x10 '\t' '\n' '\r' */
+#define CLASS_OPERATOR 0x07
+#define CLASS_WHITESPACE 0x18
+
+__attribute__((target("avx2")))
+static INLINE_PREFIX __m256i ClassifyNibbles(__m256i v)
+{
+	const __m256i lowTable = _mm256_setr_epi8(
+		0x08, 0, 0, 0, 0, 0, 0, 0, 0, 0x10, 0x12, 0x04, 0x01, 0x14, 0, 0,
+		0x08, 0, 0, 0, 0, 0, 0, 0, 0, 0x10, 0x12, 0x04, 0x01, 0x14, 0, 0);
+	const __m256i highTable = _mm256_setr_epi8(
+		0x10, 0, 0x09, 0x02, 0, 0x04, 0, 0x04, 0, 0, 0, 0, 0, 0, 0, 0,
+		0x10, 0, 0x09, 0x02, 0, 0x04, 0, 0x04, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	__m256i low = _mm256_shuffle_epi8(lowTable, _mm256_and_si256(v, nibble));
+	__m256i high = _mm256_shuffle_epi8(highTable, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+	return _mm256_and_si256(low, high);
+}
+
+__attribute__((target("avx2")))
+static INLINE_PREFIX JSUINT64 ClassMask(__m256i lo, __m256i hi, char bits)
+{
+	const __m256i mask = _mm256_set1_epi8(bits);
+	const __m256i zero = _mm256_setzero_si256();
+	JSUINT64 l = (JSUINT32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(lo, mask), zero));
+	JSUINT64 h = (JSUINT32) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(hi, mask), zero));
+	return ~(l | (h << 32));
+}
+
+/*
+Returns a mask of the characters that follow an odd length run of backslashes, ie. the
+characters that are escaped. The carry tells whether the previous block ended in such a run. */
+static INLINE_PREFIX JSUINT64 FindEscaped(JSUINT64 backslash, JSUINT64 *carry)
+{
+	const JSUINT64 evenBits = 0x5555555555555555ULL;
+	const JSUINT64 oddBits = ~evenBits;
+	JSUINT64 startEdges = backslash & ~(backslash << 1);
+	JSUINT64 evenStartMask = evenBits ^ *carry;
+	JSUINT64 evenStarts = startEdges & evenStartMask;
+	JSUINT64 oddStarts = startEdges & ~evenStartMask;
+	JSUINT64 evenCarries = backslash + evenStarts;
+	JSUINT64 oddCarries;
+	JSUINT64 endsOdd = __builtin_add_overflow(backslash, oddStarts, &oddCarries) ? 1 : 0;
+
+	oddCarries |= *carry;
+	*carry = endsOdd;
+
+	return ((evenCarries & ~backslash) & oddBits) | ((oddCarries & ~backslash) & evenBits);
+}
+
+static INLINE_PREFIX JSUINT64 PrefixXor(JSUINT64 x)
+{
+	x ^= x << 1;
+	x ^= x << 2;
+	x ^= x << 4;
+	x ^= x << 8;
+	x ^= x << 16;
+	x ^= x << 32;
+	return x;
+}
+
+static INLINE_PREFIX void WriteIndexEntry(JSUINT32 *entry, size_t pos, JSUINT64 *bits, JSUINT64 specialClose)
+{
+	// or-ing in the top bit keeps ctz defined once all bits have been consumed
+	int bit = __builtin_ctzll(*bits | (1ULL << 63));
+	*entry = (JSUINT32) (pos + bit) | ((JSUINT32) ((specialClose >> bit) & 1) << 31);
+	*bits &= *bits - 1;
+}
+
+/*
+Indexes the input from where the previous call left off until the batch is full or the
+input runs out. Offsets are relative to ds->base. Returns the number of entries written. */
+__attribute__((target("avx2")))
+static size_t BuildStructuralIndex(struct DecoderState *ds)
+{
+	struct StructuralIndex *index = ds->index;
+	size_t cbBuffer = (size_t) (ds->end - ds->base);
+	JSUINT32 *offset = index->entries;
+	char tail[64];
+
+	for (; index->pos < cbBuffer && offset + 64 <= index->entries + JSON_INDEX_BATCH; index->pos += 64)
+	{
+		size_t pos = index->pos;
+		const char *block = ds->base + pos;
+		size_t remain = cbBuffer - pos;
+		JSUINT64 quote, backslash, ops, ws, sep, inString, special, specialClose, structural, carry;
+		int count;
+		__m256i lo, hi, classLo, classHi;
+
+		if (remain < 64)
+		{
+			memset(tail, ' ', sizeof(tail));
+			memcpy(tail, block, remain);
+			block = tail;
+		}
+
+		lo = _mm256_loadu_si256((const __m256i *) block);
+		hi = _mm256_loadu_si256((const __m256i *) (block + 32));
+
+		quote = ClassifyByte(lo, hi, '\"');
+		backslash = ClassifyByte(lo, hi, '\\');
+		classLo = ClassifyNibbles(lo);
+		classHi = ClassifyNibbles(hi);
+		ops = ClassMask(classLo, classHi, CLASS_OPERATOR);
+		ws = ClassMask(classLo, classHi, CLASS_WHITESPACE);
+		special = backslash | ClassifyByte(lo, hi, '\0') |
+			(JSUINT32) _mm256_movemask_epi8(lo) | ((JSUINT64) (JSUINT32) _mm256_movemask_epi8(hi) << 32);
+
+		quote &= ~FindEscaped(backslash, &index->oddBackslash);
+
+		// covers the opening quote and the string contents but not the closing quote
+		inString = PrefixXor(quote) ^ index->inString;
+		index->inString = (JSUINT64) ((JSINT64) inString >> 63);
+
+		// a scalar starts at any other character that follows whitespace, an operator or a quote
+		sep = ws | ops | quote;
+		structural = (ops & ~inString) | quote | (~sep & ~inString & ((sep << 1) | index->separator));
+		index->separator = sep >> 63;
+
+		if (remain < 64)
+		{
+			structural &= (1ULL << remain) - 1;
+		}
+
+		/*
+		Flag the closing quote of every string that contains a special character. Adding the
+		special characters to the in-string mask carries out of the run of ones that makes up
+		the string exactly onto its closing quote. A carry out of the block is passed on to the
+		next one. Only characters inside strings matter here, the rest is rejected by the second
+		stage anyway. */
+		special &= inString;
+		carry = __builtin_add_overflow(inString, special, &specialClose);
+		carry |= __builtin_add_overflow(specialClose, index->special, &specialClose);
+		specialClose &= quote & ~inString;
+		index->special = carry;
+
+		/*
+		Entries are written four at a time. The batch always has room for a whole block so the
+		surplus writes past the last set bit are harmless and simply get overwritten later. */
+		count = __builtin_popcountll(structural);
+
+		for (int i = 0; i < count; i += 4)
+		{
+			WriteIndexEntry(offset + i + 0, pos, &structural, specialClose);
+			WriteIndexEntry(offset + i + 1, pos, &structural, specialClose);
+			WriteIndexEntry(offset + i + 2, pos, &structural, specialClose);
+			WriteIndexEntry(offset + i + 3, pos, &structural, specialClose);
+		}
+
+		offset += count;
+	}
+
+	return (size_t) (offset - index->entries);
+}
+
+/*
+Makes sure there is at least one unconsumed entry in the index unless the input is exhausted. */
+static INLINE_PREFIX int FillIndex(struct DecoderState *ds)
+{
+	while (ds->idx == ds->idxEnd && ds->index->pos < (size_t) (ds->end - ds->base))
+	{
+		ds->idx = ds->index->entries;
+		ds->idxEnd = ds->idx + BuildStructuralIndex(ds);
+	}
+
+	return ds->idx < ds->idxEnd;
+}
+
+static JSOBJ decode_indexed_any(struct DecoderState *ds);
+
+static INLINE_PREFIX char PeekIndexed(struct DecoderState *ds)
+{
+	return FillIndex(ds) ? ds->base[*ds->idx & INDEX_OFFSET_MASK] : '\0';
+}
+
+static INLINE_PREFIX const char *NextIndexed(struct DecoderState *ds)
+{
+	return FillIndex(ds) ? ds->base + (*ds->idx & INDEX_OFFSET_MASK) : ds->end;
+}
+
+static char *scan_indexed_string(struct DecoderState *ds)
+{
+	const char *open = ds->base + (*(ds->idx++) & INDEX_OFFSET_MASK);
+	const char *close;
+	JSUINT32 entry;
+	size_t len;
+
+	ds->start = open;
+	ds->lastType = JT_INVALID;
+
+	if (!FillIndex(ds))
+	{
+		return SetError(ds, -1, "Unmatched ''\"' when when decoding 'string'");
+	}
+
+	entry = *(ds->idx++);
+
+	if (entry & INDEX_SPECIAL_STRING)
+	{
+		return scan_string(ds);
+	}
+
+	close = ds->base + entry;
+	len = (size_t) (close - open - 1);
+
+	// one extra byte so that the callback may terminate the string in place
+	if (len >= (size_t) (ds->escEnd - ds->escStart) && !ReserveEscapeBuffer(ds, len + 1))
+	{
+		return NULL;
+	}
+
+	memcpy(ds->escStart, open + 1, len);
+	ds->lastType = JT_UTF8;
+	ds->start = close + 1;
+	return ds->escStart + len;
+}
+
+static JSOBJ decode_indexed_string(struct DecoderState *ds)
+{
+	char *end = scan_indexed_string(ds);
+
+	if (end == NULL)
+	{
+		return NULL;
+	}
+
+	return ds->dec->newString(ds->prv, ds->escStart, end);
+}
+
+/*
+Skips over the next value by walking the index. Checks the same as SkipValue. */
+static int SkipIndexedValue(struct DecoderState *ds)
+{
+	char stack[JSON_MAX_OBJECT_DEPTH];
+	int depth = 0;
+	int state = SS_VALUE;
+	const char *end;
+	const char *next;
+	char chr;
+
+	do
+	{
+		ds->start = NextIndexed(ds);
+		chr = PeekIndexed(ds);
+
+		if (chr == '\0')
+		{
+			SetError(ds, -1, "Expected object or value");
+			return FALSE;
+		}
+
+		if (!SkipToken(ds, stack, &depth, &state, chr))
+		{
+			return FALSE;
+		}
+
+		switch (chr)
+		{
+			case '\"':
+				if (scan_indexed_string(ds) == NULL)
+				{
+					return FALSE;
+				}
+				break;
+
+			case '[':
+			case '{':
+			case ']':
+			case '}':
+			case ',':
+			case ':':
+				ds->idx ++;
+				break;
+
+			default:
+				end = SkipScalar(ds, ds->start);
+
+				if (end == NULL)
+				{
+					SetError(ds, -1, "Expected object or value");
+					return FALSE;
+				}
+
+				// only whitespace may follow a scalar up to the next structural character, as in
+				// decode_indexed_scalar
+				ds->idx ++;
+				next = NextIndexed(ds);
+
+				if (end > next)
+				{
+					SetError(ds, -1, "Unexpected character found after value");
+					return FALSE;
+				}
+
+				for (; end < next; end ++)
+				{
+					if (*end != ' ' && *end != '\t' && *end != '\r' && *end != '\n')
+					{
+						SetError(ds, -1, "Unexpected character found after value");
+						return FALSE;
+					}
+				}
+				break;
+		}
+	}
+	while (depth > 0);
+
+	return TRUE;
+}
+
+static JSOBJ decode_indexed_scalar(struct DecoderState *ds)
+{
+	JSOBJ ret;
+	const char *next;
+
+	ds->start = ds->base + (*(ds->idx++) & INDEX_OFFSET_MASK);
+
+	switch (*ds->start)
+	{
+		case '0':
+		case '1':
+		case '2':
+		case '3':
+		case '4':
+		case '5':
+		case '6':
+		case '7':
+		case '8':
+		case '9':
+		case '-':
+			ret = decode_numeric(ds);
+			break;
+
+		case 't': ret = decode_true(ds); break;
+		case 'f': ret = decode_false(ds); break;
+		case 'n': ret = decode_null(ds); break;
+
+		default:
+			return SetError(ds, -1, "Expected object or value");
+	}
+
+	if (ret == NULL)
+	{
+		return NULL;
+	}
+
+	// only whitespace may follow a scalar up to the next structural character
+	next = NextIndexed(ds);
+
+	if (ds->start > next)
+	{
+		ds->dec->releaseObject(ds->prv, ret);
+		return SetError(ds, -1, "Unexpected character found after value");
+	}
+
+	for (; ds->start < next; ds->start ++)
+	{
+		switch (*ds->start)
+		{
+			case ' ':
+			case '\t':
+			case '\r':
+			case '\n':
+				break;
+
+			default:
+				ds->dec->releaseObject(ds->prv, ret);
+				return SetError(ds, -1, "Unexpected character found after value");
+		}
+	}
+
+	return ret;
+}
+
+static JSOBJ decode_indexed_array(struct DecoderState *ds)
+{
+	JSOBJ itemValue;
+	JSOBJ newObj;
+
+	ds->objDepth++;
+	if (ds->objDepth > JSON_MAX_OBJECT_DEPTH) {
+		return SetError(ds, -1, "Reached object decoding depth limit");
+	}
+
+	newObj = ds->dec->newArray(ds->prv);
+
+	ds->lastType = JT_INVALID;
+	ds->start = ds->base + (*(ds->idx++) & INDEX_OFFSET_MASK);
+
+	if (PeekIndexed(ds) == ']')
+	{
+		ds->objDepth--;
+		ds->start = NextIndexed(ds) + 1;
+		ds->idx++;
+		return newObj;
+	}
+
+	for (;;)
+	{
+		itemValue = decode_indexed_any(ds);
+
+		if (itemValue == NULL)
+		{
+			ds->dec->releaseObject(ds->prv, newObj);
+			return NULL;
+		}
+
+		ds->dec->arrayAddItem (ds->prv, newObj, itemValue);
+
+		ds->start = NextIndexed(ds);
+
+		switch (PeekIndexed(ds))
+		{
+			case ']':
+				ds->objDepth--;
+				ds->start ++;
+				ds->idx ++;
+				ds->dec->releaseObject(ds->prv, newObj);
+				return newObj;
+
+			case ',':
+				ds->start ++;
+				ds->idx ++;
+				if (PeekIndexed(ds) == ']')
+				{
+					ds->dec->releaseObject(ds->prv, newObj);
+					return SetError(ds, -1, "Unexpected character found when decoding array value (1)");
+				}
+				break;
+
+			default:
+				ds->dec->releaseObject(ds->prv, newObj);
+				return SetError(ds, -1, "Unexpected character found when decoding array value (2)");
+		}
+	}
+}
+
+static JSOBJ decode_indexed_object(struct DecoderState *ds)
+{
+	JSOBJ itemName;
+	JSOBJ itemValue;
+	JSOBJ newObj;
+
+	ds->objDepth++;
+	if (ds->objDepth > JSON_MAX_OBJECT_DEPTH) {
+		return SetError(ds, -1, "Reached object decoding depth limit");
+	}
+
+	newObj = ds->dec->newObject(ds->prv);
+
+	ds->start = ds->base + (*(ds->idx++) & INDEX_OFFSET_MASK);
+
+	if (PeekIndexed(ds) == '}')
+	{
+		ds->objDepth--;
+		ds->start = NextIndexed(ds) + 1;
+		ds->idx++;
+		ds->dec->releaseObject(ds->prv, newObj);
+		return newObj;
+	}
+
+	for (;;)
+	{
+		ds->start = NextIndexed(ds);
+
+		if (PeekIndexed(ds) != '\"')
+		{
+			ds->dec->releaseObject(ds->prv, newObj);
+			return SetError(ds, -1, "Key name of object must be 'string' when decoding 'object'");
+		}
+
+		if (ds->dec->selectKey)
+		{
+			char *nameEnd = scan_indexed_string(ds);
+
+			if (nameEnd == NULL)
+			{
+				ds->dec->releaseObject(ds->prv, newObj);
+				return NULL;
+			}
+
+			ds->start = NextIndexed(ds);
+
+			if (PeekIndexed(ds) != ':')
+			{
+				ds->dec->releaseObject(ds->prv, newObj);
+				return SetError(ds, -1, "No ':' found when decoding object value");
+			}
+
+			ds->idx ++;
+
+			if (!DecodeSelectedMember(ds, newObj, nameEnd, decode_indexed_any, SkipIndexedValue))
+			{
+				ds->dec->releaseObject(ds->prv, newObj);
+				return NULL;
+			}
+
+			goto NEXT_MEMBER;
+		}
+
+		itemName = decode_indexed_string(ds);
+
+		if (itemName == NULL)
+		{
+			ds->dec->releaseObject(ds->prv, newObj);
+			return NULL;
+		}
+
+		ds->start = NextIndexed(ds);
+
+		if (PeekIndexed(ds) != ':')
+		{
+			ds->dec->releaseObject(ds->prv, newObj);
+			ds->dec->releaseObject(ds->prv, itemName);
+			return SetError(ds, -1, "No ':' found when decoding object value");
+		}
+
+		ds->idx ++;
+
+		itemValue = decode_indexed_any(ds);
+
+		if (itemValue == NULL)
+		{
+			ds->dec->releaseObject(ds->prv, newObj);
+			ds->dec->releaseObject(ds->prv, itemName);
+			return NULL;
+		}
+
+		ds->dec->objectAddKey (ds->prv, newObj, itemName, itemValue);
+
+NEXT_MEMBER:
+		ds->start = NextIndexed(ds);
+
+		switch (PeekIndexed(ds))
+		{
+			case '}':
+				ds->objDepth--;
+				ds->start ++;
+				ds->idx ++;
+				ds->dec->releaseObject(ds->prv, newObj);
+				return newObj;
+
+			case ',':
+				ds->idx ++;
+				if (PeekIndexed(ds) == '}')
+				{
+					ds->objDepth--;
+					ds->start = NextIndexed(ds) + 1;
+					ds->idx ++;
+					ds->dec->releaseObject(ds->prv, newObj);
+					return newObj;
+				}
+				break;
+
+			default:
+				ds->dec->releaseObject(ds->prv, newObj);
+				return SetError(ds, -1, "Unexpected character in found when decoding object value");
+		}
+	}
+}
+
+static JSOBJ decode_indexed_any(struct DecoderState *ds)
+{
+	ds->start = NextIndexed(ds);
+
+	switch (PeekIndexed(ds))
+	{
+		case '\"': return decode_indexed_string(ds);
+		case '[': return decode_indexed_array(ds);
+		case '{': return decode_indexed_object(ds);
+		case '\0': return SetError(ds, -1, "Expected object or value");
+		default: return decode_indexed_scalar(ds);
+	}
+}
+
+static JSOBJ decode_indexed(struct DecoderState *ds)
+{
+	struct StructuralIndex index;
+	JSOBJ ret;
+
+	index.pos = 0;
+	index.oddBackslash = 0;
+	index.inString = 0;
+	index.separator = 1;
+	index.special = 0;
+
+	ds->base = ds->start;
+	ds->idx = ds->idxEnd = index.entries;
+	ds->index = &index;
+
+	ret = decode_indexed_any(ds);
+
+	if (ret && !ds->dec->errorStr)
+	{
+		if (FillIndex(ds))
+		{
+			ds->start = NextIndexed(ds);
+			ds->dec->releaseObject(ds->prv, ret);
+			ret = SetError(ds, -1, "Trailing data");
+		}
+		else
+		{
+			ds->start = ds->end;
+		}
+	}
+
+	ds->index = NULL;
+	return ret;
+}
+#endif
+
 JSOBJ JSON_DecodeObject(JSONObjectDecoder *dec, const char *buffer, size_t cbBuffer)
 {
 	/*
@@ -877,9 +2154,19 @@ JSOBJ JSON_DecodeObject(JSONObjectDecoder *dec, const char *buffer, size_t cbBuf
 	ds.dec->errorStr = NULL;
 	ds.dec->errorOffset = NULL;
 	ds.objDepth = 0;
+	ds.base = ds.start;
+	ds.idx = ds.idxEnd = NULL;
+	ds.index = NULL;
 
 	ds.dec = dec;
 
+#ifdef JSON_HAVE_STRUCTURAL_INDEX
+	if (cbBuffer >= JSON_INDEX_MIN_SIZE && cbBuffer <= INDEX_OFFSET_MASK && CpuHasAVX2())
+	{
+		ret = decode_indexed (&ds);
+	}
+	else
+#endif
 	ret = decode_any (&ds);
 
 	if (ds.escHeap)
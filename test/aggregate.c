@@ -0,0 +1,99 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#define VALUES 10000
+
+int main(void){
+	struct blob blob, columns;
+	double val, sum = 0, min = INFINITY, max = -INFINITY;
+	blob_init(&blob, 0, 0);
+	blob_init(&columns, 0, 0);
+
+	// runs of every type with a few strings and nested fields in between
+	blob_offset_t o = blob_open_array(&blob);
+	for(int c = 0; c < VALUES; c++){
+		switch((c / 500) % 6){
+			case 0: val = (c % 200) - 100; break;
+			case 1: val = c * 3 - 20000; break;
+			case 2: val = c * 100000; break;
+			case 3: val = (long long)c * 1000000000LL; break;
+			case 4: val = c * 0.5; break;
+			default: val = c * 0.1; break;
+		}
+		if(val == (long long)val) blob_put_int(&blob, val);
+		else blob_put_real(&blob, val);
+		sum += val;
+		if(val < min) min = val;
+		if(val > max) max = val;
+		if(c % 777 == 0) blob_put_string(&blob, "skipped");
+		if(c % 1234 == 0){
+			blob_offset_t a = blob_open_array(&blob);
+			blob_put_int(&blob, 1000000);
+			blob_close_array(&blob, a);
+		}
+	}
+	blob_close_array(&blob, o);
+	const struct blob_field *array = blob_field_first_child(blob_head(&blob));
+
+	// the reference sums the values in a different order so allow some rounding
+	TEST(fabs(blob_field_sum(array, NULL) - sum) < 1e-6 * fabs(sum));
+	TEST(blob_field_min(array, NULL, &val) && val == min);
+	TEST(blob_field_max(array, NULL, &val) && val == max);
+	TEST(blob_field_mean(array, NULL, &val) && fabs(val - sum / VALUES) < 1e-6 * fabs(sum / VALUES));
+
+	// tables are aggregated by key
+	blob_reset(&blob);
+	o = blob_open_array(&blob);
+	for(int c = 0; c < VALUES; c++){
+		blob_offset_t t = blob_open_table(&blob);
+		blob_put_string(&blob, "id");
+		blob_put_int(&blob, c);
+		blob_put_string(&blob, "temp");
+		blob_put_real(&blob, (c % 100) * 0.5);
+		blob_close_table(&blob, t);
+	}
+	blob_close_array(&blob, o);
+	array = blob_field_first_child(blob_head(&blob));
+
+	TEST(blob_field_sum(array, "id") == (double)VALUES * (VALUES - 1) / 2);
+	TEST(blob_field_max(array, "temp", &val) && val == 49.5);
+	TEST(blob_field_min(array, "temp", &val) && val == 0);
+	TEST(blob_field_mean(array, "temp", &val) && val == 24.75);
+	TEST(!blob_field_mean(array, "missing", &val));
+	TEST(blob_field_sum(array, "missing") == 0);
+
+	uint32_t bins[10] = { 0 };
+	TEST(blob_field_histogram(array, "temp", 0, 49.5, bins, 10) == VALUES);
+	TEST(bins[0] == 1000 && bins[9] == 1000);
+	memset(bins, 0, sizeof(bins));
+	TEST(blob_field_histogram(array, "id", 0, 100, bins, 10) == 101);
+	TEST(bins[0] == 10 && bins[9] == 11);
+	TEST(blob_field_histogram(array, "id", 1, 1, bins, 10) == 0);
+
+	// columns give the same results
+	const struct blob_field *cols = blob_put_columns(&columns, array);
+	TEST(cols != NULL);
+	TEST(blob_field_sum(cols, "id") == (double)VALUES * (VALUES - 1) / 2);
+	TEST(blob_field_mean(cols, "temp", &val) && val == 24.75);
+	TEST(!blob_field_max(cols, NULL, &val));
+
+	// children that are not tables are skipped
+	blob_reset(&blob);
+	TEST(blob_put_json(&blob, "[{\"a\":1},2,{\"b\":2,\"a\":3.5},{\"a\":\"x\"}]"));
+	TEST(blob_field_sum(blob_field_first_child(blob_head(&blob)), "a") == 4.5);
+
+	// empty arrays have no min
+	blob_reset(&blob);
+	o = blob_open_array(&blob);
+	blob_close_array(&blob, o);
+	array = blob_field_first_child(blob_head(&blob));
+	TEST(blob_field_sum(array, NULL) == 0);
+	TEST(!blob_field_min(array, NULL, &val));
+
+	blob_free(&blob);
+	blob_free(&columns);
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+
+int main(void){
+	struct blob blob, copy;
+	uint8_t buf[4096];
+	blob_init(&blob, 0, 0);
+	blob_init(&copy, 0, 0);
+
+	// {"a": 1} as blobmsg_add_u32 would write it
+	blob_offset_t o = blob_open_table(&blob);
+	blob_put_string(&blob, "a");
+	blob_put_int(&blob, 1);
+	blob_close_table(&blob, o);
+	static const uint8_t small[] = {
+		0x00, 0x00, 0x00, 0x10,
+		0x85, 0x00, 0x00, 0x0c, 0x00, 0x01, 'a', 0x00, 0x00, 0x00, 0x00, 0x01
+	};
+	TEST(blob_to_blobmsg(blob_field_first_child(blob_head(&blob)), buf, sizeof(buf)) == sizeof(small));
+	TEST(memcmp(buf, small, sizeof(small)) == 0);
+	TEST(blob_to_blobmsg(blob_field_first_child(blob_head(&blob)), buf, sizeof(small) - 1) == 0);
+	TEST(blob_to_blobmsg(blob_head(&blob), buf, sizeof(buf)) == 0);
+
+	// bool, int16, double, unspec and an array with an int64 and a string
+	static const uint8_t msg[] = {
+		0x00, 0x00, 0x00, 0x58,
+		0x87, 0x00, 0x00, 0x09, 0x00, 0x01, 'b', 0x00, 0x01, 0x00, 0x00, 0x00,
+		0x86, 0x00, 0x00, 0x0a, 0x00, 0x01, 's', 0x00, 0x01, 0x2c, 0x00, 0x00,
+		0x88, 0x00, 0x00, 0x10, 0x00, 0x01, 'd', 0x00, 0x3f, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x80, 0x00, 0x00, 0x08, 0x00, 0x01, 'n', 0x00,
+		0x81, 0x00, 0x00, 0x24, 0x00, 0x01, 'l', 0x00,
+			0x84, 0x00, 0x00, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x2a, 0x05, 0xf2, 0x00,
+			0x83, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00, 0x00, 'x', 0x00, 0x00, 0x00
+	};
+	TEST(blob_from_blobmsg(&copy, msg, sizeof(msg)));
+	char *json = blob_field_to_json(blob_field_first_child(blob_head(&copy)));
+	printf("blobmsg: %s\n", json);
+	TEST(strcmp(json, "{\"b\":1,\"s\":300,\"d\":1.500000,\"n\":0,\"l\":[5000000000,\"x\"]}") == 0);
+	free(json);
+
+	// and back again, ints are written as int32 unless they need 64 bits
+	size_t len = blob_to_blobmsg(blob_field_first_child(blob_head(&copy)), buf, sizeof(buf));
+	TEST(len > 0);
+	blob_reset(&blob);
+	TEST(blob_from_blobmsg(&blob, buf, len));
+	TEST(blob_field_equal(blob_head(&blob), blob_head(&copy)));
+	TEST(buf[4] == 0x85);
+
+	// negative numbers, nested tables and tables with non string keys
+	blob_reset(&blob);
+	o = blob_open_table(&blob);
+	blob_put_string(&blob, "neg");
+	blob_put_int(&blob, -70000);
+	blob_put_string(&blob, "t");
+	blob_offset_t t = blob_open_table(&blob);
+	blob_put_string(&blob, "pi");
+	blob_put_real(&blob, 3.14159);
+	blob_close_table(&blob, t);
+	blob_put_string(&blob, "pairs");
+	t = blob_open_table(&blob);
+	blob_put_int(&blob, 1);
+	blob_put_int(&blob, 2);
+	blob_close_table(&blob, t);
+	blob_close_table(&blob, o);
+	len = blob_to_blobmsg(blob_field_first_child(blob_head(&blob)), buf, sizeof(buf));
+	TEST(len > 0);
+	blob_reset(&copy);
+	TEST(blob_from_blobmsg(&copy, buf, len));
+	json = blob_field_to_json(blob_field_first_child(blob_head(&copy)));
+	printf("blobmsg: %s\n", json);
+	TEST(strcmp(json, "{\"neg\":-70000,\"t\":{\"pi\":3.141590e+00},\"pairs\":[1,2]}") == 0);
+	free(json);
+
+	// columns are written as the array of tables they were built from
+	uint8_t expect[sizeof(buf)];
+	blob_reset(&copy);
+	TEST(blob_put_json(&copy, "[{\"id\":1,\"name\":\"a\",\"load\":0.5},{\"id\":300000,\"name\":\"\",\"load\":-2.25},{\"id\":-7,\"name\":\"c\",\"load\":1.75}]"));
+	const struct blob_field *rows = blob_field_first_child(blob_head(&copy));
+	blob_reset(&blob);
+	o = blob_open_table(&blob);
+	blob_put_string(&blob, "rows");
+	blob_put_attr(&blob, rows);
+	blob_close_table(&blob, o);
+	len = blob_to_blobmsg(blob_field_first_child(blob_head(&blob)), expect, sizeof(expect));
+	TEST(len > 0);
+	blob_reset(&blob);
+	o = blob_open_table(&blob);
+	blob_put_string(&blob, "rows");
+	TEST(blob_put_columns(&blob, rows));
+	blob_close_table(&blob, o);
+	TEST(blob_to_blobmsg(blob_field_first_child(blob_head(&blob)), buf, sizeof(buf)) == len);
+	TEST(memcmp(buf, expect, len) == 0);
+
+	// malformed messages
+	uint8_t bad[sizeof(msg)];
+	memcpy(bad, msg, sizeof(msg));
+	bad[7] = 0x0a;
+	TEST(!blob_from_blobmsg(&copy, bad, sizeof(bad)));
+	memcpy(bad, msg, sizeof(msg));
+	bad[3] = 0x60;
+	TEST(!blob_from_blobmsg(&copy, bad, sizeof(bad)));
+	memcpy(bad, msg, sizeof(msg));
+	bad[4] = 0x07;
+	TEST(!blob_from_blobmsg(&copy, bad, sizeof(bad)));
+	memcpy(bad, msg, sizeof(msg));
+	bad[11] = 'x';
+	TEST(!blob_from_blobmsg(&copy, bad, sizeof(bad)));
+	memcpy(bad, msg, sizeof(msg));
+	bad[4] = 0x8f;
+	TEST(!blob_from_blobmsg(&copy, bad, sizeof(bad)));
+	TEST(!blob_from_blobmsg(&copy, msg, 3));
+
+	blob_free(&blob);
+	blob_free(&copy);
+	return 0;
+}
@@ -0,0 +1,116 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+
+// an int stored wider than it needs to be, like other encoders may write it
+static void _put_int32(struct blob *blob, int32_t val){
+	struct blob_field *field = blob_reserve(blob, BLOB_FIELD_INT32, sizeof(val));
+	val = htobe32(val);
+	memcpy(field->data, &val, sizeof(val));
+}
+
+static void _put_double(struct blob *blob, double val){
+	struct blob_field *field = blob_reserve(blob, BLOB_FIELD_FLOAT64, 8);
+	// ieee 754 like blob_put_real writes it
+	uint64_t bits;
+	memcpy(&bits, &val, sizeof(bits));
+	bits = htobe64(bits);
+	memcpy(field->data, &bits, sizeof(bits));
+}
+
+static char *_canonical_json(struct blob *out, struct blob *in){
+	TEST(blob_canonicalize(out, in));
+	return blob_to_json(out);
+}
+
+int main(void){
+	struct blob a, b, ca, cb;
+	blob_init(&a, 0, 0);
+	blob_init(&b, 0, 0);
+	blob_init(&ca, 0, 0);
+	blob_init(&cb, 0, 0);
+
+	TEST(blob_put_json(&a, "{\"id\":1,\"name\":\"x\",\"load\":0.5,\"list\":[{\"b\":1,\"a\":2},3],\"dup\":1,\"dup\":2}"));
+
+	blob_offset_t o = blob_open_table(&b);
+	blob_put_string(&b, "list");
+	blob_offset_t l = blob_open_array(&b);
+	blob_offset_t t = blob_open_table(&b);
+	blob_put_string(&b, "a");
+	_put_int32(&b, 2);
+	blob_put_string(&b, "b");
+	blob_put_int(&b, 1);
+	blob_close_table(&b, t);
+	_put_int32(&b, 3);
+	blob_close_array(&b, l);
+	blob_put_string(&b, "dup");
+	blob_put_int(&b, 1);
+	blob_put_string(&b, "load");
+	_put_double(&b, 0.5);
+	blob_put_string(&b, "name");
+	blob_put_string(&b, "x");
+	blob_put_string(&b, "dup");
+	blob_put_int(&b, 2);
+	blob_put_string(&b, "id");
+	_put_int32(&b, 1);
+	blob_close_table(&b, o);
+
+	// same data, different bytes
+	TEST(!blob_field_equal(blob_head(&a), blob_head(&b)));
+	TEST(blob_field_hash64(blob_head(&a)) != blob_field_hash64(blob_head(&b)));
+
+	char *ja = _canonical_json(&ca, &a);
+	char *jb = _canonical_json(&cb, &b);
+	TEST(strcmp(ja, "[{\"dup\":1,\"dup\":2,\"id\":1,\"list\":[{\"a\":2,\"b\":1},3],\"load\":0.500000,\"name\":\"x\"}]") == 0);
+	TEST(strcmp(ja, jb) == 0);
+	free(ja);
+	free(jb);
+	TEST(blob_field_equal(blob_head(&ca), blob_head(&cb)));
+	TEST(blob_field_hash64(blob_head(&ca)) == blob_field_hash64(blob_head(&cb)));
+
+	// canonical blobs stay the same
+	TEST(blob_canonicalize(&a, &ca));
+	TEST(blob_field_equal(blob_head(&a), blob_head(&ca)));
+
+	// array order is data
+	blob_reset(&a);
+	blob_reset(&b);
+	TEST(blob_put_json(&a, "[1,2,3]"));
+	TEST(blob_put_json(&b, "[3,2,1]"));
+	TEST(blob_canonicalize(&ca, &a) && blob_canonicalize(&cb, &b));
+	TEST(blob_field_hash64(blob_head(&ca)) != blob_field_hash64(blob_head(&cb)));
+
+	// big tables are sorted as well
+	char key[16];
+	blob_reset(&a);
+	o = blob_open_table(&a);
+	for(int c = 99; c >= 0; c--){
+		snprintf(key, sizeof(key), "k%02d", c);
+		blob_put_string(&a, key);
+		blob_put_int(&a, c);
+	}
+	blob_close_table(&a, o);
+	TEST(blob_canonicalize(&ca, &a));
+	const struct blob_field *table = blob_field_first_child(blob_head(&ca)), *k, *v;
+	int next = 0;
+	bool sorted = true;
+	blob_field_for_each_kv(table, k, v){
+		sorted = sorted && blob_field_get_int(v) == next++;
+	}
+	TEST(sorted && next == 100);
+
+	// hashes depend on every byte
+	blob_reset(&a);
+	blob_reset(&b);
+	blob_put_string(&a, "hello world, this is a longer string");
+	blob_put_string(&b, "hello world, this is a longer strinG");
+	TEST(blob_field_hash64(blob_head(&a)) != blob_field_hash64(blob_head(&b)));
+	TEST(blob_field_hash64(blob_head(&a)) == blob_field_hash64(blob_head(&a)));
+
+	blob_free(&a);
+	blob_free(&b);
+	blob_free(&ca);
+	blob_free(&cb);
+	return 0;
+}
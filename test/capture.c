@@ -0,0 +1,108 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+static uint64_t _now(void){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+int main(void){
+	char path[] = "/tmp/blobpack-capture-XXXXXX";
+	int fd = mkstemp(path);
+	TEST(fd >= 0);
+	close(fd);
+
+	struct blob blob, copy;
+	blob_init(&blob, 0, 0);
+
+	// nothing is captured before the capture starts
+	TEST(blob_put_json(&blob, "{\"ignored\":1}"));
+
+	TEST(blob_capture_start(path));
+	TEST(!blob_capture_start(path));
+	for(int c = 0; c < 10; c++){
+		blob_reset(&blob);
+		TEST(blob_put_json(&blob, "{\"id\":1,\"name\":\"device\",\"values\":[1,2,3]}"));
+	}
+	blob_reset(&blob);
+	blob_offset_t o = blob_open_table(&blob);
+	blob_put_string(&blob, "id");
+	blob_put_int(&blob, 2);
+	blob_close_table(&blob, o);
+	blob_init(&copy, (const char*)blob_head(&blob), blob_size(&blob));
+	TEST(!blob_put_json(&blob, "{broken"));
+	usleep(20000);
+	TEST(blob_put_json(&blob, "[1,2]"));
+	blob_capture_stop();
+	TEST(blob_put_json(&blob, "{\"ignored\":2}"));
+
+	// the capture is a blob log of [kind, ns, input]
+	struct blob_log log;
+	TEST(blob_log_open(&log, path, BLOB_LOG_RDONLY));
+	TEST(log.records == 13);
+	uint64_t offset = 0;
+	const struct blob_field *record = blob_log_next(&log, &offset);
+	const struct blob_field *kind = blob_field_first_child(record);
+	TEST(blob_field_get_int(kind) == BLOB_CAPTURE_JSON);
+	const struct blob_field *input = blob_field_next_child(record, blob_field_next_child(record, kind));
+	TEST(strcmp(blob_field_get_string(input), "{\"id\":1,\"name\":\"device\",\"values\":[1,2,3]}") == 0);
+	for(int c = 0; c < 10; c++) record = blob_log_next(&log, &offset);
+	kind = blob_field_first_child(record);
+	TEST(blob_field_get_int(kind) == BLOB_CAPTURE_BLOB);
+	input = blob_field_next_child(record, blob_field_next_child(record, kind));
+	TEST(blob_field_equal(input, blob_head(&copy)));
+	blob_log_close(&log);
+
+	// replay as fast as possible
+	struct blob_replay_options options = { 0 };
+	struct blob_replay_result result;
+	TEST(blob_capture_replay(path, &options, &result));
+	TEST(result.records == 13);
+	TEST(result.failed == 1);
+	TEST(result.invalid == 0);
+	TEST(result.latency.count == 12);
+	TEST(result.bytes > 10 * 40);
+	TEST(result.elapsed_ns < 20000000);
+
+	// a signature that the array does not match and a policy of our own
+	struct blob_policy policy[] = {
+		{ .name = "id", .type = BLOB_FIELD_INT8 },
+		{ .name = "name", .type = BLOB_FIELD_STRING }
+	};
+	options.signature = "{sisssa}";
+	options.policy = policy;
+	options.policy_size = 2;
+	TEST(blob_capture_replay(path, &options, &result));
+	TEST(result.invalid == 1);
+
+	// the original pace keeps the pause before the last input
+	options = (struct blob_replay_options){ .flags = BLOB_REPLAY_TIMED };
+	uint64_t start = _now();
+	TEST(blob_capture_replay(path, &options, &result));
+	TEST(_now() - start >= 20000000);
+	TEST(result.elapsed_ns >= 20000000);
+
+	TEST(!blob_capture_replay("/nonexistent/capture", &options, &result));
+
+	// a new capture starts from an empty file and does not follow symlinks
+	TEST(blob_capture_start(path));
+	blob_capture_stop();
+	TEST(blob_log_open(&log, path, BLOB_LOG_RDONLY));
+	TEST(log.records == 0);
+	blob_log_close(&log);
+	char link[sizeof(path) + 5];
+	snprintf(link, sizeof(link), "%s-link", path);
+	TEST(symlink(path, link) == 0);
+	TEST(!blob_capture_start(link));
+	unlink(link);
+
+	unlink(path);
+	blob_free(&copy);
+	blob_free(&blob);
+	return 0;
+}
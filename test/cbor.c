@@ -0,0 +1,161 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <math.h>
+#include <string.h>
+#include <unistd.h>
+
+static bool _from_cbor(struct blob *blob, const void *data, size_t size){
+	blob_reset(blob);
+	return blob_put_cbor(blob, data, size);
+}
+
+static const struct blob_field *_root(struct blob *blob){
+	return blob_field_first_child(blob_head(blob));
+}
+
+static bool _failing_write(struct blob_sink *sink, const void *data, size_t size){
+	return false;
+}
+
+int main(void){
+	struct blob blob, copy;
+	struct blob_buffer_sink out;
+	blob_init(&blob, 0, 0);
+	blob_init(&copy, 0, 0);
+	blob_buffer_sink_init(&out);
+
+	blob_put_bool(&blob, true);
+	blob_put_string(&blob, "foo");
+	blob_put_int(&blob, -13);
+	blob_put_int(&blob, -1000);
+	blob_put_int(&blob, 40000);
+	blob_put_int(&blob, -5000000000ll);
+	blob_put_int(&blob, 5000000000ll);
+	blob_put_real(&blob, M_PI);
+	blob_put_real(&blob, 12.5);
+
+	blob_offset_t o = blob_open_table(&blob);
+	blob_put_string(&blob, "one");
+	blob_put_int(&blob, 1);
+	blob_put_string(&blob, "a string that is longer than twenty three bytes");
+	blob_offset_t a = blob_open_array(&blob);
+	for(int c = 0; c < 3000; c++) blob_put_int(&blob, c * 1000);
+	blob_close_array(&blob, a);
+	blob_close_table(&blob, o);
+
+	// round trip must reproduce exactly the same blob
+	TEST(blob_field_write_cbor(blob_head(&blob), &out.sink));
+	TEST((uint8_t)out.buf[0] == 0x9f && (uint8_t)out.buf[out.len - 1] == 0xff);
+	TEST(_from_cbor(&copy, out.buf, out.len));
+	TEST(blob_field_equal(_root(&copy), blob_head(&blob)));
+
+	// the same through a file descriptor
+	char path[] = "/tmp/blobpack-cbor-XXXXXX";
+	int fd = mkstemp(path);
+	TEST(fd >= 0);
+	struct blob_fd_sink file;
+	blob_fd_sink_init(&file, fd);
+	TEST(blob_field_write_cbor(blob_head(&blob), &file.sink));
+	TEST(lseek(fd, 0, SEEK_END) == (off_t)out.len);
+	close(fd);
+	unlink(path);
+
+	struct blob_sink failing = { .write = _failing_write };
+	TEST(!blob_field_write_cbor(blob_head(&blob), &failing));
+
+	// tables with non string keys are written as arrays so that they can be read back
+	blob_reset(&blob);
+	o = blob_open_table(&blob);
+	blob_put_int(&blob, 1);
+	blob_put_string(&blob, "one");
+	blob_put_real(&blob, 2.5);
+	blob_put_int(&blob, 2);
+	blob_close_table(&blob, o);
+	blob_buffer_sink_reset(&out);
+	TEST(blob_field_write_cbor(_root(&blob), &out.sink));
+	TEST((uint8_t)out.buf[0] == 0x9f);
+	TEST(_from_cbor(&copy, out.buf, out.len));
+	TEST(blob_field_type(_root(&copy)) == BLOB_FIELD_ARRAY);
+	blob_reset(&blob);
+	o = blob_open_array(&blob);
+	blob_put_int(&blob, 1);
+	blob_put_string(&blob, "one");
+	blob_put_real(&blob, 2.5);
+	blob_put_int(&blob, 2);
+	blob_close_array(&blob, o);
+	TEST(blob_field_equal(_root(&copy), _root(&blob)));
+
+	// columns are written as the array of maps they were built from
+	struct blob_buffer_sink rows;
+	blob_buffer_sink_init(&rows);
+	blob_reset(&copy);
+	TEST(blob_put_json(&copy, "[{\"id\":1,\"name\":\"a\",\"load\":0.5},{\"id\":300000,\"name\":\"\",\"load\":-2.25},{\"id\":-7,\"name\":\"c\",\"load\":1.75}]"));
+	TEST(blob_field_write_cbor(_root(&copy), &rows.sink));
+	blob_reset(&blob);
+	TEST(blob_put_columns(&blob, _root(&copy)));
+	blob_buffer_sink_reset(&out);
+	TEST(blob_field_write_cbor(_root(&blob), &out.sink));
+	TEST(out.len == rows.len && memcmp(out.buf, rows.buf, rows.len) == 0);
+	blob_buffer_sink_free(&rows);
+
+	// examples from rfc 8949
+	static const uint8_t half[] = { 0xf9, 0x7b, 0xff };
+	TEST(_from_cbor(&copy, half, sizeof(half)));
+	TEST(blob_field_get_real(_root(&copy)) == 65504.0);
+	static const uint8_t subnormal[] = { 0xf9, 0x00, 0x01 };
+	TEST(_from_cbor(&copy, subnormal, sizeof(subnormal)));
+	TEST(blob_field_get_real(_root(&copy)) == ldexp(1, -24));
+	static const uint8_t negative[] = { 0x39, 0x03, 0xe7 };
+	TEST(_from_cbor(&copy, negative, sizeof(negative)));
+	TEST(blob_field_get_int(_root(&copy)) == -1000);
+	static const uint8_t tagged[] = { 0xc1, 0x1a, 0x51, 0x4b, 0x67, 0xb0 };
+	TEST(_from_cbor(&copy, tagged, sizeof(tagged)));
+	TEST(blob_field_get_int(_root(&copy)) == 1363896240);
+	static const uint8_t chunked[] = { 0x7f, 0x65, 's', 't', 'r', 'e', 'a', 0x64, 'm', 'i', 'n', 'g', 0xff };
+	TEST(_from_cbor(&copy, chunked, sizeof(chunked)));
+	TEST(strcmp(blob_field_get_string(_root(&copy)), "streaming") == 0);
+	static const uint8_t map[] = { 0xbf, 0x61, 'a', 0x01, 0x61, 'b', 0x9f, 0x02, 0x03, 0xff, 0x61, 'c', 0x5f, 0x41, 0x01, 0x42, 0x02, 0x03, 0xff, 0xff };
+	TEST(_from_cbor(&copy, map, sizeof(map)));
+	char *json = blob_field_to_json(_root(&copy));
+	TEST(strcmp(json, "{\"a\":1,\"b\":[2,3],\"c\":[1,2,3]}") == 0);
+	free(json);
+	static const uint8_t simple[] = { 0x84, 0xf4, 0xf5, 0xf6, 0xf7 };
+	TEST(_from_cbor(&copy, simple, sizeof(simple)));
+	json = blob_field_to_json(_root(&copy));
+	TEST(strcmp(json, "[0,1,0,0]") == 0);
+	free(json);
+
+	// invalid input
+	static const uint8_t too_big[] = { 0x1b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	static const uint8_t truncated[] = { 0x83, 0x01, 0x02 };
+	static const uint8_t unterminated[] = { 0x9f, 0x01, 0x02 };
+	static const uint8_t stray_break[] = { 0x82, 0x01, 0xff };
+	static const uint8_t int_key[] = { 0xa1, 0x01, 0x02 };
+	static const uint8_t mixed_chunks[] = { 0x7f, 0x41, 'a', 0xff };
+	static const uint8_t null_byte[] = { 0x62, 'a', 0x00 };
+	static const uint8_t reserved[] = { 0x1c };
+	static const uint8_t huge[] = { 0x9b, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x01 };
+	static const uint8_t trailing[] = { 0x01, 0x02 };
+	TEST(!_from_cbor(&copy, too_big, sizeof(too_big)));
+	TEST(!_from_cbor(&copy, truncated, sizeof(truncated)));
+	TEST(!_from_cbor(&copy, unterminated, sizeof(unterminated)));
+	TEST(!_from_cbor(&copy, stray_break, sizeof(stray_break)));
+	TEST(!_from_cbor(&copy, int_key, sizeof(int_key)));
+	TEST(!_from_cbor(&copy, mixed_chunks, sizeof(mixed_chunks)));
+	TEST(!_from_cbor(&copy, null_byte, sizeof(null_byte)));
+	TEST(!_from_cbor(&copy, reserved, sizeof(reserved)));
+	TEST(!_from_cbor(&copy, huge, sizeof(huge)));
+	TEST(!_from_cbor(&copy, trailing, sizeof(trailing)));
+
+	uint8_t deep[BLOB_CBOR_MAX_DEPTH + 2];
+	memset(deep, 0x81, sizeof(deep));
+	deep[sizeof(deep) - 1] = 0x01;
+	TEST(!_from_cbor(&copy, deep, sizeof(deep)));
+	TEST(_from_cbor(&copy, deep + 1, sizeof(deep) - 1));
+
+	blob_buffer_sink_free(&out);
+	blob_free(&blob);
+	blob_free(&copy);
+	return 0;
+}
@@ -0,0 +1,126 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+
+#define ROWS 1000
+
+static void _fill(struct blob *blob, int rows){
+	char name[32];
+	blob_reset(blob);
+	for(int c = 0; c < rows; c++){
+		blob_offset_t o = blob_open_table(blob);
+		blob_put_string(blob, "id");
+		blob_put_int(blob, c * 100);
+		blob_put_string(blob, "level");
+		blob_put_int(blob, (c % 7) - 3);
+		blob_put_string(blob, "temp");
+		blob_put_real(blob, c + 0.1);
+		blob_put_string(blob, "load");
+		blob_put_real(blob, c * 0.25);
+		blob_put_string(blob, "name");
+		snprintf(name, sizeof(name), "device %d", c);
+		blob_put_string(blob, (c % 10) ? name : "");
+		blob_close_table(blob, o);
+	}
+}
+
+static bool _put_json(struct blob *rows, struct blob *columns, const char *json){
+	blob_reset(rows);
+	blob_reset(columns);
+	TEST(blob_put_json(rows, json));
+	return blob_put_columns(columns, blob_field_first_child(blob_head(rows))) != NULL;
+}
+
+int main(void){
+	struct blob rows, columns;
+	struct blob_column column;
+	blob_init(&rows, 0, 0);
+	blob_init(&columns, 0, 0);
+
+	_fill(&rows, ROWS);
+	const struct blob_field *field = blob_put_columns(&columns, blob_head(&rows));
+	TEST(field && blob_field_type(field) == BLOB_FIELD_COLUMNS);
+	TEST(blob_columns_rows(field) == ROWS);
+	TEST(blob_size(&columns) * 3 < blob_size(&rows));
+
+	// every column gets the smallest type that holds all of its values
+	TEST(blob_columns_find(field, "id", &column) && column.type == BLOB_FIELD_INT32);
+	TEST(blob_columns_find(field, "level", &column) && column.type == BLOB_FIELD_INT8);
+	TEST(blob_columns_find(field, "temp", &column) && column.type == BLOB_FIELD_FLOAT64);
+	TEST(blob_columns_find(field, "load", &column) && column.type == BLOB_FIELD_FLOAT32);
+	TEST(blob_columns_find(field, "name", &column) && column.type == BLOB_FIELD_STRING);
+	TEST(!blob_columns_find(field, "missing", &column));
+
+	// the row view gives back the same keys and values as the tables
+	bool same = true;
+	uint32_t row = 0;
+	const struct blob_field *table, *key, *value, *ckey;
+	blob_field_for_each_child(blob_head(&rows), table){
+		key = blob_field_first_child(table);
+		blob_columns_for_each_kv(field, ckey, column){
+			value = blob_field_next_child(table, key);
+			same = same && strcmp(blob_field_get_string(key), blob_field_get_string(ckey)) == 0;
+			if(column.type == BLOB_FIELD_STRING)
+				same = same && strcmp(blob_column_get_string(&column, row), blob_field_get_string(value)) == 0;
+			else if(column.type == BLOB_FIELD_FLOAT32 || column.type == BLOB_FIELD_FLOAT64)
+				same = same && blob_column_get_real(&column, row) == blob_field_get_real(value);
+			else
+				same = same && blob_column_get_int(&column, row) == blob_field_get_int(value);
+			key = blob_field_next_child(table, value);
+		}
+		row++;
+	}
+	TEST(same);
+	TEST(row == ROWS);
+	TEST(blob_columns_find(field, "level", &column) && blob_column_get_int(&column, 0) == -3);
+	TEST(blob_column_get_int(&column, ROWS) == 0);
+	TEST(blob_column_get_string(&column, 0) == NULL);
+
+	// reals that do not fit a long long read as 0 from get_int
+	static const double reals[] = { 1e300, -1e300, NAN, 2.75, -2.75 };
+	static const long long ints[] = { 0, 0, 0, 2, -2 };
+	blob_reset(&rows);
+	blob_reset(&columns);
+	for(size_t c = 0; c < sizeof(reals) / sizeof(reals[0]); c++){
+		blob_offset_t o = blob_open_table(&rows);
+		blob_put_string(&rows, "v");
+		blob_put_real(&rows, reals[c]);
+		blob_close_table(&rows, o);
+	}
+	field = blob_put_columns(&columns, blob_head(&rows));
+	TEST(field && blob_columns_find(field, "v", &column) && column.type == BLOB_FIELD_FLOAT64);
+	for(uint32_t c = 0; c < sizeof(reals) / sizeof(reals[0]); c++){
+		TEST(blob_column_get_int(&column, c) == ints[c]);
+	}
+	TEST(isnan(blob_column_get_real(&column, 2)));
+
+	// json output is the array of objects the columns were built from
+	TEST(_put_json(&rows, &columns, "[{\"id\":1,\"name\":\"a\\\"b\",\"load\":0.500000},{\"id\":300,\"name\":\"\",\"load\":2.250000}]"));
+	field = blob_field_first_child(blob_head(&columns));
+	char *a = blob_field_to_json(blob_field_first_child(blob_head(&rows)));
+	char *b = blob_field_to_json(field);
+	TEST(strcmp(a, b) == 0);
+	TEST(strcmp(b, "[{\"id\":1,\"name\":\"a\\\"b\",\"load\":0.500000},{\"id\":300,\"name\":\"\",\"load\":2.250000}]") == 0);
+	free(a);
+	free(b);
+
+	// rows that do not share the same shape are refused without touching the buffer
+	TEST(!_put_json(&rows, &columns, "[{\"a\":1,\"b\":2},{\"b\":2,\"a\":1}]"));
+	TEST(blob_field_first_child(blob_head(&columns)) == NULL);
+	TEST(!_put_json(&rows, &columns, "[{\"a\":1,\"b\":2},{\"a\":1}]"));
+	TEST(!_put_json(&rows, &columns, "[{\"a\":1},{\"a\":1,\"b\":2}]"));
+	TEST(!_put_json(&rows, &columns, "[{\"a\":1},{\"a\":\"x\"}]"));
+	TEST(!_put_json(&rows, &columns, "[{\"a\":1},{\"a\":1.5}]"));
+	TEST(!_put_json(&rows, &columns, "[{\"a\":1.5},{\"a\":1}]"));
+	TEST(!_put_json(&rows, &columns, "[{\"a\":[1]}]"));
+	TEST(!_put_json(&rows, &columns, "[{\"a\":1},2]"));
+	TEST(!_put_json(&rows, &columns, "[{}]"));
+	TEST(!_put_json(&rows, &columns, "[]"));
+	TEST(blob_field_first_child(blob_head(&columns)) == NULL);
+
+	blob_free(&rows);
+	blob_free(&columns);
+	return 0;
+}
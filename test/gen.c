@@ -0,0 +1,136 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+
+struct shape_check {
+	uint32_t depth;
+	uint32_t containers;
+	uint32_t tables;
+	uint32_t ints[4];
+	uint32_t reals;
+	uint32_t strings;
+	uint32_t min_key_len, max_key_len;
+	uint32_t min_string_len, max_string_len;
+	uint32_t min_fanout, max_fanout;
+};
+
+static void _check(struct shape_check *self, const struct blob_field *container, uint32_t level){
+	const struct blob_field *child;
+	bool table = blob_field_type(container) == BLOB_FIELD_TABLE;
+	uint32_t children = 0;
+	bool key = table;
+	if(level > self->depth) self->depth = level;
+	self->containers++;
+	if(table) self->tables++;
+	blob_field_for_each_child(container, child){
+		int type = blob_field_type(child);
+		if(key){
+			uint32_t len = strlen(blob_field_get_string(child));
+			if(len < self->min_key_len) self->min_key_len = len;
+			if(len > self->max_key_len) self->max_key_len = len;
+			key = false;
+			continue;
+		}
+		key = table;
+		children++;
+		if(type == BLOB_FIELD_TABLE || type == BLOB_FIELD_ARRAY) _check(self, child, level + 1);
+		else if(type == BLOB_FIELD_INT8) self->ints[0]++;
+		else if(type == BLOB_FIELD_INT16) self->ints[1]++;
+		else if(type == BLOB_FIELD_INT32) self->ints[2]++;
+		else if(type == BLOB_FIELD_INT64) self->ints[3]++;
+		else if(type == BLOB_FIELD_FLOAT32 || type == BLOB_FIELD_FLOAT64) self->reals++;
+		else if(type == BLOB_FIELD_STRING){
+			uint32_t len = strlen(blob_field_get_string(child));
+			if(len < self->min_string_len) self->min_string_len = len;
+			if(len > self->max_string_len) self->max_string_len = len;
+			self->strings++;
+		}
+	}
+	if(children < self->min_fanout) self->min_fanout = children;
+	if(children > self->max_fanout) self->max_fanout = children;
+}
+
+static struct shape_check _generate(struct blob *blob, const struct blob_gen_shape *shape, uint64_t seed, int docs){
+	struct blob_gen gen;
+	struct shape_check check;
+	memset(&check, 0, sizeof(check));
+	check.min_key_len = check.min_string_len = check.min_fanout = UINT32_MAX;
+	blob_gen_init(&gen, shape, seed);
+	blob_reset(blob);
+	for(int c = 0; c < docs; c++) TEST(blob_gen_put(&gen, blob));
+	const struct blob_field *doc;
+	blob_field_for_each_child(blob_head(blob), doc) _check(&check, doc, 0);
+	return check;
+}
+
+int main(void){
+	struct blob a, b;
+	struct blob_gen_shape shape;
+	blob_init(&a, 0, 0);
+	blob_init(&b, 0, 0);
+
+	// the same seed gives the same documents, another seed other documents
+	blob_gen_shape_default(&shape);
+	_generate(&a, &shape, 42, 100);
+	_generate(&b, &shape, 42, 100);
+	TEST(blob_size(&a) == blob_size(&b) && memcmp(blob_head(&a), blob_head(&b), blob_size(&a)) == 0);
+	_generate(&b, &shape, 43, 100);
+	TEST(!blob_field_equal(blob_head(&a), blob_head(&b)));
+	TEST(blob_field_validate(blob_head(&a), "t"));
+
+	// the shape is followed
+	shape = (struct blob_gen_shape){
+		.depth = 2,
+		.fanout = { .min = 3, .max = 5 },
+		.container_share = 0.5,
+		.table_share = 1,
+		.key_len = { .min = 4, .max = 8 },
+		.int_weights = { 0, 1, 0, 1 },
+		.string_len = { .min = 10, .max = 1000, .log = true },
+		.float_share = 0.25,
+		.string_share = 0.25
+	};
+	struct shape_check check = _generate(&a, &shape, 1, 200);
+	TEST(check.depth == 2);
+	TEST(check.tables == check.containers);
+	TEST(check.min_fanout == 3 && check.max_fanout == 5);
+	TEST(check.min_key_len == 4 && check.max_key_len == 8);
+	TEST(check.min_string_len >= 10 && check.max_string_len <= 1000);
+	TEST(check.ints[0] == 0 && check.ints[2] == 0 && check.ints[1] > 0 && check.ints[3] > 0);
+	uint32_t values = check.ints[1] + check.ints[3] + check.reals + check.strings;
+	TEST(check.reals > values / 5 && check.reals < values * 3 / 10);
+	TEST(check.strings > values / 5 && check.strings < values * 3 / 10);
+
+	// with a log distribution most strings are short
+	uint32_t lens[2] = { 0, 0 };
+	const struct blob_field *doc, *child;
+	blob_field_for_each_child(blob_head(&a), doc){
+		blob_field_for_each_child(doc, child){
+			if(blob_field_type(child) == BLOB_FIELD_STRING) lens[strlen(blob_field_get_string(child)) >= 100]++;
+		}
+	}
+	TEST(lens[0] > lens[1]);
+
+	// flat arrays of reals
+	shape.depth = 0;
+	shape.table_share = 0;
+	shape.float_share = 1;
+	check = _generate(&a, &shape, 1, 10);
+	TEST(check.depth == 0 && check.tables == 0 && check.containers == 10);
+	TEST(check.reals >= 30 && check.strings == 0);
+
+	// a fixed buffer that is too small is reported
+	char small[64];
+	struct blob fixed;
+	struct blob_gen gen;
+	blob_gen_shape_default(&shape);
+	shape.fanout.min = 50;
+	blob_init_fixed(&fixed, small, sizeof(small));
+	blob_gen_init(&gen, &shape, 1);
+	TEST(!blob_gen_put(&gen, &fixed));
+
+	blob_free(&a);
+	blob_free(&b);
+	return 0;
+}
@@ -0,0 +1,193 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define MESSAGES 2000
+
+struct peer {
+	int received;
+	int closed;
+	int error;
+	bool ordered;
+};
+
+static void _echo(struct blob_io_conn *conn, struct blob *blob){
+	blob_io_send(conn, blob);
+}
+
+static void _count(struct blob_io_conn *conn, struct blob *blob){
+	struct peer *peer = blob_io_conn_user(conn);
+	const struct blob_field *first = blob_field_first_child(blob_head(blob));
+	peer->ordered = peer->ordered && first && blob_field_get_int(first) == peer->received;
+	peer->received++;
+}
+
+static void _closed(struct blob_io_conn *conn, int error){
+	struct peer *peer = blob_io_conn_user(conn);
+	peer->closed++;
+	peer->error = error;
+}
+
+static const struct blob_io_ops echo_ops = { .on_blob = _echo, .on_close = _closed };
+static const struct blob_io_ops count_ops = { .on_blob = _count, .on_close = _closed };
+
+static void _fill(struct blob *blob, int n){
+	blob_reset(blob);
+	blob_put_int(blob, n);
+	blob_put_string(blob, "message");
+	// every hundredth message is bigger than the pooled blobs
+	blob_offset_t o = blob_open_array(blob);
+	for(int c = 0; c < ((n % 100) ? n % 17 : 5000); c++) blob_put_int(blob, c);
+	blob_close_array(blob, o);
+}
+
+static void _run_until(struct blob_io *io, const int *value, int expected){
+	for(int c = 0; c < 10000 && *value < expected; c++) TEST(blob_io_run(io, 1000) >= 0);
+}
+
+static void _accepted(struct blob_io *io, int fd, void *user){
+	TEST(fcntl(fd, F_GETFD) & FD_CLOEXEC);
+	TEST(blob_io_add(io, fd, &echo_ops, user) != NULL);
+}
+
+static void _test(unsigned int flags){
+	struct blob_io io;
+	struct blob blob;
+	int fds[2];
+	TEST(blob_io_init(&io, 256, flags));
+	TEST(!(flags & BLOB_IO_EPOLL) || (io.flags & BLOB_IO_EPOLL));
+
+	// everything sent through the echo comes back in order
+	struct peer server = { 0 }, client = { .ordered = true };
+	TEST(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	TEST(blob_io_add(&io, fds[0], &echo_ops, &server));
+	struct blob_io_conn *conn = blob_io_add(&io, fds[1], &count_ops, &client);
+	TEST(conn);
+	for(int c = 0; c < MESSAGES; c++){
+		TEST(blob_io_alloc(&io, &blob));
+		_fill(&blob, c);
+		TEST(blob_io_send(conn, &blob));
+		TEST(blob.buf == NULL);
+		// give the loop a turn now and then so that both directions are busy at once
+		if(c % 64 == 0){
+			TEST(blob_io_run(&io, 0) >= 0);
+		}
+	}
+	_run_until(&io, &client.received, MESSAGES);
+	TEST(client.received == MESSAGES);
+	TEST(client.ordered);
+
+	// the peer going away closes the connection
+	blob_io_close(conn);
+	TEST(!blob_io_send(conn, &blob));
+	_run_until(&io, &server.closed, 1);
+	TEST(client.closed == 1 && client.error == 0);
+	TEST(server.closed == 1 && server.error == 0);
+
+	// frames are put together from whatever pieces they arrive in
+	client = (struct peer){ .ordered = true };
+	TEST(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	TEST(blob_io_add(&io, fds[0], &count_ops, &client));
+	static char data[64 * 1024];
+	size_t size = 0;
+	blob_init(&blob, 0, 0);
+	for(int c = 0; c < 3; c++){
+		_fill(&blob, c);
+		memcpy(data + size, blob_head(&blob), blob_size(&blob));
+		size += blob_size(&blob);
+	}
+	blob_free(&blob);
+	size_t split = size - 5;
+	TEST(write(fds[1], data, split) == (ssize_t)split);
+	_run_until(&io, &client.received, 2);
+	TEST(blob_io_run(&io, 10) >= 0);
+	TEST(client.received == 2);
+	TEST(write(fds[1], data + split, size - split) == (ssize_t)(size - split));
+	_run_until(&io, &client.received, 3);
+	TEST(client.received == 3 && client.ordered);
+
+	// a frame that is shorter than its own header is refused
+	TEST(write(fds[1], "\0\0\0\0", 4) == 4);
+	_run_until(&io, &client.closed, 1);
+	TEST(client.closed == 1 && client.error == EPROTO);
+	close(fds[1]);
+
+	// writing to a socket whose peer is gone closes the connection instead of raising SIGPIPE
+	client = (struct peer){ 0 };
+	TEST(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) == 0);
+	conn = blob_io_add(&io, fds[0], &count_ops, &client);
+	TEST(conn);
+	close(fds[1]);
+	TEST(blob_io_alloc(&io, &blob));
+	_fill(&blob, 0);
+	TEST(blob_io_send(conn, &blob));
+	_run_until(&io, &client.closed, 1);
+	TEST(client.closed == 1);
+
+	// connections accepted from a listening socket
+	struct sockaddr_un addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "/tmp/blobpack-io-%d", (int)getpid());
+	unlink(addr.sun_path);
+	int sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	TEST(bind(sock, (struct sockaddr*)&addr, sizeof(addr)) == 0 && listen(sock, 16) == 0);
+	server = (struct peer){ 0 };
+	TEST(blob_io_listen(&io, sock, _accepted, &server));
+
+	client = (struct peer){ .ordered = true };
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	TEST(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+	conn = blob_io_add(&io, fd, &count_ops, &client);
+	for(int c = 0; c < 10; c++){
+		TEST(blob_io_alloc(&io, &blob));
+		_fill(&blob, c);
+		TEST(blob_io_send(conn, &blob));
+	}
+	_run_until(&io, &client.received, 10);
+	TEST(client.received == 10 && client.ordered);
+
+	// a listener that runs out of fds rests instead of spinning on the connection it can not take
+	struct peer late = { .ordered = true };
+	struct rlimit limit, low;
+	TEST(getrlimit(RLIMIT_NOFILE, &limit) == 0);
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	int spare = dup(0);
+	close(spare);
+	low = (struct rlimit){ .rlim_cur = (rlim_t)spare, .rlim_max = limit.rlim_max };
+	TEST(setrlimit(RLIMIT_NOFILE, &low) == 0);
+	TEST(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0);
+	// the failed accept and whatever else is left over come first
+	for(int c = 0; c < 10 && blob_io_run(&io, 20) > 0; c++){}
+	TEST(blob_io_run(&io, 20) == 0);
+	TEST(blob_io_run(&io, 20) == 0);
+	// and takes the connection once fds are available again
+	TEST(setrlimit(RLIMIT_NOFILE, &limit) == 0);
+	conn = blob_io_add(&io, fd, &count_ops, &late);
+	TEST(conn);
+	TEST(blob_io_alloc(&io, &blob));
+	_fill(&blob, 0);
+	TEST(blob_io_send(conn, &blob));
+	_run_until(&io, &late.received, 1);
+	TEST(late.received == 1 && late.ordered);
+	unlink(addr.sun_path);
+
+	// open connections are closed with the loop
+	blob_io_free(&io);
+	TEST(client.closed == 1 && client.error == ECANCELED);
+	TEST(late.closed == 1 && late.error == ECANCELED);
+	TEST(server.closed == 2 && server.error == ECANCELED);
+}
+
+int main(void){
+	_test(0);
+	_test(BLOB_IO_EPOLL);
+	return 0;
+}
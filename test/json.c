@@ -3,6 +3,17 @@
 #include <stdbool.h>
 #include <math.h>
 #include <memory.h>
+#include <unistd.h>
+
+// runs the value through the plain decoder and, padded to 64 bytes, through the indexed one.
+// With skip set it is left out by a projection, otherwise it is decoded.
+static bool _put_member(struct blob *blob, const char *value, bool padded, bool skip){
+	static const char *const paths[] = { "id", NULL };
+	char json[256];
+	snprintf(json, sizeof(json), "{\"id\": 7, \"pad\": \"%s\", \"skipped\": %s}", padded ? "................................................................" : "", value);
+	blob_reset(blob);
+	return skip ? blob_put_json_projected(blob, json, paths) : blob_put_json(blob, json);
+}
 
 int main(void){
 	struct blob blob; 
@@ -51,7 +62,131 @@ int main(void){
 	free(json); 
 	free(json2); 
 
-	blob_free(&blob); 
+	// long enough to be decoded through the structural index
+	struct blob b3; 
+	blob_init(&b3, 0, 0); 
+	TEST(blob_put_json(&b3, "{\"key with a \\\"quote\\\" and enough padding to cross a block boundary\": [1, 2, 300000, true, false, null, 2.5], \"nested\": {\"arr\": [], \"obj\": {}}, \"tail\": \"line\\nbreak \\\\\\\\\"}")); 
+	char *json3 = blob_to_json(&b3); 
+	TEST(strcmp(json3, "[{\"key with a \\\"quote\\\" and enough padding to cross a block boundary\":[1,2,300000,1,0,0,2.500000],\"nested\":{\"arr\":[],\"obj\":{}},\"tail\":\"line\\nbreak \\\\\\\\\"}]") == 0); 
+	free(json3); 
+
+	blob_reset(&b3); 
+	TEST(!blob_put_json(&b3, "[1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20 21]")); 
+	blob_reset(&b3); 
+	TEST(!blob_put_json(&b3, "{\"unterminated string that is long enough for the index\": \"value}")); 
+	blob_reset(&b3); 
+	TEST(!blob_put_json(&b3, "{\"trailing\": \"data after the object that is long enough\"} x"));
+
+	// numbers must decode to exactly what strtod returns
+	static const char *numbers[] = { "0.1", "-2.5e-3", "1e23", "9007199254740993.0", "2.2250738585072014e-308", "1.7976931348623157e308", "123456789.123456789e3", "12345678901234567", NULL };
+	for(int c = 0; numbers[c]; c++){
+		char doc[64];
+		snprintf(doc, sizeof(doc), "[%s]", numbers[c]);
+		blob_reset(&b3);
+		TEST(blob_put_json(&b3, doc));
+		const struct blob_field *n = blob_field_first_child(blob_field_first_child(blob_head(&b3)));
+		if(blob_field_type(n) == BLOB_FIELD_INT64) {
+			TEST(blob_field_get_int(n) == strtoll(numbers[c], NULL, 10));
+		} else {
+			TEST(blob_field_get_real(n) == strtod(numbers[c], NULL));
+		}
+	}
+	blob_free(&b3);
+
+	// round trip through a file larger than the stream buffer and the old 1MB limit
+	char path[] = "/tmp/blobpack-json-XXXXXX";
+	int fd = mkstemp(path);
+	TEST(fd >= 0);
+	close(fd);
+
+	struct blob big;
+	blob_init(&big, 0, 0);
+	o = blob_open_table(&big);
+	for(int c = 0; c < 60000; c++){
+		char key[32];
+		snprintf(key, sizeof(key), "key-%d", c);
+		blob_put_string(&big, key);
+		blob_put_string(&big, "a string value with \"quotes\" and \\ escapes");
+	}
+	blob_close_table(&big, o);
+	TEST(blob_write_json_to_file(&big, path));
+
+	struct blob big2;
+	blob_init(&big2, 0, 0);
+	TEST(blob_put_json_from_file(&big2, path));
+	char *big_json = blob_to_json(&big);
+	char *big_json2 = blob_field_to_json(blob_field_first_child(blob_head(&big2)));
+	TEST(strlen(big_json) > 1000000);
+	TEST(strcmp(big_json, big_json2) == 0);
+	free(big_json);
+	free(big_json2);
+	blob_free(&big);
+	blob_free(&big2);
+	unlink(path);
+
+	// projection keeps only members on the requested paths
+	const char *paths[] = { "id", "data.amount", "data.customer.email", NULL };
+	struct blob proj;
+	blob_init(&proj, 0, 0);
+	TEST(blob_put_json_projected(&proj, "{\"id\": 7, \"skipped\": {\"deep\": [1, \"two\\\"\", {\"three\": 3}]}, \"data\": {\"amount\": 12.5, \"note\": \"x\", \"customer\": {\"email\": \"a@b.c\", \"name\": \"n\"}}}", paths));
+	char *proj_json = blob_to_json(&proj);
+	TEST(strcmp(proj_json, "[{\"id\":7,\"data\":{\"amount\":12.500000,\"customer\":{\"email\":\"a@b.c\"}}}]") == 0);
+	free(proj_json);
+	blob_reset(&proj);
+	TEST(!blob_put_json_projected(&proj, "{\"id\": 7, \"skipped\": [1, 2}", paths));
+
+	// skipping a value accepts exactly what decoding it does, loose numbers included
+	static const char *const valid[] = { "[1, {\"a\": false}, -2.5e3, null, true]", "{\"a\": [], \"b\": {},}", "\"x\"", "0",
+		"-", "1.", "1.e5", "-0.5E+2", "[1. , -]", "18446744073709551615", "-9223372036854775808",
+		"\"\\u00e9\\ud83d\\ude00\\n\"", "\"\xc3\xa9\"", "\"\\ud800x\"", NULL };
+	static const char *const invalid[] = { "\\alse", "[1,,2]", "[1:2]", "falsy", "tru", "nul", "1x", "1 x", "-x", "1e", "1e+", "-.", ".5",
+		"[1 2]", "[1,]", "{\"a\" 1}", "{\"a\": 1 \"b\": 2}", "{1: 2}", "{\"a\",}", "[\"a\": 1]", "]",
+		"18446744073709551616", "-9223372036854775809", "123456789012345678901234.5", "1e400", "\"\\x\"", "\"\\u12\"", "\"\xf8\"",
+		"\"\xc3(\"", "\"\xc0\x80\"", NULL };
+	for(int padded = 0; padded < 2; padded++){
+		for(int c = 0; valid[c]; c++) {
+			TEST(_put_member(&proj, valid[c], padded, false));
+			TEST(_put_member(&proj, valid[c], padded, true));
+		}
+		for(int c = 0; invalid[c]; c++) {
+			TEST(!_put_member(&proj, invalid[c], padded, false));
+			TEST(!_put_member(&proj, invalid[c], padded, true));
+		}
+	}
+	blob_free(&proj);
+
+	// parallel export must produce exactly the same bytes as the serial one
+	struct blob arr;
+	blob_init(&arr, 0, 0);
+	o = blob_open_array(&arr);
+	for(int c = 0; c < 5000; c++){
+		switch(c % 5){
+			case 0: blob_put_int(&arr, c * 1000003LL); break;
+			case 1: blob_put_string(&arr, "text \"with\" escapes\n"); break;
+			case 2: blob_put_real(&arr, c / 7.0); break;
+			case 3: {
+				blob_offset_t t = blob_open_table(&arr);
+				blob_put_string(&arr, "k");
+				blob_put_int(&arr, c);
+				blob_close_table(&arr, t);
+				break;
+			}
+			case 4: blob_close_array(&arr, blob_open_array(&arr)); break;
+		}
+	}
+	blob_close_array(&arr, o);
+	const struct blob_field *arr_field = blob_field_first_child(blob_head(&arr));
+	char *serial = blob_field_to_json(arr_field);
+	char *parallel = blob_field_to_json_parallel(arr_field, 4);
+	TEST(strcmp(serial, parallel) == 0);
+	free(parallel);
+	parallel = blob_field_to_json_parallel(arr_field, 7);
+	TEST(strcmp(serial, parallel) == 0);
+	free(parallel);
+	free(serial);
+	blob_free(&arr);
+
+	blob_free(&blob);
 
 	return 0; 
 }
@@ -0,0 +1,119 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#define RECORDS 1000
+
+static void _fill(struct blob *blob, int n){
+	char name[32];
+	blob_reset(blob);
+	blob_put_int(blob, n);
+	snprintf(name, sizeof(name), "record %d", n);
+	blob_put_string(blob, name);
+	blob_offset_t o = blob_open_array(blob);
+	for(int c = 0; c < n % 17; c++) blob_put_int(blob, c);
+	blob_close_array(blob, o);
+}
+
+static off_t _file_size(const char *path){
+	struct stat st;
+	return stat(path, &st) == 0 ? st.st_size : -1;
+}
+
+int main(void){
+	char path[] = "/tmp/blobpack-log-XXXXXX";
+	int fd = mkstemp(path);
+	TEST(fd >= 0);
+	close(fd);
+
+	struct blob blob;
+	struct blob_log log;
+	uint64_t offsets[RECORDS];
+	blob_init(&blob, 0, 0);
+
+	TEST(blob_log_open(&log, path, 0));
+	TEST(log.records == 0);
+	for(int c = 0; c < RECORDS; c++){
+		_fill(&blob, c);
+		TEST(blob_log_append(&log, blob_head(&blob), &offsets[c]));
+	}
+	TEST(log.records == RECORDS);
+
+	// records come straight out of the mapping
+	const struct blob_field *first = blob_log_read(&log, offsets[0]);
+	TEST(first && blob_field_get_int(blob_field_first_child(first)) == 0);
+	_fill(&blob, 123);
+	TEST(blob_field_equal(blob_log_read(&log, offsets[123]), blob_head(&blob)));
+	TEST(blob_log_read(&log, log.size) == NULL);
+	TEST(blob_log_read(&log, 0) == NULL);
+	// offsets that do not start a record
+	TEST(blob_log_read(&log, offsets[1] + 1) == NULL);
+	TEST(blob_log_read(&log, offsets[1] - 4) == NULL);
+	TEST(blob_log_read(&log, offsets[1] + BLOB_LOG_RECORD_HEADER_SIZE) == NULL);
+
+	uint64_t pos = 0;
+	int count = 0;
+	const struct blob_field *field;
+	while((field = blob_log_next(&log, &pos)) != NULL){
+		TEST(blob_field_get_int(blob_field_first_child(field)) == count);
+		count++;
+	}
+	TEST(count == RECORDS);
+
+	// big records force a larger mapping but earlier pointers must stay valid
+	struct blob big;
+	blob_init(&big, 0, 0);
+	blob_offset_t o = blob_open_array(&big);
+	for(int c = 0; c < 100000; c++) blob_put_int(&big, c);
+	blob_close_array(&big, o);
+	size_t old_map_size = log.map_size;
+	for(int c = 0; c < 40; c++) TEST(blob_log_append(&log, blob_head(&big), NULL));
+	TEST(log.map_size > old_map_size);
+	TEST(blob_field_get_int(blob_field_first_child(first)) == 0);
+	blob_log_close(&log);
+
+	// a torn append is cut off when the log is opened again
+	off_t size = _file_size(path);
+	fd = open(path, O_WRONLY | O_APPEND);
+	static const char garbage[] = { 0x00, 0x00, 0x01, 0x00, 0x12, 0x34 };
+	TEST(write(fd, garbage, sizeof(garbage)) == sizeof(garbage));
+	close(fd);
+
+	TEST(blob_log_open(&log, path, BLOB_LOG_RDONLY));
+	TEST(log.records == RECORDS + 40);
+	TEST(_file_size(path) == size + (off_t)sizeof(garbage));
+	_fill(&blob, 0);
+	TEST(!blob_log_append(&log, blob_head(&blob), NULL));
+	blob_log_close(&log);
+
+	TEST(blob_log_open(&log, path, BLOB_LOG_SYNC));
+	TEST(log.records == RECORDS + 40);
+	TEST(_file_size(path) == size);
+	_fill(&blob, 7);
+	TEST(blob_log_append(&log, blob_head(&blob), NULL));
+	blob_log_close(&log);
+
+	// a damaged record ends the log
+	fd = open(path, O_WRONLY);
+	TEST(pwrite(fd, "x", 1, offsets[500] + BLOB_LOG_RECORD_HEADER_SIZE + 6) == 1);
+	close(fd);
+	TEST(blob_log_open(&log, path, 0));
+	TEST(log.records == 500);
+	TEST(log.size == offsets[500]);
+	blob_log_close(&log);
+
+	// not a log
+	fd = open(path, O_WRONLY | O_TRUNC);
+	TEST(write(fd, "not a log file", 14) == 14);
+	close(fd);
+	TEST(!blob_log_open(&log, path, 0));
+
+	unlink(path);
+	blob_free(&big);
+	blob_free(&blob);
+	return 0;
+}
@@ -0,0 +1,140 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <math.h>
+#include <string.h>
+
+static bool _from_msgpack(struct blob *blob, const void *data, size_t size){
+	blob_reset(blob);
+	return blob_put_msgpack(blob, data, size);
+}
+
+int main(void){
+	struct blob blob, copy;
+	struct blob_buffer_sink out;
+	blob_init(&blob, 0, 0);
+	blob_init(&copy, 0, 0);
+	blob_buffer_sink_init(&out);
+
+	blob_put_bool(&blob, true);
+	blob_put_string(&blob, "foo");
+	blob_put_int(&blob, -13);
+	blob_put_int(&blob, -200);
+	blob_put_int(&blob, 40000);
+	blob_put_int(&blob, -5000000000ll);
+	blob_put_int(&blob, 5000000000ll);
+	blob_put_real(&blob, M_PI);
+	blob_put_real(&blob, 12.5);
+
+	blob_offset_t o = blob_open_table(&blob);
+	blob_put_string(&blob, "one");
+	blob_put_int(&blob, 1);
+	blob_put_string(&blob, "a string that is longer than thirty one bytes");
+	blob_offset_t a = blob_open_array(&blob);
+	for(int c = 0; c < 300; c++) blob_put_int(&blob, c * 1000);
+	blob_close_array(&blob, a);
+	blob_close_table(&blob, o);
+
+	// round trip must reproduce exactly the same blob
+	TEST(blob_field_to_msgpack(blob_head(&blob), &out.sink));
+	TEST(_from_msgpack(&copy, out.buf, out.len));
+	const struct blob_field *root = blob_field_first_child(blob_head(&copy));
+	TEST(root && blob_field_type(root) == BLOB_FIELD_ARRAY);
+	TEST(blob_field_equal(root, blob_head(&blob)));
+
+	char *json = blob_field_to_json(root);
+	printf("msgpack: %s\n", json);
+	free(json);
+
+	// tables with non string keys are written as arrays
+	blob_reset(&blob);
+	o = blob_open_table(&blob);
+	blob_put_int(&blob, 1);
+	blob_put_int(&blob, 2);
+	blob_close_table(&blob, o);
+	blob_buffer_sink_reset(&out);
+	TEST(blob_field_to_msgpack(blob_field_first_child(blob_head(&blob)), &out.sink));
+	TEST(out.len == 3 && (uint8_t)out.buf[0] == 0x92);
+
+	// columns are written as the array of maps they were built from
+	struct blob_buffer_sink rows;
+	blob_buffer_sink_init(&rows);
+	blob_reset(&copy);
+	TEST(blob_put_json(&copy, "[{\"id\":1,\"name\":\"a\",\"load\":0.5},{\"id\":300000,\"name\":\"\",\"load\":-2.25},{\"id\":-7,\"name\":\"c\",\"load\":1.75}]"));
+	TEST(blob_field_to_msgpack(blob_field_first_child(blob_head(&copy)), &rows.sink));
+	blob_reset(&blob);
+	TEST(blob_put_columns(&blob, blob_field_first_child(blob_head(&copy))));
+	blob_buffer_sink_reset(&out);
+	TEST(blob_field_to_msgpack(blob_field_first_child(blob_head(&blob)), &out.sink));
+	TEST(out.len == rows.len && memcmp(out.buf, rows.buf, rows.len) == 0);
+	blob_buffer_sink_free(&rows);
+
+	// hand encoded: {"a": nil, "b": [true, false, -1, 255, 65535], "c": "xy", "d": bin[2]}
+	static const uint8_t doc[] = {
+		0x84,
+		0xa1, 'a', 0xc0,
+		0xa1, 'b', 0x95, 0xc3, 0xc2, 0xff, 0xcc, 0xff, 0xcd, 0xff, 0xff,
+		0xd9, 0x01, 'c', 0xa2, 'x', 'y',
+		0xa1, 'd', 0xc4, 0x02, 0x01, 0x02
+	};
+	TEST(_from_msgpack(&copy, doc, sizeof(doc)));
+	root = blob_field_first_child(blob_head(&copy));
+	const struct blob_field *fields[4];
+	const struct blob_field *key = blob_field_first_child(root);
+	for(int c = 0; c < 4; c++){
+		TEST(key && blob_field_get_string(key)[0] == 'a' + c);
+		fields[c] = blob_field_next_child(root, key);
+		key = blob_field_next_child(root, fields[c]);
+	}
+	TEST(blob_field_get_int(fields[0]) == 0);
+	static const long long expected[] = { 1, 0, -1, 255, 65535 };
+	int count = 0;
+	const struct blob_field *child;
+	blob_field_for_each_child(fields[1], child){
+		TEST(blob_field_get_int(child) == expected[count]);
+		count++;
+	}
+	TEST(count == 5);
+	TEST(strcmp(blob_field_get_string(fields[2]), "xy") == 0);
+	json = blob_field_to_json(fields[3]);
+	TEST(strcmp(json, "[1,2]") == 0);
+	free(json);
+
+	static const uint8_t f32[] = { 0xca, 0x41, 0x48, 0x00, 0x00 };
+	TEST(_from_msgpack(&copy, f32, sizeof(f32)));
+	TEST(blob_field_get_real(blob_field_first_child(blob_head(&copy))) == 12.5);
+
+	// invalid input
+	static const uint8_t truncated[] = { 0x93, 0x01, 0x02 };
+	static const uint8_t trailing[] = { 0x01, 0x02 };
+	static const uint8_t int_key[] = { 0x81, 0x01, 0x02 };
+	static const uint8_t ext[] = { 0xd4, 0x01, 0x00 };
+	static const uint8_t huge[] = { 0xdd, 0xff, 0xff, 0xff, 0xff, 0x00 };
+	static const uint8_t short_str[] = { 0xdb, 0x00, 0x00, 0x10, 0x00, 'a' };
+	static const uint8_t u64_max[] = { 0xcf, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	static const uint8_t u64_over[] = { 0xcf, 0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 };
+	TEST(!_from_msgpack(&copy, truncated, sizeof(truncated)));
+	TEST(!_from_msgpack(&copy, trailing, sizeof(trailing)));
+	TEST(!_from_msgpack(&copy, int_key, sizeof(int_key)));
+	TEST(!_from_msgpack(&copy, ext, sizeof(ext)));
+	TEST(!_from_msgpack(&copy, huge, sizeof(huge)));
+	TEST(!_from_msgpack(&copy, short_str, sizeof(short_str)));
+	TEST(!_from_msgpack(&copy, "", 0));
+	TEST(!_from_msgpack(&copy, u64_max, sizeof(u64_max)));
+	TEST(!_from_msgpack(&copy, u64_over, sizeof(u64_over)));
+
+	static const uint8_t i64_max[] = { 0xcf, 0x7f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+	TEST(_from_msgpack(&copy, i64_max, sizeof(i64_max)));
+	TEST(blob_field_get_int(blob_field_first_child(blob_head(&copy))) == INT64_MAX);
+
+	uint8_t deep[BLOB_MSGPACK_MAX_DEPTH + 2];
+	memset(deep, 0x91, sizeof(deep));
+	deep[sizeof(deep) - 1] = 0x01;
+	TEST(!_from_msgpack(&copy, deep, sizeof(deep)));
+	TEST(_from_msgpack(&copy, deep + 1, sizeof(deep) - 1));
+
+	blob_buffer_sink_free(&out);
+	blob_free(&blob);
+	blob_free(&copy);
+	return 0;
+}
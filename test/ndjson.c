@@ -0,0 +1,102 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define LINES 100000
+
+struct ndjson_state {
+	pthread_mutex_t lock;
+	uint64_t next_seq;
+	uint64_t lines;
+	uint64_t errors;
+	uint64_t values;
+	long long sum;
+	long long last;
+	bool in_order;
+	uint64_t stop_after;
+};
+
+static bool _on_batch(void *priv, const struct blob_ndjson_batch *batch){
+	struct ndjson_state *state = priv;
+	const struct blob_field *child;
+
+	pthread_mutex_lock(&state->lock);
+	if(batch->seq != state->next_seq) state->in_order = false;
+	state->next_seq++;
+	state->lines += batch->lines;
+	state->errors += batch->errors;
+	blob_field_for_each_child(blob_head(batch->blob), child){
+		const struct blob_field *n = blob_field_next_child(child, blob_field_first_child(child));
+		long long value = blob_field_get_int(n);
+		if(value <= state->last) state->in_order = false;
+		state->last = value;
+		state->sum += value;
+		state->values++;
+	}
+	bool ret = !state->stop_after || state->next_seq < state->stop_after;
+	pthread_mutex_unlock(&state->lock);
+	return ret;
+}
+
+static void _reset(struct ndjson_state *state){
+	state->next_seq = state->lines = state->errors = state->values = 0;
+	state->sum = 0;
+	state->last = -1;
+	state->in_order = true;
+	state->stop_after = 0;
+}
+
+int main(void){
+	char path[] = "/tmp/blobpack-ndjson-XXXXXX";
+	int fd = mkstemp(path);
+	TEST(fd >= 0);
+
+	// a few hundred kilobytes per megabyte chunk with blank, crlf and broken lines mixed in
+	FILE *file = fdopen(dup(fd), "w");
+	long long expected_sum = 0;
+	int expected_errors = 0;
+	for(int c = 0; c < LINES; c++){
+		if(c % 1000 == 0) fprintf(file, "\n   \n");
+		if(c % 777 == 0){
+			fprintf(file, "{\"broken\": [1, 2}\n");
+			expected_errors++;
+		}
+		fprintf(file, "{\"n\": %d, \"name\": \"line number %d\", \"tags\": [\"a\", \"b\"]}%s\n", c, c, (c % 3 == 0)?"\r":"");
+		expected_sum += c;
+	}
+	fprintf(file, "{\"n\": %d}", LINES);
+	expected_sum += LINES;
+	fclose(file);
+
+	struct ndjson_state state;
+	pthread_mutex_init(&state.lock, NULL);
+
+	_reset(&state);
+	TEST(blob_ndjson_ingest(fd, 4, 0, _on_batch, &state));
+	TEST(state.in_order);
+	TEST(state.next_seq > 1);
+	TEST(state.values == LINES + 1);
+	TEST(state.sum == expected_sum);
+	TEST(state.errors == (uint64_t)expected_errors);
+	TEST(state.lines == LINES + 1 + (uint64_t)expected_errors);
+
+	_reset(&state);
+	TEST(blob_ndjson_ingest(fd, 0, BLOB_NDJSON_UNORDERED, _on_batch, &state));
+	TEST(state.values == LINES + 1);
+	TEST(state.sum == expected_sum);
+	TEST(state.errors == (uint64_t)expected_errors);
+
+	_reset(&state);
+	state.stop_after = 1;
+	TEST(!blob_ndjson_ingest(fd, 4, 0, _on_batch, &state));
+	TEST(state.next_seq == 1);
+
+	pthread_mutex_destroy(&state.lock);
+	close(fd);
+	unlink(path);
+	return 0;
+}
@@ -0,0 +1,119 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#define MESSAGES 200000
+#define WRITERS 4
+
+struct writer {
+	struct blob_queue *queue;
+	int id;
+	int count;
+};
+
+static void _send(struct blob_queue *queue, int id, int seq){
+	struct blob blob;
+	while(!blob_queue_reserve(queue, &blob, 64 + (seq % 7) * 8)) sched_yield();
+	blob_put_int(&blob, id);
+	blob_put_int(&blob, seq);
+	// messages of different sizes so that records end up everywhere in the ring
+	for(int c = 0; c < seq % 7; c++) blob_put_int(&blob, c);
+	blob_queue_commit(queue, &blob);
+}
+
+static void *_writer(void *arg){
+	struct writer *w = arg;
+	for(int c = 0; c < w->count; c++) _send(w->queue, w->id, c);
+	return NULL;
+}
+
+// reads until every writer has sent count messages and checks that each writer's messages
+// arrive in order
+static bool _read(struct blob_queue *queue, int writers, int count){
+	int next[WRITERS] = { 0 };
+	int done = 0;
+	bool ok = true;
+	while(done < writers * count){
+		const struct blob_field *msg = blob_queue_peek(queue);
+		if(!msg){
+			sched_yield();
+			continue;
+		}
+		const struct blob_field *id = blob_field_first_child(msg);
+		const struct blob_field *seq = blob_field_next_child(msg, id);
+		int w = blob_field_get_int(id);
+		ok = ok && w >= 0 && w < writers && blob_field_get_int(seq) == next[w]++;
+		blob_queue_release(queue);
+		done++;
+	}
+	return ok && blob_queue_peek(queue) == NULL;
+}
+
+int main(void){
+	struct blob_queue queue;
+	struct blob blob;
+	pthread_t threads[WRITERS];
+	struct writer writers[WRITERS];
+
+	// a reserved slot is bounded and the ring fills up
+	TEST(blob_queue_init(&queue, 1000, 0));
+	TEST(queue.size == 1024);
+	TEST(!blob_queue_reserve(&queue, &blob, 2000));
+	TEST(blob_queue_reserve(&queue, &blob, 100));
+	TEST(blob_put_string(&blob, "hello"));
+	TEST(!blob_put_string(&blob, "this string is longer than the one hundred bytes that were reserved for the message so it does not fit"));
+	blob_queue_commit(&queue, &blob);
+	int count = 1;
+	while(blob_queue_reserve(&queue, &blob, 100)){
+		blob_put_int(&blob, count++);
+		blob_queue_commit(&queue, &blob);
+	}
+	TEST(count > 8);
+	const struct blob_field *msg = blob_queue_peek(&queue);
+	TEST(msg && strcmp(blob_field_get_string(blob_field_first_child(msg)), "hello") == 0);
+	TEST(blob_queue_peek(&queue) == msg);
+	blob_queue_release(&queue);
+	for(int c = 1; c < count; c++){
+		msg = blob_queue_peek(&queue);
+		TEST(msg && blob_field_get_int(blob_field_first_child(msg)) == c);
+		blob_queue_release(&queue);
+	}
+	TEST(blob_queue_peek(&queue) == NULL);
+
+	// an empty ring takes a slot of half its size wherever the last message ended
+	bool half = true;
+	for(uint64_t shift = 0; shift < queue.size; shift += 8){
+		atomic_store(&queue.state->head, shift);
+		atomic_store(&queue.state->committed, shift);
+		atomic_store(&queue.state->tail, shift);
+		half = half && blob_queue_reserve(&queue, &blob, queue.size / 2 - BLOB_QUEUE_RECORD_HEADER_SIZE);
+		if(!half) break;
+		blob_put_int(&blob, 1);
+		blob_queue_commit(&queue, &blob);
+		half = half && blob_queue_peek(&queue) != NULL;
+		blob_queue_release(&queue);
+	}
+	TEST(half);
+	blob_queue_free(&queue);
+
+	// one writer thread
+	TEST(blob_queue_init(&queue, 4096, 0));
+	writers[0] = (struct writer){ .queue = &queue, .id = 0, .count = MESSAGES };
+	TEST(pthread_create(&threads[0], NULL, _writer, &writers[0]) == 0);
+	TEST(_read(&queue, 1, MESSAGES));
+	pthread_join(threads[0], NULL);
+	blob_queue_free(&queue);
+
+	// several writer threads
+	TEST(blob_queue_init(&queue, 4096, BLOB_QUEUE_MPSC));
+	for(int c = 0; c < WRITERS; c++){
+		writers[c] = (struct writer){ .queue = &queue, .id = c, .count = MESSAGES / WRITERS };
+		TEST(pthread_create(&threads[c], NULL, _writer, &writers[c]) == 0);
+	}
+	TEST(_read(&queue, WRITERS, MESSAGES / WRITERS));
+	for(int c = 0; c < WRITERS; c++) pthread_join(threads[c], NULL);
+	blob_queue_free(&queue);
+	return 0;
+}
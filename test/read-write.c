@@ -98,6 +98,13 @@ int main(void){
 	TEST(blob_field_get_int(child = blob_field_next_child(list, child)) == 2); 
 	TEST(blob_field_get_int(child = blob_field_next_child(list, child)) == 3); 
 
+	// lengths that do not fit into a field header are refused before anything is copied
+	uint32_t size = blob_size(&blob); 
+	TEST(blob_put_string_len(&blob, "x", (size_t)UINT32_MAX) == NULL); 
+	TEST(blob_put_string_len(&blob, "x", BLOB_FIELD_LEN_MASK) == NULL); 
+	TEST(blob_size(&blob) == size); 
+	TEST(blob_put_string_len(&blob, "xy", 2) != NULL); 
+
 	return 0; 
 }
 
@@ -0,0 +1,87 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MESSAGES 100000
+#define WRITERS 3
+
+// every writer process maps the channel on its own and sends its id and a sequence number
+static void _writer(int fd, int id){
+	struct blob_shm_channel ch;
+	struct blob blob;
+	if(!blob_shm_channel_open_fd(&ch, fd)) _exit(1);
+	for(int c = 0; c < MESSAGES; c++){
+		if(!blob_shm_channel_reserve(&ch, &blob, 64 + (c % 5) * 16, -1)) _exit(2);
+		blob_put_int(&blob, id);
+		blob_put_int(&blob, c);
+		blob_put_string(&blob, "payload");
+		blob_shm_channel_commit(&ch, &blob);
+	}
+	blob_shm_channel_close(&ch);
+	_exit(0);
+}
+
+int main(void){
+	struct blob_shm_channel ch, other;
+	struct blob blob;
+	pid_t pids[WRITERS];
+	char path[64];
+
+	// a file backed channel opened by name
+	snprintf(path, sizeof(path), "/dev/shm/blobpack-test-%d", (int)getpid());
+	TEST(blob_shm_channel_create(&ch, path, 1000, 0));
+	TEST(ch.queue.size == 1024);
+	TEST(blob_shm_channel_open(&other, path));
+	TEST(blob_shm_channel_peek(&other, 0) == NULL);
+	TEST(blob_shm_channel_peek(&other, 20) == NULL);
+	TEST(!blob_shm_channel_reserve(&ch, &blob, 2000, -1));
+	TEST(blob_shm_channel_reserve(&ch, &blob, 100, 0));
+	TEST(blob_put_string(&blob, "hello"));
+	blob_shm_channel_commit(&ch, &blob);
+	const struct blob_field *msg = blob_shm_channel_peek(&other, 0);
+	TEST(msg && strcmp(blob_field_get_string(blob_field_first_child(msg)), "hello") == 0);
+	blob_shm_channel_release(&other);
+
+	// writers give up when the ring stays full
+	int count = 0;
+	while(blob_shm_channel_reserve(&ch, &blob, 100, 10)){
+		blob_put_int(&blob, count++);
+		blob_shm_channel_commit(&ch, &blob);
+	}
+	TEST(count > 5);
+	blob_shm_channel_close(&other);
+	blob_shm_channel_close(&ch);
+	unlink(path);
+	TEST(!blob_shm_channel_open(&other, path));
+
+	// an anonymous channel shared with forked writers
+	TEST(blob_shm_channel_create(&ch, NULL, 8192, BLOB_QUEUE_MPSC));
+	for(int c = 0; c < WRITERS; c++){
+		pids[c] = fork();
+		TEST(pids[c] >= 0);
+		if(pids[c] == 0) _writer(ch.fd, c);
+	}
+
+	int next[WRITERS] = { 0 };
+	bool ordered = true;
+	for(int c = 0; c < WRITERS * MESSAGES; c++){
+		msg = blob_shm_channel_peek(&ch, 5000);
+		if(!msg) break;
+		const struct blob_field *id = blob_field_first_child(msg);
+		int w = blob_field_get_int(id);
+		ordered = ordered && w >= 0 && w < WRITERS && blob_field_get_int(blob_field_next_child(msg, id)) == next[w]++;
+		blob_shm_channel_release(&ch);
+	}
+	TEST(ordered);
+	for(int c = 0; c < WRITERS; c++){
+		int status;
+		TEST(waitpid(pids[c], &status, 0) == pids[c] && WIFEXITED(status) && WEXITSTATUS(status) == 0);
+		TEST(next[c] == MESSAGES);
+	}
+	TEST(blob_shm_channel_peek(&ch, 0) == NULL);
+	blob_shm_channel_close(&ch);
+	return 0;
+}
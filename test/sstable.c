@@ -0,0 +1,137 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define ENTRIES 50000
+
+static void _fill(struct blob *blob, int n){
+	blob_reset(blob);
+	blob_offset_t o = blob_open_table(blob);
+	blob_put_string(blob, "id");
+	blob_put_int(blob, n);
+	blob_put_string(blob, "values");
+	blob_offset_t a = blob_open_array(blob);
+	for(int c = 0; c < n % 13; c++) blob_put_int(blob, c * n);
+	blob_close_array(blob, a);
+	blob_close_table(blob, o);
+}
+
+static long long _id(const struct blob_field *value){
+	const struct blob_field *table = blob_field_first_child(value);
+	return blob_field_get_int(blob_field_next_child(table, blob_field_first_child(table)));
+}
+
+int main(void){
+	char path[] = "/tmp/blobpack-sstable-XXXXXX";
+	int fd = mkstemp(path);
+	TEST(fd >= 0);
+	close(fd);
+
+	struct blob blob;
+	struct blob_sstable_writer writer;
+	struct blob_sstable table;
+	char key[32];
+	blob_init(&blob, 0, 0);
+
+	// only even ids are stored so that odd ones can be looked up as missing keys
+	TEST(blob_sstable_writer_open(&writer, path));
+	for(int c = 0; c < ENTRIES; c++){
+		snprintf(key, sizeof(key), "device-%08d", c * 2);
+		_fill(&blob, c * 2);
+		TEST(blob_sstable_writer_add(&writer, key, &blob));
+	}
+	TEST(!blob_sstable_writer_add(&writer, "device-00000000", &blob));
+	TEST(!blob_sstable_writer_add(&writer, key, &blob));
+	TEST(blob_sstable_writer_finish(&writer));
+
+	TEST(blob_sstable_open(&table, path));
+	TEST(table.entries == ENTRIES);
+	TEST(table.index_count > 1);
+
+	bool found = true, missing = true;
+	for(int c = 0; c < ENTRIES * 2; c++){
+		snprintf(key, sizeof(key), "device-%08d", c);
+		const struct blob_field *value = blob_sstable_get(&table, key);
+		if(c & 1) missing = missing && !value;
+		else found = found && value && _id(value) == c;
+	}
+	TEST(found);
+	TEST(missing);
+	TEST(blob_sstable_get(&table, "a") == NULL);
+	TEST(blob_sstable_get(&table, "z") == NULL);
+	TEST(blob_sstable_get(&table, "") == NULL);
+
+	_fill(&blob, 1234);
+	TEST(blob_field_equal(blob_sstable_get(&table, "device-00001234"), blob_head(&blob)));
+
+	// range scans start at the first key that is not smaller
+	struct blob_sstable_iter iter;
+	const char *k;
+	const struct blob_field *value;
+	blob_sstable_seek(&table, &iter, "device-00000101");
+	TEST(blob_sstable_next(&iter, &k, &value));
+	TEST(strcmp(k, "device-00000102") == 0 && _id(value) == 102);
+	TEST(blob_sstable_next(&iter, &k, &value));
+	TEST(strcmp(k, "device-00000104") == 0);
+
+	int count = 0;
+	long long last = -1;
+	bool ordered = true;
+	blob_sstable_seek(&table, &iter, NULL);
+	while(blob_sstable_next(&iter, &k, &value)){
+		ordered = ordered && _id(value) > last;
+		last = _id(value);
+		count++;
+	}
+	TEST(ordered);
+	TEST(count == ENTRIES);
+
+	blob_sstable_seek(&table, &iter, "zzz");
+	TEST(!blob_sstable_next(&iter, &k, &value));
+	blob_sstable_seek(&table, &iter, "");
+	TEST(blob_sstable_next(&iter, &k, &value) && _id(value) == 0);
+	blob_sstable_close(&table);
+
+	// an empty table is valid
+	TEST(blob_sstable_writer_open(&writer, path));
+	TEST(blob_sstable_writer_finish(&writer));
+	TEST(blob_sstable_open(&table, path));
+	TEST(table.entries == 0);
+	TEST(blob_sstable_get(&table, "device-00000000") == NULL);
+	blob_sstable_seek(&table, &iter, NULL);
+	TEST(!blob_sstable_next(&iter, &k, &value));
+	blob_sstable_close(&table);
+
+	// a damaged index is refused
+	TEST(blob_sstable_writer_open(&writer, path));
+	TEST(blob_sstable_writer_add(&writer, "key", &blob));
+	TEST(blob_sstable_writer_finish(&writer));
+	off_t size = lseek(fd = open(path, O_RDWR), 0, SEEK_END);
+	TEST(pwrite(fd, "\xff", 1, size - BLOB_SSTABLE_FOOTER_SIZE - 1) == 1);
+	close(fd);
+	TEST(!blob_sstable_open(&table, path));
+
+	// so is a value whose header claims more than its entry holds
+	TEST(blob_sstable_writer_open(&writer, path));
+	TEST(blob_sstable_writer_add(&writer, "key", &blob));
+	TEST(blob_sstable_writer_finish(&writer));
+	TEST(blob_sstable_open(&table, path));
+	TEST(blob_sstable_get(&table, "key") != NULL);
+	blob_sstable_close(&table);
+	fd = open(path, O_RDWR);
+	// file header, entry header and the padded key come before the length of the value
+	TEST(pwrite(fd, "\xff\xff\xff", 3, BLOB_SSTABLE_HEADER_SIZE + 8 + 4 + 1) == 3);
+	close(fd);
+	TEST(blob_sstable_open(&table, path));
+	TEST(blob_sstable_get(&table, "key") == NULL);
+	blob_sstable_seek(&table, &iter, NULL);
+	TEST(!blob_sstable_next(&iter, &k, &value));
+	blob_sstable_close(&table);
+
+	unlink(path);
+	blob_free(&blob);
+	return 0;
+}
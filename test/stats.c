@@ -0,0 +1,164 @@
+#include "test-funcs.h"
+#include <blobpack.h>
+#include <pthread.h>
+#include <string.h>
+
+static void *_json_thread(void *arg){
+	struct blob blob;
+	blob_init(&blob, 0, 0);
+	for(int c = 0; c < 10; c++){
+		blob_reset(&blob);
+		blob_put_json(&blob, "{\"a\":[1,2,3]}");
+	}
+	blob_free(&blob);
+	return NULL;
+}
+
+static void *_thread(void *arg){
+	struct blob blob;
+	blob_init(&blob, 0, 0);
+	for(int c = 0; c < 1000; c++) blob_put_int(&blob, c);
+	blob_free(&blob);
+	return NULL;
+}
+
+static pthread_key_t _late_key;
+
+// keeps using blobs in every round of key destructors the thread goes through
+static void _late_destructor(void *arg){
+	_thread(NULL);
+	pthread_setspecific(_late_key, arg);
+}
+
+static void *_late_thread(void *arg){
+	pthread_setspecific(_late_key, arg);
+	return _thread(NULL);
+}
+
+int main(void){
+	struct blob blob, copy;
+	struct blob_stats before, after;
+
+	blob_stats_get(&before);
+	blob_init(&blob, 0, 0);
+	blob_init(&copy, 0, 0);
+	for(int c = 0; c < 1000; c++) blob_put_int(&blob, c);
+	blob_stats_get(&after);
+	TEST(after.resizes >= before.resizes + 1000);
+	TEST(after.reallocs > before.reallocs);
+	TEST(after.realloc_moves <= after.reallocs);
+	TEST(after.bytes_memset > before.bytes_memset);
+	TEST(after.peak_memlen >= blob.memlen);
+
+	// copies are counted by their size
+	before = after;
+	blob_put_attr(&copy, blob_head(&blob));
+	blob_stats_get(&after);
+	TEST(after.bytes_copied == before.bytes_copied + blob_size(&blob));
+
+	// the JSON encoder starts with a buffer the size of the blob data, which short numbers outgrow
+	before = after;
+	blob_reset(&copy);
+	for(int c = 0; c < 100; c++) blob_put_int(&copy, 1000000000 + c);
+	free(blob_to_json(&copy));
+	blob_stats_get(&after);
+	TEST(after.json_grows > before.json_grows);
+
+	// counters of threads stay in the totals after the threads are gone
+	before = after;
+	pthread_t thread;
+	TEST(pthread_create(&thread, NULL, _thread, NULL) == 0);
+	pthread_join(thread, NULL);
+	blob_stats_get(&after);
+	TEST(after.resizes >= before.resizes + 1000);
+
+	// blobs used by destructors after the counters were merged leave nothing of the thread
+	// behind, so the next thread (which likely gets the same thread local storage) is counted
+	static int late;
+	TEST(pthread_key_create(&_late_key, _late_destructor) == 0);
+	TEST(pthread_create(&thread, NULL, _late_thread, &late) == 0);
+	pthread_join(thread, NULL);
+	before = after;
+	TEST(pthread_create(&thread, NULL, _thread, NULL) == 0);
+	pthread_join(thread, NULL);
+	blob_stats_get(&after);
+	TEST(after.resizes >= before.resizes + 2000);
+
+	// per blob counters if they are compiled in
+	struct blob_stats stats;
+	memset(&stats, 0, sizeof(stats));
+	if(blob_stats_attach(&copy, &stats)){
+		blob_put_attr(&copy, blob_head(&blob));
+		TEST(stats.resizes == 1);
+		TEST(stats.bytes_copied == blob_size(&blob));
+	} else {
+		TEST(copy.stats == NULL);
+	}
+
+	// latencies are only recorded once they are turned on
+	struct blob_stats_hist *hist = calloc(1, sizeof(*hist));
+	blob_stats_get_latency(BLOB_STATS_OP_PUT, hist);
+	TEST(hist->count == 0);
+	TEST(blob_stats_hist_percentile(hist, 99) == 0);
+
+	blob_stats_latency(true);
+	for(int c = 0; c < 100; c++) blob_put_attr(&copy, blob_head(&blob));
+	blob_stats_get_latency(BLOB_STATS_OP_PUT, hist);
+	TEST(hist->count == 100);
+	TEST(hist->min_ns <= hist->max_ns && hist->sum_ns >= hist->max_ns);
+	uint64_t p50 = blob_stats_hist_percentile(hist, 50);
+	uint64_t p999 = blob_stats_hist_percentile(hist, 99.9);
+	TEST(hist->min_ns <= p50 && p50 <= p999 && p999 <= hist->max_ns);
+	TEST(blob_stats_hist_percentile(hist, 100) == hist->max_ns);
+
+	free(blob_field_to_json(blob_head(&blob)));
+	TEST(blob_put_json(&copy, "[1,2,3]"));
+	blob_field_validate(blob_head(&blob), "i");
+	struct blob_policy policy[] = { { .name = "a", .type = BLOB_FIELD_ANY } };
+	blob_field_parse_values(blob_head(&blob), policy, 1);
+	for(int op = BLOB_STATS_OP_JSON_ENCODE; op < BLOB_STATS_OPS; op++){
+		blob_stats_get_latency(op, hist);
+		TEST(hist->count >= 1);
+	}
+
+	// histograms of threads stay in the totals after the threads are gone
+	blob_stats_get_latency(BLOB_STATS_OP_JSON_DECODE, hist);
+	uint64_t decodes = hist->count;
+	TEST(pthread_create(&thread, NULL, _json_thread, NULL) == 0);
+	pthread_join(thread, NULL);
+	blob_stats_get_latency(BLOB_STATS_OP_JSON_DECODE, hist);
+	TEST(hist->count == decodes + 10);
+	blob_stats_latency(false);
+	blob_put_attr(&copy, blob_head(&blob));
+	blob_stats_get_latency(BLOB_STATS_OP_PUT, hist);
+	TEST(hist->count == 100);
+
+	// percentiles are the upper bound of their bucket: below 16 ns every ns has its own bucket,
+	// above that every power of two is split in 16 buckets
+	memset(hist, 0, sizeof(*hist));
+	hist->buckets[5] = 1;
+	TEST(blob_stats_hist_percentile(hist, 50) == 5);
+	hist->buckets[5] = 0;
+	hist->buckets[100] = 1;
+	TEST(blob_stats_hist_percentile(hist, 50) == 671);
+	hist->max_ns = 650;
+	TEST(blob_stats_hist_percentile(hist, 50) == 650);
+	free(hist);
+
+	// the dump holds the counters and a histogram per operation
+	struct blob dump;
+	blob_init(&dump, 0, 0);
+	blob_stats_dump(&dump);
+	char *json = blob_to_json(&dump);
+	TEST(strstr(json, "\"resizes\":"));
+	TEST(strstr(json, "\"put\":{\"count\":100,"));
+	TEST(strstr(json, "\"parse_values\":{"));
+	TEST(strstr(json, "\"p99.9\":"));
+	TEST(strstr(json, "\"buckets\":[["));
+	free(json);
+	blob_free(&dump);
+
+	blob_free(&blob);
+	blob_free(&copy);
+	return 0;
+}